@@ -0,0 +1,121 @@
+#include "sotm/optimizers/coulomb-distributed.hpp"
+#include "sotm/optimizers/coulomb-brute-force.hpp"
+#include "sotm/base/model-context.hpp"
+#include "sotm/payloads/demo/empty-payloads.hpp"
+#include "sotm/math/random.hpp"
+#include "sotm/math/generic.hpp"
+
+#include <mpi.h>
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace sotm;
+
+namespace {
+
+const size_t nodesCount = 3000;
+/// About 20 nodes per cell in 20 x 20 x 40 box, so cells summaries are meaningful
+const double cellSize = 5.0;
+const double maxRmsError = 1e-2;
+
+/**
+ * Compare distributed results with brute force at every node, return true if error is small.
+ * Random charges of both signs give potential close to zero at some nodes, so errors are
+ * relative to RMS of exact values over all nodes
+ */
+bool compare(
+        const vector<unique_ptr<CoulombNodeBase>>& distributed,
+        const vector<unique_ptr<CoulombNodeBase>>& exact)
+{
+    double fieldErrorSum = 0.0, fieldSum = 0.0, potentialErrorSum = 0.0, potentialSum = 0.0;
+    for (size_t i = 0; i < distributed.size(); i++)
+    {
+        FieldPotential d = distributed[i]->getFP();
+        FieldPotential e = exact[i]->getFP();
+        fieldErrorSum += sqr((d.field - e.field).norm());
+        fieldSum += sqr(e.field.norm());
+        potentialErrorSum += sqr(d.potential - e.potential);
+        potentialSum += sqr(e.potential);
+    }
+    double fieldError = sqrt(fieldErrorSum / fieldSum);
+    double potentialError = sqrt(potentialErrorSum / potentialSum);
+    cout << "Relative RMS error of field: " << fieldError << ", of potential: " << potentialError << endl;
+    return fieldError < maxRmsError && potentialError < maxRmsError;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    int rank = 0, size = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (rank != 0)
+    {
+        CoulombDistributed::runWorker();
+        MPI_Finalize();
+        return 0;
+    }
+
+    bool ok = true;
+    {
+        ModelContext c;
+        c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+        c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+        c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+        DistributedCoulombParameters parameters;
+        parameters.cellSize = cellSize;
+        CoulombDistributed distributedCalculator(c.graphRegister, MPI_COMM_WORLD, parameters);
+        CoulombBruteForce exactCalculator(c.graphRegister);
+
+        Random::randomize(1);
+        vector<PtrWrap<Node>> nodes;
+        vector<double> charges(nodesCount);
+        vector<unique_ptr<CoulombNodeBase>> distributed, exact;
+        for (size_t i = 0; i < nodesCount; i++)
+        {
+            StaticVector<3> pos(Random::uniform(-10.0, 10.0), Random::uniform(-10.0, 10.0), Random::uniform(0.0, 40.0));
+            nodes.push_back(PtrWrap<Node>::make(&c, pos));
+            charges[i] = Random::uniform(-1e-6, 1e-6);
+            distributed.emplace_back(distributedCalculator.makeNode(charges[i], *nodes.back()));
+            exact.emplace_back(exactCalculator.makeNode(charges[i], *nodes.back()));
+        }
+
+        distributedCalculator.rebuildOptimization();
+        cout << "Ranks: " << size << ", cells: " << distributedCalculator.stats().cells
+             << ", halo nodes: " << distributedCalculator.stats().haloNodes << endl;
+        ok = compare(distributed, exact);
+        if (distributedCalculator.stats().cells * 10 > nodesCount)
+        {
+            cout << "Less than 10 nodes per cell in average" << endl;
+            ok = false;
+        }
+        if (size > 1 && distributedCalculator.stats().haloNodes == 0)
+        {
+            cout << "No halo nodes exchanged between neighbour domains" << endl;
+            ok = false;
+        }
+
+        // Charges changed: results should follow them after rebuild
+        for (auto &it : charges)
+            it = -it * 0.5;
+        distributedCalculator.rebuildOptimization();
+        ok = compare(distributed, exact) && ok;
+
+        CoulombDistributed::stopWorkers();
+        distributed.clear();
+        exact.clear();
+        EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+    }
+
+    cout << (ok ? "OK" : "FAILED") << endl;
+    MPI_Finalize();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#!/bin/bash
+
+my_dir=$(dirname $0)
+source "../coloring.sh"
+
+ranks=${MPI_TEST_RANKS:-4}
+
+echo -n "Running MPI test $1 with $ranks ranks... "
+
+which mpirun > /dev/null || {
+	echo "${bold}${red}mpirun not installed,${normal} cannot continue"
+	exit 0
+}
+
+reportFile=$1.txt
+mpirun -np $ranks ./$1 > $reportFile 2>&1 || {
+	echo "${bold}${red}FAILED${normal} on $1. Details: $reportFile"
+	exit 0
+}
+
+echo "${green}${bold}OK${normal}"
@@ -11,6 +11,7 @@
 #include "sotm/base/time-iter.hpp"
 
 #include <QThread>
+#include <atomic>
 #include <iostream>
 
 namespace sotm {
@@ -28,15 +29,23 @@ public:
 	void setPeriod(double period);
 	double getPeriod();
 
+	/// Stop runContinuously(). May be called from any thread
+	void requestStop();
+	/// Should be called before starting runContinuously()
+	void clearStopRequest();
+
 signals:
     void frameDone();
 
 public slots:
     void calculateFrame();
+    /// Iterate until stop time or requestStop(). Drawing uses published snapshots meanwhile
+    void runContinuously();
 
 private:
     TimeIterator *m_timeIterator;
     PeriodicStopHook m_stopHook;
+    std::atomic<bool> m_stopRequested{false};
 };
 
 
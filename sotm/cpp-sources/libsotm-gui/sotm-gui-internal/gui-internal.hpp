@@ -3,6 +3,7 @@
 
 #include <sotm/output/graph-renderer.hpp>
 #include "sotm/output/render-preferences.hpp"
+#include "sotm/output/graph-snapshot.hpp"
 #include "sotm-gui/gui.hpp"
 #include "sotm-gui-internal/async-iteration.hpp"
 
@@ -25,6 +26,9 @@ public:
 	RenderPreferences* renderPreferences() override;
 	GraphRenderer* graphDrawer();
 	FrameOptions* frameOptions();
+	/// Snapshots published by iterating thread while animation runs
+	TripleBuffer<GraphSnapshot>* snapshots();
+	GraphSnapshotHook* snapshotHook();
 
 private:
 	ModelContext* m_modelContext;
@@ -35,6 +39,9 @@ private:
     AsyncIteratorWrapper m_asynIterationWrapper;
     AsyncIteratorRunner m_asyncIterationRunner{m_asynIterationWrapper};
 
+    TripleBuffer<GraphSnapshot> m_snapshots;
+    GraphSnapshotHook m_snapshotHook{m_modelContext, &m_snapshots};
+
     RenderPreferences m_renderPreferences;
 
     FrameOptions m_frameOptions;
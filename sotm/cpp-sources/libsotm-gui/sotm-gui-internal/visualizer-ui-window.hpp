@@ -5,13 +5,14 @@
 
 #include <vtkRenderer.h>
 #include <vtkSmartPointer.h>
+#include <vtkCallbackCommand.h>
 
 #include <QTimer>
 #include <QMainWindow>
-#include <QElapsedTimer>
 
 namespace sotm {
     class QtGUI;
+    struct GraphSnapshot;
 }
 
 enum class RunningSate
@@ -35,6 +36,7 @@ public:
 
 signals:
   void calculateNextFrame();
+  void runContinuously();
 
 public slots:
 
@@ -76,7 +78,10 @@ private:
     void stopFrameWaiting();
     bool shouldAnimationContinued();
     void updateModelInfo();
+    void updateModelInfo(const sotm::GraphSnapshot& snapshot);
     void renderCurrentFrame();
+    /// Render latest snapshot if iterating thread published new one since previous call
+    void renderLatestSnapshot();
 
     void startNextFrameCalculating();
 
@@ -84,14 +89,20 @@ private:
     void buttonsToNeedToBeStopped();
     void buttonsToStopped();
 
+    /// Ctrl + left click toggles labels of node nearest to clicked point
+    static void onRendererClick(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+    /// Level of detail depends on camera, so it is prepared again when camera is moved
+    static void onInteractionEnd(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+
 	vtkSmartPointer<vtkRenderer> m_renderer{ vtkSmartPointer<vtkRenderer>::New() };
+	vtkSmartPointer<vtkCallbackCommand> m_clickCallback{ vtkSmartPointer<vtkCallbackCommand>::New() };
+	vtkSmartPointer<vtkCallbackCommand> m_interactionEndCallback{ vtkSmartPointer<vtkCallbackCommand>::New() };
 
     sotm::QtGUI *m_gui;
 
     RunningSate m_runningState = RunningSate::stopped;
 
     QTimer *m_frameTimer = nullptr;
-    QElapsedTimer m_frameCalculationElapsed;
 };
 
 #endif
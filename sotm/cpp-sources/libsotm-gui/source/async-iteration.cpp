@@ -34,6 +34,26 @@ void AsyncIteratorWrapper::calculateFrame()
 	emit frameDone();
 }
 
+void AsyncIteratorWrapper::runContinuously()
+{
+	// Stop hook only interrupts run() here. Request that comes while run() starts
+	// is noticed after next stop hook at most
+	while (!m_stopRequested && !m_timeIterator->isDone())
+		m_timeIterator->run();
+	emit frameDone();
+}
+
+void AsyncIteratorWrapper::requestStop()
+{
+	m_stopRequested = true;
+	m_timeIterator->stop();
+}
+
+void AsyncIteratorWrapper::clearStopRequest()
+{
+	m_stopRequested = false;
+}
+
 
 AsyncIteratorRunner::AsyncIteratorRunner(AsyncIteratorWrapper& iteratorWrapper) :
 		m_iteratorWrapper(iteratorWrapper)
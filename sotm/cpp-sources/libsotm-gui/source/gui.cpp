@@ -39,7 +39,8 @@ QtGUI::QtGUI(ModelContext* modelContext, TimeIterator* timeIterator) :
     m_drawer(modelContext, &m_renderPreferences),
     m_asynIterationWrapper(timeIterator)
 {
-
+	if (m_timeIterator)
+		m_timeIterator->addHook(&m_snapshotHook);
 }
 
 int QtGUI::run(int argc, char** argv)
@@ -57,6 +58,7 @@ int QtGUI::run(int argc, char** argv)
 void QtGUI::setFrameOptions(double FramePeriod, double fps)
 {
 	m_asynIterationWrapper.setPeriod(FramePeriod);
+	m_snapshotHook.setPeriod(FramePeriod);
 	m_frameOptions.fps = fps;
 }
 
@@ -99,3 +101,13 @@ FrameOptions* QtGUI::frameOptions()
 {
 	return &m_frameOptions;
 }
+
+TripleBuffer<GraphSnapshot>* QtGUI::snapshots()
+{
+	return &m_snapshots;
+}
+
+GraphSnapshotHook* QtGUI::snapshotHook()
+{
+	return &m_snapshotHook;
+}
@@ -9,6 +9,8 @@
 #include <vtkCellArray.h>
 #include <vtkLine.h>
 #include <vtkSmartPointer.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkWorldPointPicker.h>
 
 #include <iostream>
 #include <string>
@@ -24,6 +26,14 @@ VisualizerUIWindow::VisualizerUIWindow(sotm::QtGUI *gui) :
 
     this->qvtkWidget->GetRenderWindow()->AddRenderer(m_renderer);
 
+    m_clickCallback->SetCallback(&VisualizerUIWindow::onRendererClick);
+    m_clickCallback->SetClientData(this);
+    this->qvtkWidget->GetRenderWindow()->GetInteractor()->AddObserver(vtkCommand::LeftButtonPressEvent, m_clickCallback, 1.0);
+
+    m_interactionEndCallback->SetCallback(&VisualizerUIWindow::onInteractionEnd);
+    m_interactionEndCallback->SetClientData(this);
+    this->qvtkWidget->GetRenderWindow()->GetInteractor()->AddObserver(vtkCommand::EndInteractionEvent, m_interactionEndCallback);
+
     m_frameTimer = new QTimer(this);
     connect(m_frameTimer, SIGNAL(timeout()), this, SLOT(onFrameTimerTimeout()));
 
@@ -32,6 +42,7 @@ VisualizerUIWindow::VisualizerUIWindow(sotm::QtGUI *gui) :
     connect(this->actionExit, SIGNAL(triggered()), this, SLOT(slotExit()));
 
     connect(this, SIGNAL(calculateNextFrame()), m_gui->asyncIteratorWrapper(), SLOT(calculateFrame()));
+    connect(this, SIGNAL(runContinuously()), m_gui->asyncIteratorWrapper(), SLOT(runContinuously()));
     connect(m_gui->asyncIteratorWrapper(), SIGNAL(frameDone()), this, SLOT(onFrameCalculated()));
     m_gui->asyncIteratorRunner()->run();
 }
@@ -104,49 +115,40 @@ void VisualizerUIWindow::updateModelInfo()
     }
 }
 
+void VisualizerUIWindow::updateModelInfo(const sotm::GraphSnapshot& snapshot)
+{
+    labelNodesCount->setText(std::to_string(snapshot.nodesCount()).c_str());
+    labelLinksCount->setText(std::to_string(snapshot.linksCount()).c_str());
+    doubleSpinBoxTime->setValue(snapshot.time);
+}
+
 void VisualizerUIWindow::slotExit()
 {
+	if (!m_gui->isStaticGraph())
+		m_gui->asyncIteratorWrapper()->requestStop();
 	m_gui->asyncIteratorRunner()->stopAndJoin();
     qApp->exit();
 }
 
 void VisualizerUIWindow::onFrameCalculated()
 {
+	// Iterating thread is idle now, so graph may be drawn directly
+	m_frameTimer->stop();
 	renderCurrentFrame();
-	if (m_runningState == RunningSate::needToBeStopped
-			|| m_gui->timeIterator()->isDone())
-	{
-		buttonsToStopped();
-		m_runningState = RunningSate::stopped;
-		return;
-	}
-
-	unsigned int frameDuration = 1000 / spinBoxFPS->value();
-	unsigned int dt = m_frameCalculationElapsed.elapsed();
-	m_frameTimer->start(dt < frameDuration ? frameDuration - dt : 0);
+	buttonsToStopped();
+	m_runningState = RunningSate::stopped;
 }
 
 void VisualizerUIWindow::onFrameTimerTimeout()
 {
-	m_frameTimer->stop();
-	//std::cout << "Timer" << std::endl;
-	switch (m_runningState)
+	if (m_runningState == RunningSate::stopped)
 	{
-	case RunningSate::running:
-		startNextFrameCalculating();
-		break;
-
-	case RunningSate::needToBeStopped:
-		buttonsToStopped();
-		m_runningState = RunningSate::stopped;
-		break;
-
-	case RunningSate::stopped: // WTF??
-		break;
+		m_frameTimer->stop();
+		return;
 	}
+	renderLatestSnapshot();
 }
 
-
 void VisualizerUIWindow::renderCurrentFrame()
 {
 	//std::cout << "Rendering" << std::endl;
@@ -158,9 +160,55 @@ void VisualizerUIWindow::renderCurrentFrame()
 	//std::cout << "Rendering done" << std::endl;
 }
 
+void VisualizerUIWindow::renderLatestSnapshot()
+{
+	sotm::TripleBuffer<sotm::GraphSnapshot>* snapshots = m_gui->snapshots();
+	if (!snapshots->update())
+		return;
+
+	const sotm::GraphSnapshot& snapshot = snapshots->readBuffer();
+	updateModelInfo(snapshot);
+	m_renderer->RemoveAllViewProps();
+	m_gui->graphDrawer()->prepareCurrentBuffer(snapshot);
+	m_gui->graphDrawer()->addActorsFromCurrentBuffer(renderer());
+	this->qvtkWidget->repaint();
+}
+
+void VisualizerUIWindow::onRendererClick(vtkObject* caller, unsigned long, void* clientData, void*)
+{
+    vtkRenderWindowInteractor* interactor = static_cast<vtkRenderWindowInteractor*>(caller);
+    VisualizerUIWindow* window = static_cast<VisualizerUIWindow*>(clientData);
+    // Graph may be changed by iterating thread while running
+    if (!interactor->GetControlKey() || window->m_runningState != RunningSate::stopped)
+        return;
+
+    int* pos = interactor->GetEventPosition();
+    vtkSmartPointer<vtkWorldPointPicker> picker = vtkSmartPointer<vtkWorldPointPicker>::New();
+    picker->Pick(pos[0], pos[1], 0, window->m_renderer);
+    double world[3];
+    picker->GetPickPosition(world);
+
+    sotm::Node* node = window->m_gui->context()->graphRegister.getNearestNode(sotm::StaticVector<3>(world[0], world[1], world[2]), false);
+    if (!node)
+        return;
+    window->m_gui->graphDrawer()->toggleSelection(node);
+    window->m_gui->snapshotHook()->setSelection(
+        window->m_gui->graphDrawer()->selectedNodes(),
+        window->m_gui->graphDrawer()->selectedLinks()
+    );
+    window->m_clickCallback->SetAbortFlag(1);
+    window->renderCurrentFrame();
+}
+
+void VisualizerUIWindow::onInteractionEnd(vtkObject*, unsigned long, void* clientData, void*)
+{
+    VisualizerUIWindow* window = static_cast<VisualizerUIWindow*>(clientData);
+    window->m_gui->graphDrawer()->updateLevelOfDetail(window->m_renderer);
+    window->qvtkWidget->GetRenderWindow()->Render();
+}
+
 void VisualizerUIWindow::startNextFrameCalculating()
 {
-	m_frameCalculationElapsed.start();
 	emit calculateNextFrame();
 }
 
@@ -200,28 +248,31 @@ void VisualizerUIWindow::on_doubleSpinBoxRedrawPeriod_valueChanged(double arg1)
     if (!m_gui->isStaticGraph())
     {
     	m_gui->asyncIteratorWrapper()->setPeriod(arg1);
+    	m_gui->snapshotHook()->setPeriod(arg1);
     }
 }
 
 void VisualizerUIWindow::on_spinBoxFPS_valueChanged(int arg1)
 {
-    if (!m_gui->isStaticGraph())
-    {
-        //m_gui->animationMaker()->setFps(arg1);
-    }
+    if (!m_gui->isStaticGraph() && m_frameTimer->isActive())
+        m_frameTimer->start(1000 / arg1);
 }
 
 void VisualizerUIWindow::on_pushButtonStartAnimation_clicked()
 {
 	buttonsToRunning();
 	m_runningState = RunningSate::running;
-	startNextFrameCalculating();
+	// Model is iterated without stops, GUI draws latest snapshot with its own frame rate
+	m_gui->asyncIteratorWrapper()->clearStopRequest();
+	emit runContinuously();
+	m_frameTimer->start(1000 / spinBoxFPS->value());
 }
 
 void VisualizerUIWindow::on_pushButtonPauseAnimation_clicked()
 {
 	m_runningState = RunningSate::needToBeStopped;
 	buttonsToNeedToBeStopped();
+	m_gui->asyncIteratorWrapper()->requestStop();
 }
 
 void VisualizerUIWindow::on_horizontalSlider_valueChanged(int value)
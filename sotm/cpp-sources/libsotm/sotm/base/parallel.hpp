@@ -8,6 +8,16 @@
 #ifndef LIBSOTM_SOTM_BASE_PARALLEL_HPP_
 #define LIBSOTM_SOTM_BASE_PARALLEL_HPP_
 
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/blocked_range.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
 struct ParallelSettings
 {
 	struct ContiniousIteration {
@@ -22,10 +32,182 @@ struct ParallelSettings
 		bool prepareBifurcation = false;
 	};
 
+	/// Loops that may run in parallel. Every phase has its own flag, grain size and affinity
+	enum class Phase {
+		calculateSecondaryValues = 0,
+		calculateRHS,
+		addRHSToDelta,
+		makeSubIteration,
+		step,
+		prepareBifurcation,
+		count
+	};
+
+	enum class Partitioner {
+		automatic = 0, ///< tbb::auto_partitioner, grain size is minimal chunk
+		simple,        ///< tbb::simple_partitioner, chunks of exactly grain size
+		affinity,      ///< tbb::affinity_partitioner kept between calls of every phase
+		statics        ///< tbb::static_partitioner, equal chunk for every thread
+	};
+
 	ContiniousIteration parallelContiniousIteration;
 	BifurcationIteration parallelBifurcationIteration;
 
+	/// Minimal count of elements processed by one task, per phase
+	size_t grainSize[size_t(Phase::count)] = {1, 1, 1, 1, 1, 1};
+	Partitioner partitioner = Partitioner::automatic;
+	/// Loops with less elements run serially even if parallel flag is set. 0 to disable
+	size_t serialThreshold = 0;
+	/// Maximal threads count for model loops, 0 for tbb default. Applied by reconfigure()
+	size_t threadsCount = 0;
+	/// Run model loops in own tbb::task_arena isolated from other tbb work of process. Applied by reconfigure()
+	bool isolateArena = false;
+	/**
+	 * Split every parallel loop statically to contiguous parts, one per NUMA node,
+	 * and run every part in task arena with threads bound to CPUs of its node.
+	 * Part of element i is the same for all loops over the same range, so arrays
+	 * written first time by such loop are placed to memory of node that processes them.
+	 *
+	 * Only FirstTouchArray storage is placed this way. Payload objects, including
+	 * charges, are allocated by thread that creates nodes and links, so they stay
+	 * in memory of that thread's node. Applied by reconfigure()
+	 */
+	bool numaAware = false;
+	/// Pin every thread of NUMA arenas to single CPU instead of all CPUs of node. Applied by reconfigure()
+	bool pinThreads = false;
+	/// CPUs of every NUMA node for numaAware. Empty to read system topology. Applied by reconfigure()
+	std::vector<std::vector<int>> numaNodesCpus;
+
 	static ParallelSettings parallelDisabled;
+
+	ParallelSettings();
+	~ParallelSettings();
+	ParallelSettings(const ParallelSettings&) = delete;
+	ParallelSettings& operator=(const ParallelSettings&) = delete;
+
+	/**
+	 * Create task arenas for current threadsCount, isolateArena, numaAware, pinThreads
+	 * and numaNodesCpus. Loops use arenas of the last call, so it should be called after
+	 * changing these fields and never concurrently with running loops
+	 */
+	void reconfigure();
+
+	/// Parallel flag of phase
+	bool enabled(Phase phase) const;
+
+	/// Loop over size elements should run in parallel: phase is enabled and size is not below serialThreshold
+	bool runParallel(Phase phase, size_t size) const;
+
+	/**
+	 * Call body(i) for every i from [begin, end) with tbb::parallel_for using partitioner
+	 * and grain size of phase and inside task arena if needed. Flag of phase is not checked,
+	 * see runParallel()
+	 */
+	template<typename Body>
+	void parallelFor(Phase phase, size_t begin, size_t end, const Body& body) const
+	{
+		if (begin >= end)
+			return;
+
+		// Captured once, so all parts of loop run in the same arenas
+		std::shared_ptr<const Arenas> arenas = m_arenas;
+		size_t nodes = numaNodesCount(*arenas);
+		if (nodes > 1)
+		{
+			numaFor(*arenas, phase, nodes, begin, end, body);
+			return;
+		}
+
+		tbb::task_arena* a = arena(*arenas);
+		if (a)
+			a->execute([this, phase, begin, end, &body]() { loop(phase, partitioner, begin, end, body); });
+		else
+			loop(phase, partitioner, begin, end, body);
+	}
+
+	/// Run parallelFor() if runParallel(), otherwise call body(i) serially
+	template<typename Body>
+	void forEach(Phase phase, size_t size, const Body& body) const
+	{
+		if (runParallel(phase, size))
+		{
+			parallelFor(phase, 0, size, body);
+		} else {
+			for (size_t i = 0; i < size; i++)
+				body(i);
+		}
+	}
+
+	/// Count of NUMA nodes parallelFor() splits loops to, 1 if not numaAware on last reconfigure()
+	size_t numaNodesCount() const;
+
+	/// Part [partBegin, partEnd) of [begin, end) that parallelFor() processes on NUMA node
+	void numaPart(size_t node, size_t begin, size_t end, size_t& partBegin, size_t& partEnd) const;
+
+private:
+	struct Arenas;
+
+	template<typename Body>
+	void loop(Phase phase, Partitioner p, size_t begin, size_t end, const Body& body) const
+	{
+		tbb::blocked_range<size_t> range(begin, end, grainSize[size_t(phase)]);
+		auto rangeBody = [&body](const tbb::blocked_range<size_t>& r)
+		{
+			for (size_t i = r.begin(); i != r.end(); ++i)
+				body(i);
+		};
+		switch (p)
+		{
+		case Partitioner::simple:
+			tbb::parallel_for(range, rangeBody, tbb::simple_partitioner());
+			break;
+		case Partitioner::affinity:
+			tbb::parallel_for(range, rangeBody, m_affinity[size_t(phase)]);
+			break;
+		case Partitioner::statics:
+			tbb::parallel_for(range, rangeBody, tbb::static_partitioner());
+			break;
+		default:
+			tbb::parallel_for(range, rangeBody, tbb::auto_partitioner());
+			break;
+		}
+	}
+
+	template<typename Body>
+	void numaFor(const Arenas& arenas, Phase phase, size_t nodes, size_t begin, size_t end, const Body& body) const
+	{
+		// Affinity partitioner state cannot be shared by concurrent loops, placement is static anyway
+		Partitioner p = partitioner == Partitioner::affinity ? Partitioner::automatic : partitioner;
+		std::vector<tbb::task_group> groups(nodes);
+		for (size_t node = 0; node < nodes; node++)
+		{
+			size_t partBegin, partEnd;
+			numaPart(arenas, node, begin, end, partBegin, partEnd);
+			if (partBegin == partEnd)
+				continue;
+			tbb::task_group& group = groups[node];
+			numaArena(arenas, node).execute([this, &group, phase, p, partBegin, partEnd, &body]() {
+				group.run([this, phase, p, partBegin, partEnd, &body]() { loop(phase, p, partBegin, partEnd, body); });
+			});
+		}
+		for (size_t node = 0; node < nodes; node++)
+		{
+			tbb::task_group& group = groups[node];
+			numaArena(arenas, node).execute([&group]() { group.wait(); });
+		}
+	}
+
+	static size_t numaNodesCount(const Arenas& arenas);
+	static void numaPart(const Arenas& arenas, size_t node, size_t begin, size_t end, size_t& partBegin, size_t& partEnd);
+
+	/// Arena for threadsCount and isolateArena, nullptr if loops run in default arena
+	static tbb::task_arena* arena(const Arenas& arenas);
+
+	/// Arena bound to NUMA node
+	static tbb::task_arena& numaArena(const Arenas& arenas, size_t node);
+
+	mutable tbb::affinity_partitioner m_affinity[size_t(Phase::count)];
+	std::shared_ptr<const Arenas> m_arenas;
 };
 
 #endif /* LIBSOTM_SOTM_BASE_PARALLEL_HPP_ */
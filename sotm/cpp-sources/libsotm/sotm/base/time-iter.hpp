@@ -11,6 +11,7 @@
 #include "sotm/utils/macros.hpp"
 #include "sotm/utils/assert.hpp"
 
+#include <atomic>
 #include <vector>
 #include <limits>
 #include <cstddef>
@@ -272,6 +273,7 @@ public:
 	void stop();
 
 	ContiniousIteratorParameters& continiousIterParameters();
+	const ContiniousIteratorMetrics& metrics();
 
 private:
 	void callHook();
@@ -284,7 +286,7 @@ private:
 
 	double m_nextHookTime = 0;
 	size_t m_nextHook = 0;
-	bool m_needStop = false;
+	std::atomic<bool> m_needStop{false};
 
 	ContiniousIteratorParameters m_contIteratorParameters;
 
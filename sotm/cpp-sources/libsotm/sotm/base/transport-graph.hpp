@@ -6,9 +6,12 @@
 #include "sotm/utils/macros.hpp"
 
 #include <list>
+#include <deque>
 #include <memory>
 #include <set>
 #include <vector>
+#include <unordered_map>
+#include <utility>
 #include <functional>
 #include <mutex>
 
@@ -28,13 +31,90 @@ enum class LinkDirection
 	out = -1
 };
 
+/**
+ * Compressed sparse row snapshot of graph topology for kernels that iterate over
+ * nodes and links many times between graph changes. Nodes and links are referred
+ * by indexes in nodes and links vectors. Links that are not connected yet are skipped
+ */
+class GraphAdjacency
+{
+public:
+	constexpr static size_t noIndex = static_cast<size_t>(-1);
+
+	void build(const std::set<Node*>& nodes, const std::set<Link*>& links);
+
+	/// @return noIndex if node is not in snapshot
+	size_t nodeIndex(const Node* node) const;
+
+	size_t degree(size_t node) const { return rowBegins[node+1] - rowBegins[node]; }
+
+	/// O(log(degree)) check
+	bool hasNeighbour(size_t node, size_t neighbour) const;
+	bool hasNeighbour(const Node* node, const Node* neighbour) const;
+
+	/**
+	 * Split nodes to connected blocks of at most maxBlockSize nodes by breadth-first
+	 * traversal. Every node belongs to exactly one block. Used by block preconditioners
+	 */
+	void partition(size_t maxBlockSize, std::vector<std::vector<size_t>>& blocks) const;
+
+	std::vector<Node*> nodes;
+	std::vector<Link*> links;
+	/// Indexes of getNode1() and getNode2() for every link
+	std::vector<std::pair<size_t, size_t>> linkNodes;
+	std::vector<double> linkLengths;
+
+	/// Neighbours of node i are neighbours[rowBegins[i]] ... neighbours[rowBegins[i+1]-1], sorted
+	std::vector<size_t> rowBegins;
+	std::vector<size_t> neighbours;
+	/// Index of link that connects node with corresponding neighbour
+	std::vector<size_t> neighbourLinks;
+
+private:
+	std::unordered_map<const Node*, size_t> m_nodeIndexes;
+};
+
+/// Entry of GraphRegister change journal
+struct GraphChange
+{
+	enum class Type
+	{
+		nodeAdded = 0,
+		nodeRemoved,
+		linkAdded,
+		linkRemoved
+	};
+
+	Type type;
+	/// Only pointer of type is set. Removed objects may be already destroyed, so use them as keys only
+	Node* node = nullptr;
+	Link* link = nullptr;
+};
+
 class GraphRegister
 {
 public:
+	constexpr static size_t defaultJournalCapacity = 1 << 16;
 
 	using NodeVisitor = std::function<void(Node*)>;
 	using LinkVisitor = std::function<void(Link*)>;
 
+	/**
+	 * Nodes and links added or removed while batch object exists are applied
+	 * to register when it is destroyed, as one change of state hash. Batch
+	 * created inside visitor or other batch is merged to the outer one
+	 */
+	class ChangesBatch
+	{
+	public:
+		ChangesBatch(GraphRegister& graph);
+		~ChangesBatch();
+
+	private:
+		GraphRegister& m_graph;
+		bool m_outer;
+	};
+
 	void addLink(Link* link);
 	void addNode(Node* link);
 
@@ -53,6 +133,9 @@ public:
 	/// Iterate by all links. New nodes should not be added during iteration
     void applyLinkVisitorWithoutGraphChganges(LinkVisitor v, bool optimizeToVector = true);
 
+	/// Nodes of registered link were changed. State hash is changed now or when iterating ends
+	void linkConnected();
+
 	Node* getNearestNode(const StaticVector<3>& point, bool searchOverReceintlyAdded = true);
 
 	size_t nodesCount();
@@ -60,6 +143,25 @@ public:
 
 	size_t stateHash();
 
+	/// Adjacency snapshot of graph. It is rebuilt if graph was changed since last call
+	const GraphAdjacency& adjacency();
+
+	/**
+	 * Position after last change in journal. Consumer that reads whole graph
+	 * should take it before reading and pass to changesSince() later
+	 */
+	size_t journalEnd();
+
+	/**
+	 * Get changes of graph in order they were applied since position and move position to journalEnd().
+	 * @return false if some changes were dropped from journal because of its capacity,
+	 *         consumer should read whole graph again in that case
+	 */
+	bool changesSince(size_t& position, std::vector<GraphChange>& changes);
+
+	/// Journal keeps at most this count of last changes
+	void setJournalCapacity(size_t capacity);
+
 private:
     using NodeSet = std::set<Node*>;
     using LinkSet = std::set<Link*>;
@@ -75,6 +177,8 @@ private:
 
 	void changeStateHash();
 
+	void record(GraphChange::Type type, Node* node, Link* link);
+
     /**
      * @brief This function builds from scratch m_nodesVector and m_linksVector.
      * It uses mutex to protect this objects. In normal case it should not be a problem,
@@ -84,6 +188,8 @@ private:
 
 	/// If true we cannot add/remove directly to/from m_nodes and m_links because we are iterating by them
 	bool m_iteratingNow = false;
+	/// Link was connected while iterating, state hash should be changed when iterating ends
+	bool m_connectionsChanged = false;
 
 	NodeSet m_nodes, m_nodesToAdd, m_nodesToDelete;
 	LinkSet m_links, m_linksToAdd, m_linksToDelete;
@@ -94,6 +200,16 @@ private:
 
     size_t m_stateHash = 1;
     size_t m_nodesLinksVectorsStateHash = 0;
+
+    GraphAdjacency m_adjacency;
+    std::mutex m_adjacencyMutex;
+    size_t m_adjacencyStateHash = 0;
+
+    std::deque<GraphChange> m_journal;
+    /// Position of m_journal.front()
+    size_t m_journalBegin = 0;
+    size_t m_journalCapacity = defaultJournalCapacity;
+    std::mutex m_journalMutex;
 };
 
 class ModelContextDependent
@@ -144,13 +260,19 @@ public:
 	Node* getNode1();
 	Node* getNode2();
 	Node* getNode(unsigned int index);
-	double length();
-	double lengthCached();
+	bool isConnected();
+
+	/// Length and its inverse are calculated once in connect() because nodes positions do not change
+	double length() const { return m_length; }
+	double inverseLength() const { return m_inverseLength; }
+	/// @deprecated The same as length()
+	double lengthCached() const { return m_length; }
 
 	std::unique_ptr<LinkPayloadBase> payload;
 private:
 	PtrWrap<Node> m_n1, m_n2;
-	double m_lengthCached = -1.0;
+	double m_length = 0.0;
+	double m_inverseLength = 0.0;
 };
 
 }
@@ -10,6 +10,7 @@
 
 #include "sotm/math/geometry.hpp"
 #include "sotm/math/generic.hpp"
+#include "sotm/math/integration.hpp"
 
 
 namespace sotm
@@ -33,15 +34,16 @@ struct DistributionResult
 /**
  * Generate direction of discharge from conductive sphere. Normal field on sphere is
  * E_n = E_0*cos(theta) + E_1. Probability of discharge per 1m^2 given by integral
- * distribution function integralDistribution.
+ * distribution function integralDistribution, tabulated once by caller on range
+ * covering [E_1 - 1.5 E_0, E_1 + 1.5 E_0]. It is inverted by lookup in its table
  */
 DistributionResult<SphericalPoint> generateDischargeDirection(
 		double dt,
 		double r,
 		double E0,
 		double E1,
-		Function1D distribution,
-		Function1D integralDistribution
+		const Function1D& distribution,
+		const DefinedIntegral& integralDistribution
 );
 
 }
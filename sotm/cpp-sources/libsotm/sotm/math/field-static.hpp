@@ -0,0 +1,176 @@
+#ifndef FIELD_STATIC_HPP_INCLUDED
+#define FIELD_STATIC_HPP_INCLUDED
+
+#include "sotm/math/field.hpp"
+
+namespace sotm {
+
+/**
+ * Compile-time composable scalar fields. Concrete field types are known to compiler,
+ * so value and gradient calculations may be inlined into calling loop.
+ * StaticFieldAdapter wraps such field to IFieldScalar to use it where type-erased
+ * field is needed, i.e. as ElectrostaticPhysicalContext::externalPotential.
+ * In that case the only virtual call left is valueAndGradient() itself.
+ *
+ * Derived class should implement:
+ *     double value(const StaticVector<SpaceDim>& arg) const;
+ *     void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const;
+ */
+template<typename Derived, int SpaceDim>
+class StaticScalarField
+{
+public:
+	constexpr static int spaceDim = SpaceDim;
+
+	SOTM_INLINE double operator()(const StaticVector<SpaceDim>& arg) const
+	{
+		return derived().value(arg);
+	}
+
+	SOTM_INLINE const Derived& derived() const
+	{
+		return static_cast<const Derived&>(*this);
+	}
+};
+
+/// Linear field amplitude * ((arg - zeroPoint) * direction) with normalized direction
+template<int SpaceDim>
+class StaticLinearScalarField : public StaticScalarField<StaticLinearScalarField<SpaceDim>, SpaceDim>
+{
+public:
+	StaticLinearScalarField(double amplitude, const StaticVector<SpaceDim>& direction, const StaticVector<SpaceDim>& zeroPoint = StaticVector<SpaceDim>()) :
+		m_zeroPoint(zeroPoint),
+		m_direction(direction),
+		m_amplitude(amplitude)
+	{
+		m_direction.normalize();
+	}
+
+	SOTM_INLINE double value(const StaticVector<SpaceDim>& arg) const
+	{
+		return ((arg - m_zeroPoint)*m_direction) * m_amplitude;
+	}
+
+	SOTM_INLINE void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const
+	{
+		value = this->value(arg);
+		gradient = m_direction * m_amplitude;
+	}
+
+private:
+	StaticVector<SpaceDim> m_zeroPoint;
+	StaticVector<SpaceDim> m_direction;
+	double m_amplitude;
+};
+
+/**
+ * Field that depends only on projection to direction: f((arg - zeroPoint) * direction).
+ * Function should have 'double operator()(double) const' and 'double derivative(double) const',
+ * like TrapezoidFunc
+ */
+template<typename Function, int SpaceDim>
+class StaticProjectedField : public StaticScalarField<StaticProjectedField<Function, SpaceDim>, SpaceDim>
+{
+public:
+	StaticProjectedField(const Function& function, const StaticVector<SpaceDim>& direction, const StaticVector<SpaceDim>& zeroPoint = StaticVector<SpaceDim>()) :
+		m_zeroPoint(zeroPoint),
+		m_direction(direction),
+		m_function(function)
+	{
+		m_direction.normalize();
+	}
+
+	SOTM_INLINE double value(const StaticVector<SpaceDim>& arg) const
+	{
+		return m_function((arg - m_zeroPoint)*m_direction);
+	}
+
+	SOTM_INLINE void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const
+	{
+		double s = (arg - m_zeroPoint)*m_direction;
+		value = m_function(s);
+		gradient = m_direction * m_function.derivative(s);
+	}
+
+	const Function& function() const { return m_function; }
+
+private:
+	StaticVector<SpaceDim> m_zeroPoint;
+	StaticVector<SpaceDim> m_direction;
+	Function m_function;
+};
+
+/// Sum of two static fields. Use operator+ to build it
+template<typename Left, typename Right>
+class StaticSumField : public StaticScalarField<StaticSumField<Left, Right>, Left::spaceDim>
+{
+public:
+	constexpr static int SpaceDim = Left::spaceDim;
+	static_assert(Left::spaceDim == Right::spaceDim, "Fields with different space dimensions cannot be summed");
+
+	StaticSumField(const Left& left, const Right& right) :
+		m_left(left), m_right(right)
+	{ }
+
+	SOTM_INLINE double value(const StaticVector<SpaceDim>& arg) const
+	{
+		return m_left.value(arg) + m_right.value(arg);
+	}
+
+	SOTM_INLINE void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const
+	{
+		double rightValue = 0.0;
+		StaticVector<SpaceDim> rightGradient;
+		m_left.valueAndGradient(arg, value, gradient);
+		m_right.valueAndGradient(arg, rightValue, rightGradient);
+		value += rightValue;
+		gradient += rightGradient;
+	}
+
+private:
+	Left m_left;
+	Right m_right;
+};
+
+template<typename Left, typename Right, int SpaceDim>
+StaticSumField<Left, Right> operator+(const StaticScalarField<Left, SpaceDim>& left, const StaticScalarField<Right, SpaceDim>& right)
+{
+	return StaticSumField<Left, Right>(left.derived(), right.derived());
+}
+
+/// Type-erased wrapper of static field
+template<typename StaticField>
+class StaticFieldAdapter final : public Field<1, StaticField::spaceDim>
+{
+public:
+	constexpr static int SpaceDim = StaticField::spaceDim;
+
+	StaticFieldAdapter(const StaticField& field) :
+		m_field(field)
+	{ }
+
+	double operator()(const StaticVector<SpaceDim>& arg) const override
+	{
+		return m_field.value(arg);
+	}
+
+	void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const override
+	{
+		m_field.valueAndGradient(arg, value, gradient);
+	}
+
+	const StaticField& field() const { return m_field; }
+
+private:
+	StaticField m_field;
+};
+
+template<typename StaticField>
+StaticFieldAdapter<StaticField>* makeStaticFieldAdapter(const StaticField& field)
+{
+	return new StaticFieldAdapter<StaticField>(field);
+}
+
+}  // namespace sotm
+
+#endif // FIELD_STATIC_HPP_INCLUDED
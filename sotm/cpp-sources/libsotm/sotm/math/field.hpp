@@ -25,8 +25,26 @@ template<int SpaceDim>
 class IFieldScalar
 {
 public:
+	constexpr static double defaultGradientStep = 1e-2;
+
 	virtual ~IFieldScalar() {}
 	virtual double operator()(const StaticVector<SpaceDim>& arg) const = 0;
+
+	/**
+	 * Get value and gradient in one call. Fields that know their gradient analytically
+	 * should override it, default implementation uses forward finite difference
+	 */
+	virtual void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const
+	{
+		value = (*this)(arg);
+		StaticVector<SpaceDim> moved = arg;
+		for (int i=0; i<SpaceDim; i++)
+		{
+			moved.x[i] += defaultGradientStep;
+			gradient.x[i] = ((*this)(moved) - value) / defaultGradientStep;
+			moved.x[i] -= defaultGradientStep;
+		}
+	}
 };
 
 template<int ValueDim, int SpaceDim>
@@ -70,6 +88,13 @@ class FieldScalarZero : public Field<1, SpaceDim>
 public:
 	double operator()(const StaticVector<SpaceDim>& arg) const override
 		{ return 0.0; }
+
+	void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const override
+	{
+		value = 0.0;
+		for (int i=0; i<SpaceDim; i++)
+			gradient.x[i] = 0.0;
+	}
 };
 
 template<int ValueDim, int SpaceDim>
@@ -108,6 +133,12 @@ public:
         return ((arg - m_zeroPoint)*m_direction) * m_amplitude;
 	}
 
+	void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const override
+	{
+		value = (*this)(arg);
+		gradient = m_direction * m_amplitude;
+	}
+
 private:
 
 	const StaticVector<SpaceDim> m_zeroPoint;
@@ -127,16 +158,35 @@ public:
 		m_direction.normalize();
 	}
 
+	/// @param derivative Derivative of func, it is used for analytic gradient
+	FieldScalar1D(Function1D func, Function1D derivative, const StaticVector<SpaceDim>& direction, const StaticVector<SpaceDim>& zeroPoint = StaticVector<SpaceDim>()) :
+		FieldScalar1D(func, direction, zeroPoint)
+	{
+		m_derivative = derivative;
+	}
+
 	double operator()(const StaticVector<SpaceDim>& arg) const override
 	{
         return m_function( (arg - m_zeroPoint)*m_direction );
 	}
 
+	void valueAndGradient(const StaticVector<SpaceDim>& arg, double& value, StaticVector<SpaceDim>& gradient) const override
+	{
+		if (!m_derivative)
+		{
+			IFieldScalar<SpaceDim>::valueAndGradient(arg, value, gradient);
+			return;
+		}
+		double s = (arg - m_zeroPoint)*m_direction;
+		value = m_function(s);
+		gradient = m_direction * m_derivative(s);
+	}
 
 private:
 	const StaticVector<SpaceDim> m_zeroPoint;
 	StaticVector<SpaceDim> m_direction;
 	Function1D m_function;
+	Function1D m_derivative;
 };
 
 ////////////////////
@@ -15,8 +15,9 @@ class TrapezoidFunc
 public:
 	TrapezoidFunc(double amplitude, double zScale, double zRecession, double z0 = 0);
 
-	double operator()(double z);
-	double maxAbs();
+	double operator()(double z) const;
+	double derivative(double z) const;
+	double maxAbs() const;
 private:
 	double m_z0;
 	double m_amplitude;
@@ -2,7 +2,11 @@
 #define GEOMETRY_HPP_INCLUDED
 
 
+#include "sotm/utils/macros.hpp"
+
+#include <cstddef>
 #include <cstring>
+#include <sstream>
 #include <string>
 #include <cmath>
 #include <complex>
@@ -17,31 +21,52 @@ struct SphericalPoint
 };
 
 
+/**
+ * Count of elements allocated for vector of dimension dim. Three-dimensional vectors
+ * are padded to four elements, so elementwise loops have power of two length and
+ * are compiled to full width SIMD operations without scalar tail. Padding lanes are
+ * initialized with zero by constructors and are never used in reductions
+ */
+template<int dim>
+struct StaticVectorStorage
+{
+    static constexpr int size = dim;
+};
+
+template<>
+struct StaticVectorStorage<3>
+{
+    static constexpr int size = 4;
+};
+
 template<int dim, typename Type = double>
 class StaticVector
 {
 public:
     using VectorType = StaticVector<dim, Type>;
+    static constexpr int storageSize = StaticVectorStorage<dim>::size;
 
     StaticVector(const Type* coords)
     {
-        memcpy(x, coords, sizeof(Type)*dim);
+        for (int i=0; i<dim; i++)
+            x[i] = coords[i];
+        clearPadding();
     }
 
     StaticVector(std::initializer_list<Type> initList)
     {
+        for (int i=0; i<storageSize; i++)
+            x[i] = 0;
         *this = initList;
     }
 
-    StaticVector(const VectorType& right)
-    {
-        *this = right;
-    }
+    StaticVector(const VectorType& right) = default;
 
     StaticVector(Type x_, Type y_, Type z_)
     {
         static_assert (dim == 3, "Constructor with 3 args applicable only for dimension = 3");
         x[0] = x_; x[1] = y_; x[2] = z_;
+        clearPadding();
     }
 
     StaticVector(Type x_, Type y_)
@@ -58,7 +83,8 @@ public:
 
     StaticVector()
     {
-        memset(x, 0, sizeof(x[0])*dim);
+        for (int i=0; i<storageSize; i++)
+            x[i] = 0;
     }
 
     template<typename CastType>
@@ -71,22 +97,18 @@ public:
         return result;
     }
 
-    double norm() const
+    Type normSquared() const
     {
-        double result = 0;
-        for (int i=0; i<dim; i++)
-        {
-            result += std::norm(x[i]);
-        }
-        return std::sqrt(result);
+        return (*this) * (*this);
     }
 
-    VectorType& operator=(const VectorType& right)
+    double norm() const
     {
-        memcpy(x, right.x, sizeof(Type) * dim);
-        return *this;
+        return std::sqrt(double(normSquared()));
     }
 
+    VectorType& operator=(const VectorType& right) = default;
+
     VectorType& operator=(const std::initializer_list<Type>& initList)
     {
         Type* px = this->x;
@@ -95,10 +117,14 @@ public:
         return *this;
     }
 
+    // Padding lanes are zero, so addition, subtraction and negation keep them zero
+    // and may run over all storage. Multiplication and division by scalar
+    // run over dim only: 0 * inf or 0 / 0 in padding would raise FE_INVALID
+
     VectorType operator-() const
     {
         VectorType result;
-        for (int i=0; i<dim; ++i)
+        for (int i=0; i<storageSize; ++i)
             result.x[i] = -x[i];
         return result;
     }
@@ -106,7 +132,7 @@ public:
     VectorType operator-(const VectorType& right) const
     {
         VectorType result;
-        for (int i=0; i<dim; ++i)
+        for (int i=0; i<storageSize; ++i)
             result.x[i] = x[i] - right.x[i];
         return result;
     }
@@ -114,21 +140,21 @@ public:
     VectorType operator+(const VectorType& right) const
     {
         VectorType result;
-        for (int i=0; i<dim; ++i)
+        for (int i=0; i<storageSize; ++i)
             result.x[i] = x[i] + right.x[i];
         return result;
     }
 
     VectorType& operator+=(const VectorType& right)
     {
-        for (int i=0; i<dim; ++i)
+        for (int i=0; i<storageSize; ++i)
             x[i] += right.x[i];
         return *this;
     }
 
     VectorType& operator-=(const VectorType& right)
     {
-        for (int i=0; i<dim; ++i)
+        for (int i=0; i<storageSize; ++i)
             x[i] -= right.x[i];
         return *this;
     }
@@ -224,9 +250,77 @@ public:
             x[i] /= l;
     }
 
-    Type x[dim];
+    Type x[storageSize];
+
+private:
+    void clearPadding()
+    {
+        for (int i=dim; i<storageSize; i++)
+            x[i] = 0;
+    }
 };
 
+/**
+ * Fused helpers for inner loops of kernels: no temporary vector is created
+ * and reductions run over dim only
+ */
+template<int dim, typename Type>
+inline Type dot(const StaticVector<dim, Type>& a, const StaticVector<dim, Type>& b)
+{
+    Type result = 0;
+    for (int i=0; i<dim; i++)
+        result += a.x[i] * b.x[i];
+    return result;
+}
+
+template<int dim, typename Type>
+inline Type distanceSquared(const StaticVector<dim, Type>& a, const StaticVector<dim, Type>& b)
+{
+    Type result = 0;
+    for (int i=0; i<dim; i++)
+    {
+        Type d = a.x[i] - b.x[i];
+        result += d * d;
+    }
+    return result;
+}
+
+template<int dim, typename Type>
+inline double distance(const StaticVector<dim, Type>& a, const StaticVector<dim, Type>& b)
+{
+    return std::sqrt(double(distanceSquared(a, b)));
+}
+
+/**
+ * Bulk operations over arrays of vectors. Arrays should not overlap,
+ * that allows compiler to vectorize loops over whole arrays
+ */
+
+/// result[i] = |point - points[i]|^2
+template<int dim, typename Type>
+void distancesSquared(
+    const StaticVector<dim, Type>& point,
+    const StaticVector<dim, Type>* SOTM_RESTRICT points,
+    Type* SOTM_RESTRICT result,
+    size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        result[i] = distanceSquared(point, points[i]);
+}
+
+/// target[i] += factor * source[i]
+template<int dim, typename Type>
+void addScaled(
+    StaticVector<dim, Type>* SOTM_RESTRICT target,
+    const StaticVector<dim, Type>* SOTM_RESTRICT source,
+    Type factor,
+    size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        for (int j = 0; j < dim; j++)
+            target[i].x[j] += factor * source[i].x[j];
+}
+
 template<int dim, typename T1, typename T2>
 StaticVector<dim, T2> operator*(const T1& left, const StaticVector<dim, T2>& right)
 {
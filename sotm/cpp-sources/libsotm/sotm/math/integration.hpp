@@ -11,14 +11,26 @@
 #include "sotm/math/generic.hpp"
 
 #include <vector>
+#include <cstddef>
 
 namespace sotm {
 
+/**
+ * Tabulated integral of target from 'from' to argument. Values between table points
+ * are linearly interpolated
+ */
 class DefinedIntegral
 {
 public:
 	DefinedIntegral(Function1D target, double from, double to, size_t pointsCount);
-	double operator()(double arg);
+	double operator()(double arg) const;
+
+	/**
+	 * Find arg from [from, to] where integral is equal to value. Target should be non-negative,
+	 * so integral is non-decreasing. Binary search by table without target calls
+	 * @return false if value is out of integral values on [from, to]
+	 */
+	bool inverse(double value, double from, double to, double& arg) const;
 
 	// Use this to prevent copying to whole object to wrapper
 	Function1D function()
@@ -30,8 +42,12 @@ public:
 	}
 
 private:
+	double pointArg(size_t index) const;
+	size_t pointIndex(double arg) const;
+
 	std::vector<double> m_results;
 	double m_from, m_to;
+	double m_dx;
 };
 
 }  // namespace sotm
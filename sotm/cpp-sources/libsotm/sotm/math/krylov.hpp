@@ -0,0 +1,298 @@
+#ifndef KRYLOV_HPP_INCLUDED
+#define KRYLOV_HPP_INCLUDED
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace sotm {
+
+/**
+ * Matrix-free Krylov solvers for linear systems A x = b.
+ *
+ * Operator is any callable 'void(const std::vector<double>& x, std::vector<double>& result)'
+ * that calculates result = A x. Preconditioner has the same signature and calculates
+ * z = M^-1 r. Vectors passed to both have the size of b.
+ */
+
+struct KrylovResult
+{
+    size_t iterations = 0;
+    /// Residual norm relative to |b|
+    double relativeResidual = 0.0;
+    bool converged = false;
+};
+
+inline double krylovDot(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double result = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+        result += a[i] * b[i];
+    return result;
+}
+
+struct IdentityPreconditioner
+{
+    void operator()(const std::vector<double>& r, std::vector<double>& z) const
+    {
+        z = r;
+    }
+};
+
+/**
+ * Preconditioned conjugate gradient for symmetric positive definite A.
+ * x is used as initial guess and contains solution after return
+ */
+template<typename Operator, typename Preconditioner>
+KrylovResult conjugateGradient(
+        const Operator& A,
+        const Preconditioner& M,
+        const std::vector<double>& b,
+        std::vector<double>& x,
+        double relativeTolerance,
+        size_t maxIterations)
+{
+    KrylovResult result;
+    size_t n = b.size();
+    x.resize(n, 0.0);
+
+    double bNorm = std::sqrt(krylovDot(b, b));
+    if (bNorm == 0.0)
+    {
+        x.assign(n, 0.0);
+        result.converged = true;
+        return result;
+    }
+
+    std::vector<double> r(n), z(n), p(n), Ap(n);
+    A(x, Ap);
+    for (size_t i = 0; i < n; i++)
+        r[i] = b[i] - Ap[i];
+
+    result.relativeResidual = std::sqrt(krylovDot(r, r)) / bNorm;
+    if (result.relativeResidual <= relativeTolerance)
+    {
+        result.converged = true;
+        return result;
+    }
+
+    M(r, z);
+    p = z;
+    double rz = krylovDot(r, z);
+
+    while (result.iterations < maxIterations)
+    {
+        result.iterations++;
+        A(p, Ap);
+        double pAp = krylovDot(p, Ap);
+        if (pAp <= 0.0)
+            break; // Operator is not positive definite or solution is exact already
+
+        double alpha = rz / pAp;
+        for (size_t i = 0; i < n; i++)
+        {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+        }
+
+        result.relativeResidual = std::sqrt(krylovDot(r, r)) / bNorm;
+        if (result.relativeResidual <= relativeTolerance)
+        {
+            result.converged = true;
+            break;
+        }
+
+        M(r, z);
+        double rzNext = krylovDot(r, z);
+        double beta = rzNext / rz;
+        rz = rzNext;
+        for (size_t i = 0; i < n; i++)
+            p[i] = z[i] + beta * p[i];
+    }
+    return result;
+}
+
+template<typename Operator>
+KrylovResult conjugateGradient(
+        const Operator& A,
+        const std::vector<double>& b,
+        std::vector<double>& x,
+        double relativeTolerance,
+        size_t maxIterations)
+{
+    return conjugateGradient(A, IdentityPreconditioner(), b, x, relativeTolerance, maxIterations);
+}
+
+/**
+ * Restarted GMRES with right preconditioning for general nonsingular A.
+ * x is used as initial guess and contains solution after return.
+ * Iterations are counted over all restarts
+ */
+template<typename Operator, typename Preconditioner>
+KrylovResult gmres(
+        const Operator& A,
+        const Preconditioner& M,
+        const std::vector<double>& b,
+        std::vector<double>& x,
+        double relativeTolerance,
+        size_t restart,
+        size_t maxIterations)
+{
+    KrylovResult result;
+    size_t n = b.size();
+    x.resize(n, 0.0);
+    restart = std::max<size_t>(1, std::min(restart, n));
+
+    double bNorm = std::sqrt(krylovDot(b, b));
+    if (bNorm == 0.0)
+    {
+        x.assign(n, 0.0);
+        result.converged = true;
+        return result;
+    }
+
+    std::vector<std::vector<double>> V(restart + 1, std::vector<double>(n));
+    std::vector<std::vector<double>> Z(restart, std::vector<double>(n));
+    // Hessenberg matrix by columns
+    std::vector<std::vector<double>> H(restart, std::vector<double>(restart + 1));
+    std::vector<double> cs(restart), sn(restart), g(restart + 1), w(n);
+
+    for (;;)
+    {
+        A(x, w);
+        for (size_t i = 0; i < n; i++)
+            V[0][i] = b[i] - w[i];
+        double beta = std::sqrt(krylovDot(V[0], V[0]));
+        result.relativeResidual = beta / bNorm;
+        if (result.relativeResidual <= relativeTolerance)
+        {
+            result.converged = true;
+            return result;
+        }
+        if (result.iterations >= maxIterations)
+            return result;
+
+        for (size_t i = 0; i < n; i++)
+            V[0][i] /= beta;
+        std::fill(g.begin(), g.end(), 0.0);
+        g[0] = beta;
+
+        size_t k = 0;
+        for (; k < restart && result.iterations < maxIterations; k++)
+        {
+            result.iterations++;
+            M(V[k], Z[k]);
+            A(Z[k], w);
+
+            // Modified Gram-Schmidt
+            for (size_t j = 0; j <= k; j++)
+            {
+                H[k][j] = krylovDot(w, V[j]);
+                for (size_t i = 0; i < n; i++)
+                    w[i] -= H[k][j] * V[j][i];
+            }
+            H[k][k+1] = std::sqrt(krylovDot(w, w));
+            if (H[k][k+1] != 0.0)
+            {
+                for (size_t i = 0; i < n; i++)
+                    V[k+1][i] = w[i] / H[k][k+1];
+            }
+
+            // Apply previous rotations and calculate new one
+            for (size_t j = 0; j < k; j++)
+            {
+                double t = cs[j] * H[k][j] + sn[j] * H[k][j+1];
+                H[k][j+1] = -sn[j] * H[k][j] + cs[j] * H[k][j+1];
+                H[k][j] = t;
+            }
+            double r = std::hypot(H[k][k], H[k][k+1]);
+            cs[k] = r == 0.0 ? 1.0 : H[k][k] / r;
+            sn[k] = r == 0.0 ? 0.0 : H[k][k+1] / r;
+            H[k][k] = r;
+            H[k][k+1] = 0.0;
+            g[k+1] = -sn[k] * g[k];
+            g[k] = cs[k] * g[k];
+
+            result.relativeResidual = std::fabs(g[k+1]) / bNorm;
+            if (result.relativeResidual <= relativeTolerance)
+            {
+                k++;
+                break;
+            }
+        }
+
+        // Solve upper triangular system and update x
+        std::vector<double> y(k);
+        for (size_t jj = k; jj-- > 0; )
+        {
+            double sum = g[jj];
+            for (size_t l = jj + 1; l < k; l++)
+                sum -= H[l][jj] * y[l];
+            y[jj] = H[jj][jj] == 0.0 ? 0.0 : sum / H[jj][jj];
+        }
+        for (size_t j = 0; j < k; j++)
+            for (size_t i = 0; i < n; i++)
+                x[i] += y[j] * Z[j][i];
+    }
+}
+
+template<typename Operator>
+KrylovResult gmres(
+        const Operator& A,
+        const std::vector<double>& b,
+        std::vector<double>& x,
+        double relativeTolerance,
+        size_t restart,
+        size_t maxIterations)
+{
+    return gmres(A, IdentityPreconditioner(), b, x, relativeTolerance, restart, maxIterations);
+}
+
+/**
+ * Block-Jacobi preconditioner: z = diag(A_11^-1, A_22^-1, ...) r where A_ii are
+ * dense diagonal blocks of operator. Blocks are usually taken from graph partition,
+ * see GraphAdjacency::partition(). Every block is LU-factorized once by build()
+ */
+class BlockJacobiPreconditioner
+{
+public:
+    /**
+     * @param blocks Indexes of every block. Every index from [0, size) should be in one block
+     * @param entry Callable 'double(size_t i, size_t j)' that gives element A_ij
+     */
+    template<typename Entry>
+    void build(const std::vector<std::vector<size_t>>& blocks, const Entry& entry)
+    {
+        m_blocks = blocks;
+        m_factors.resize(blocks.size());
+        m_pivots.resize(blocks.size());
+        for (size_t b = 0; b < blocks.size(); b++)
+        {
+            const std::vector<size_t>& block = blocks[b];
+            size_t n = block.size();
+            std::vector<double>& lu = m_factors[b];
+            lu.resize(n * n);
+            for (size_t i = 0; i < n; i++)
+                for (size_t j = 0; j < n; j++)
+                    lu[i*n + j] = entry(block[i], block[j]);
+            factorize(lu, m_pivots[b], n);
+        }
+    }
+
+    void operator()(const std::vector<double>& r, std::vector<double>& z) const;
+
+    size_t blocksCount() const { return m_blocks.size(); }
+
+private:
+    /// In-place LU decomposition with partial pivoting
+    static void factorize(std::vector<double>& lu, std::vector<size_t>& pivots, size_t n);
+
+    std::vector<std::vector<size_t>> m_blocks;
+    std::vector<std::vector<double>> m_factors;
+    std::vector<std::vector<size_t>> m_pivots;
+};
+
+}  // namespace sotm
+
+#endif // KRYLOV_HPP_INCLUDED
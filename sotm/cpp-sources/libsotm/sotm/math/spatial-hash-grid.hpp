@@ -0,0 +1,175 @@
+#ifndef SPATIAL_HASH_GRID_HPP_INCLUDED
+#define SPATIAL_HASH_GRID_HPP_INCLUDED
+
+#include "sotm/math/geometry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sotm {
+
+/// Cell indexing shared by all SpatialHashGridT instantiations
+class SpatialHashGridBase
+{
+public:
+    double cellSize() const { return m_cellSize; }
+
+protected:
+    using Key = uint64_t;
+
+    SpatialHashGridBase(double cellSize);
+
+    int64_t cellIndex(double coordinate) const;
+    /// Different cells may have the same key, that only merges their points
+    static Key key(int64_t ix, int64_t iy, int64_t iz);
+    Key key(const StaticVector<3>& point) const;
+
+    double m_cellSize;
+};
+
+/**
+ * Points in unbounded space bucketed by cubic cells. Only occupied cells are stored,
+ * so memory does not depend on size of area. Search near point visits only cells
+ * that may contain points within given distance, that is O(1) when distance is
+ * comparable with cell size and points are not denser than one per cell.
+ * Search with distance much greater than cell size visits occupied cells instead
+ * if there are less of them.
+ *
+ * Every point may carry Value, for example pointer to object placed there.
+ *
+ * Useful for Poisson-disk style sampling: insert accepted points with cell size
+ * equal to minimal distance and test candidates with hasPointCloser()
+ */
+template<typename Value>
+class SpatialHashGridT : public SpatialHashGridBase
+{
+public:
+    SpatialHashGridT(double cellSize) : SpatialHashGridBase(cellSize) { }
+
+    void insert(const StaticVector<3>& point, const Value& value = Value())
+    {
+        m_cells[key(point)].push_back(Entry{point, value});
+        m_size++;
+    }
+
+    /// Remove one point inserted with the same position and value. @return false if there is no such point
+    bool erase(const StaticVector<3>& point, const Value& value)
+    {
+        auto cell = m_cells.find(key(point));
+        if (cell == m_cells.end())
+            return false;
+        std::vector<Entry>& entries = cell->second;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].value == value && entries[i].point == point)
+            {
+                entries[i] = entries.back();
+                entries.pop_back();
+                if (entries.empty())
+                    m_cells.erase(cell);
+                m_size--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        m_cells.clear();
+        m_size = 0;
+    }
+
+    /// True if some inserted point is strictly closer than distance to point
+    bool hasPointCloser(const StaticVector<3>& point, double distance) const
+    {
+        return nearest(point, distance, true) != nullptr;
+    }
+
+    /**
+     * Nearest of points that are strictly closer than distance to point
+     * @return false if there is no such point, result is not changed then
+     */
+    bool findNearest(const StaticVector<3>& point, double distance, Value& result) const
+    {
+        const Entry* entry = nearest(point, distance, false);
+        if (entry == nullptr)
+            return false;
+        result = entry->value;
+        return true;
+    }
+
+    size_t size() const { return m_size; }
+
+private:
+    struct Entry
+    {
+        StaticVector<3> point;
+        Value value;
+    };
+
+    /// @param any Return the first found point instead of the nearest
+    const Entry* nearest(const StaticVector<3>& point, double distance, bool any) const
+    {
+        if (m_size == 0 || distance <= 0.0)
+            return nullptr;
+
+        double minDistanceSquared = distance * distance;
+        const Entry* result = nullptr;
+        // @return true if search may be finished
+        auto visit = [&](const std::vector<Entry>& entries) -> bool
+        {
+            for (const auto& entry : entries)
+            {
+                double d = distanceSquared(point, entry.point);
+                if (d < minDistanceSquared)
+                {
+                    minDistanceSquared = d;
+                    result = &entry;
+                    if (any)
+                        return true;
+                }
+            }
+            return false;
+        };
+
+        int64_t from[3], to[3];
+        double boxCells = 1.0;
+        for (int i = 0; i < 3; i++)
+        {
+            from[i] = cellIndex(point[i] - distance);
+            to[i] = cellIndex(point[i] + distance);
+            boxCells *= double(to[i] - from[i] + 1);
+        }
+
+        if (boxCells > double(m_cells.size()))
+        {
+            for (const auto& cell : m_cells)
+                if (visit(cell.second))
+                    break;
+            return result;
+        }
+
+        for (int64_t ix = from[0]; ix <= to[0]; ix++)
+            for (int64_t iy = from[1]; iy <= to[1]; iy++)
+                for (int64_t iz = from[2]; iz <= to[2]; iz++)
+                {
+                    auto it = m_cells.find(SpatialHashGridBase::key(ix, iy, iz));
+                    if (it != m_cells.end() && visit(it->second))
+                        return result;
+                }
+        return result;
+    }
+
+    size_t m_size = 0;
+    std::unordered_map<Key, std::vector<Entry>> m_cells;
+};
+
+/// Grid of points without values
+using SpatialHashGrid = SpatialHashGridT<std::nullptr_t>;
+
+}
+
+#endif // SPATIAL_HASH_GRID_HPP_INCLUDED
@@ -5,36 +5,58 @@
 
 namespace sotm {
 
-class CoulombBruteForce : public IColoumbCalculator
+/**
+ * Direct summation over all nodes. Positions relative to nodes centre are copied to
+ * Storage type arrays when nodes set changes, charges are read from nodes on every call.
+ * Kernel is evaluated in Storage type and sum is accumulated in Accumulator.
+ *
+ * CoulombBruteForceT<float, double> halves positions memory traffic and doubles SIMD width
+ * of kernel. Rounding of stored coordinates is about float epsilon multiplied by size of
+ * nodes cloud, so pairs closer than nearFraction of this size are evaluated in double
+ * from node positions. Relative error of result is about 1e-6. It is the only mixed
+ * precision calculator, octree and distributed ones calculate in double
+ */
+template<typename Storage, typename Accumulator = double>
+class CoulombBruteForceT : public IColoumbCalculator
 {
 public:
-    CoulombBruteForce(GraphRegister& graph);
+    CoulombBruteForceT(GraphRegister& graph);
     FieldPotential getFP(StaticVector<3> pos, CoulombNodeBase* exclude = nullptr) override;
 
-    /**
-     * @brief build positive and negative octree
-     */
     void rebuildOptimization() override;
 
     CoulombNodeBase* makeNode(double& charge, Node& thisNode) override;
     void getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distace) override;
+    std::unique_ptr<IColoumbCalculator> makeEmptyCopy() const override;
 
 private:
     void addCN(CoulombNodeBase& cn) override;
     void removeCN(CoulombNodeBase& cn) override;
     void buildNodesVector();
+    void sum(FieldPotentialT<Accumulator>& result, const StaticVector<3>& pos, const Storage* target, Storage nearSquared, size_t begin, size_t end) const;
 
     GraphRegister& m_graph;
     /// @todo Use unordered_set
     //std::set<CoulombNode*> m_nodesIsolated;
     std::set<CoulombNodeBruteForce*> m_nodesNotIsolated;
     std::vector<CoulombNodeBruteForce*> m_nodesNotIsolatedVector;
-    bool m_vectorDirty = true;
+    /// Vector is rebuilt from set after removals, additions keep order of adding
+    bool m_vectorDirty = false;
+    bool m_arraysDirty = true;
+
+    StaticVector<3> m_origin;
+    /// Maximal coordinate of nodes relative to m_origin
+    double m_extent = 0.0;
+    std::vector<Storage> m_x, m_y, m_z;
+    std::vector<const double*> m_charges;
 };
 
+using CoulombBruteForce = CoulombBruteForceT<double, double>;
+using CoulombBruteForceMixed = CoulombBruteForceT<float, double>;
+
 class CoulombNodeBruteForce : public CoulombNodeBase
 {
-friend class CoulombBruteForce;
+template<typename, typename> friend class CoulombBruteForceT;
 public:
     CoulombNodeBruteForce(IColoumbCalculator& co, double& charge, Node& thisNode);
     ~CoulombNodeBruteForce();
@@ -47,8 +69,13 @@ private:
     IColoumbCalculator &m_co;
     double m_isolatedPotential = 0;
     StaticVector<3> m_isolatedField{0.0, 0.0, 0.0};
+    /// Index in arrays of calculator
+    size_t m_index = 0;
 };
 
+extern template class CoulombBruteForceT<double, double>;
+extern template class CoulombBruteForceT<float, double>;
+
 }
 
 #endif // COULOMB_BRUTE_FORCE_HPP
@@ -0,0 +1,127 @@
+#ifndef COULOMB_DISTRIBUTED_HPP
+#define COULOMB_DISTRIBUTED_HPP
+
+#include "sotm/optimizers/coulomb.hpp"
+#include "sotm/base/parallel.hpp"
+
+#include <mpi.h>
+
+#include <set>
+#include <vector>
+
+namespace sotm {
+
+class CoulombNodeDistributed;
+
+struct DistributedCoulombParameters
+{
+    /// Edge of cubic cells that are summarized by charge and dipole moment for far field
+    double cellSize = 1.0;
+    /// Cell is in far field of target if cell radius < theta * distance to cell center
+    double theta = 0.2;
+    /// Evaluate targets of every rank with ParallelSettings::parallelFor()
+    bool parallel = true;
+    /// Maximal threads count of every rank, 0 for tbb default
+    size_t threadsCount = 0;
+};
+
+/**
+ * Coulomb calculator with spatial domain decomposition over MPI ranks.
+ *
+ * Model runs on rank 0, other ranks serve field evaluation in runWorker().
+ * On every rebuildOptimization() nodes are split to slabs along the longest extent
+ * of the graph, one slab per rank, and every rank:
+ *  - summarizes cells of its domain by charge and dipole moment and shares summaries;
+ *  - sends nodes of its cells to ranks whose domain has the cell in near field (halo);
+ *  - calculates field at its nodes walking hierarchy of cell summaries of all ranks:
+ *    blocks of cells in far field by merged summary, near cells exactly.
+ * Results are gathered to rank 0 and returned by node getFP() until next rebuild,
+ * so charges should not change between rebuildOptimization() and getFP() calls.
+ *
+ * Only field calculation is distributed: the model with all nodes lives on rank 0,
+ * and it scatters positions and charges of all nodes and gathers all results on every
+ * rebuild. So memory of rank 0 is not reduced, and that traffic is O(nodes) per rebuild.
+ *
+ * Nodes created after last rebuild and arbitrary points are calculated on rank 0 exactly.
+ * Rank 0 should call stopWorkers() when calculations are finished, see WorkersStopper
+ */
+class CoulombDistributed : public IColoumbCalculator
+{
+public:
+    struct Stats
+    {
+        size_t evaluations = 0;
+        size_t cells = 0;
+        /// Nodes sent to other ranks as halo in last evaluation
+        size_t haloNodes = 0;
+    };
+
+    CoulombDistributed(GraphRegister& graph, MPI_Comm comm = MPI_COMM_WORLD,
+                       const DistributedCoulombParameters& parameters = DistributedCoulombParameters());
+
+    FieldPotential getFP(StaticVector<3> pos, CoulombNodeBase* exclude = nullptr) override;
+    CoulombNodeBase* makeNode(double& charge, Node& thisNode) override;
+    void getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distance) override;
+    std::unique_ptr<IColoumbCalculator> makeEmptyCopy() const override;
+
+    /// Collective for all ranks of communicator: distributed field calculation at all nodes
+    void rebuildOptimization() override;
+
+    const Stats& stats() const { return m_stats; }
+
+    /// Serve rebuildOptimization() calls of rank 0 until stopWorkers(). For ranks other than 0
+    static void runWorker(MPI_Comm comm = MPI_COMM_WORLD);
+
+    /// Finish runWorker() on other ranks. For rank 0
+    static void stopWorkers(MPI_Comm comm = MPI_COMM_WORLD);
+
+    /// Calls stopWorkers() when destroyed, so workers finish even if rank 0 leaves by exception
+    class WorkersStopper
+    {
+    public:
+        WorkersStopper(MPI_Comm comm = MPI_COMM_WORLD) : m_comm(comm) { }
+        ~WorkersStopper() { stopWorkers(m_comm); }
+
+        WorkersStopper(const WorkersStopper&) = delete;
+        WorkersStopper& operator=(const WorkersStopper&) = delete;
+
+    private:
+        MPI_Comm m_comm;
+    };
+
+private:
+    friend class CoulombNodeDistributed;
+
+    void addCN(CoulombNodeBase& cn) override;
+    void removeCN(CoulombNodeBase& cn) override;
+
+    GraphRegister& m_graph;
+    MPI_Comm m_comm;
+    DistributedCoulombParameters m_parameters;
+    /// Settings of rank 0, workers have their own
+    ParallelSettings m_parallelSettings;
+
+    std::set<CoulombNodeDistributed*> m_nodes;
+    /// Index of last evaluation, node results with other index are outdated
+    size_t m_evaluation = 0;
+    Stats m_stats;
+};
+
+class CoulombNodeDistributed : public CoulombNodeBase
+{
+friend class CoulombDistributed;
+public:
+    CoulombNodeDistributed(CoulombDistributed& co, double& charge, Node& thisNode);
+    ~CoulombNodeDistributed();
+
+    FieldPotential getFP() override;
+
+private:
+    CoulombDistributed& m_co;
+    FieldPotential m_result;
+    size_t m_evaluation = 0;
+};
+
+}
+
+#endif // COULOMB_DISTRIBUTED_HPP
@@ -4,6 +4,9 @@
 #include "sotm/optimizers/coulomb.hpp"
 #include "octree.hpp"
 
+#include <memory>
+#include <vector>
+
 namespace sotm {
 
 class CoulombNodeOctree;
@@ -19,30 +22,92 @@ public:
 };
 
 
+/**
+ * Parameters of octree scales automatic selection. Octree field is compared with exact
+ * sum at sample points and the cheapest of linear and discrete candidates satisfying
+ * error bound is selected
+ */
+struct OctreeAutoTuning
+{
+    /// Bound for RMS relative error of field and potential at sample points
+    double maxRelativeError = 0.01;
+    /// Count of target points where exact sum is calculated
+    size_t samples = 64;
+    /// Scales are tuned again when nodes count grows this times since last tuning
+    double retuneGrowth = 10.0;
+    /// Candidates for LinearScales coefficient. Bigger coefficient means cheaper and less precise calculation
+    std::vector<double> linearCandidates{0.02, 0.05, 0.1, 0.2, 0.3, 0.5, 0.7, 1.0};
+    /// Candidates for DiscreteScales. They depend on model size, so there are no defaults
+    std::vector<std::shared_ptr<const octree::DiscreteScales>> discreteCandidates;
+};
+
+/**
+ * Octree convolution in double precision. Octree keeps positions and masses in double,
+ * so there is no mixed precision variant, see CoulombBruteForceMixed
+ */
 class CoulombOctree: public IColoumbCalculator
 {
 public:
     CoulombOctree(GraphRegister& graph, std::unique_ptr<const octree::IScalesConfig> scales);
+    /// Octree with automatically selected scales
+    CoulombOctree(GraphRegister& graph, const OctreeAutoTuning& tuning);
+
     FieldPotential getFP(StaticVector<3> pos, CoulombNodeBase* exclude = nullptr) override;
     CoulombNodeBase* makeNode(double& charge, Node& thisNode) override;
     void getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distance) override;
+    /// Copy uses current scales and is not tuned automatically
+    std::unique_ptr<IColoumbCalculator> makeEmptyCopy() const override;
 
     /**
      * @brief build positive and negative octree
      */
     void rebuildOptimization() override;
+
+    bool isAutoTuned() const;
+    /// Linear scales coefficient selected by last tuning, 0 if tuning was not done yet or discrete scales were selected
+    double tunedLinearScale() const;
+    /// Index in OctreeAutoTuning::discreteCandidates selected by last tuning, -1 if linear scales were selected or tuning was not done yet
+    long tunedDiscreteCandidate() const;
+    /// Count of nodes at last tuning, 0 if tuning was not done yet
+    size_t tunedNodesCount() const;
+
 private:
+    struct TuningResult
+    {
+        std::shared_ptr<const octree::IScalesConfig> scales;
+        double linearScale = 0.0;
+        long discreteCandidate = -1;
+        double fieldError = 0.0;
+        double potentialError = 0.0;
+        size_t visits = 0;
+    };
+
+    CoulombOctree(GraphRegister& graph, std::shared_ptr<const octree::IScalesConfig> scales);
+
     void addCN(CoulombNodeBase& cn) override;
     void removeCN(CoulombNodeBase& cn) override;
 
+    void setScales(std::shared_ptr<const octree::IScalesConfig> scales);
+    bool needTuning() const;
+    void tune();
+    /// Fill errors and visits of candidate with given scales
+    void evaluateCandidate(TuningResult& candidate, const std::vector<StaticVector<3>>& targets, const std::vector<FieldPotential>& exact);
+
     GraphRegister& m_graph;
     std::set<CoulombNodeOctree*> m_nodesNotIsolated;
 
     octree::Octree m_octreePositive;
     octree::Octree m_octreeNegative;
 
-    std::unique_ptr<const octree::IScalesConfig> m_scales;
-    octree::Convolution<FieldPotential> m_convolution{*m_scales};
+    /// Shared with empty copies
+    std::shared_ptr<const octree::IScalesConfig> m_scales;
+    std::unique_ptr<octree::Convolution<FieldPotential>> m_convolution;
+
+    bool m_autoTuning = false;
+    OctreeAutoTuning m_tuning;
+    size_t m_tunedNodesCount = 0;
+    double m_tunedLinearScale = 0.0;
+    long m_tunedDiscreteCandidate = -1;
 };
 
 class CoulombNodeOctree : public CoulombNodeBase
@@ -61,7 +126,6 @@ private:
     StaticVector<3> m_isolatedField{0.0, 0.0, 0.0};
 };
 
-
 }
 
 #endif // COLOUMB_OCTREE_HPP
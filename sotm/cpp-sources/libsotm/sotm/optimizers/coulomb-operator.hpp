@@ -0,0 +1,66 @@
+#ifndef COULOMB_OPERATOR_HPP
+#define COULOMB_OPERATOR_HPP
+
+#include "sotm/optimizers/coulomb.hpp"
+#include "sotm/base/parallel.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace sotm {
+
+/**
+ * Matrix-free operator for Krylov solvers from sotm/math/krylov.hpp:
+ * potentials at nodes given their charges, phi = K q, where K is elastance matrix
+ * with node self terms on diagonal and Coulomb terms between given nodes off diagonal.
+ *
+ * Coulomb part is calculated by empty copy of IColoumbCalculator that contains only
+ * given nodes and reads their charges from operator own storage, so approximate
+ * calculators like octree give approximate operator and model charges are not touched.
+ * Copy is built once at construction; calculators that group charges in
+ * rebuildOptimization() (octree) are rebuilt by every application, brute force is not
+ */
+class CoulombPotentialOperator
+{
+public:
+    /**
+     * @param calculator Coulomb calculator to make empty copy of
+     * @param nodes Model nodes, index in vector is index in operator vectors
+     * @param selfElastance Potential of node per its own charge, usually k / r
+     * @param parallel Settings for evaluation of potentials loop
+     * @param phase Phase of parallel settings the loop belongs to
+     */
+    CoulombPotentialOperator(
+        const IColoumbCalculator& calculator,
+        const std::vector<Node*>& nodes,
+        const std::vector<double>& selfElastance,
+        const ParallelSettings& parallel = ParallelSettings::parallelDisabled,
+        ParallelSettings::Phase phase = ParallelSettings::Phase::calculateSecondaryValues
+    );
+
+    /// potentials = K charges
+    void operator()(const std::vector<double>& charges, std::vector<double>& potentials) const;
+
+    /// Element K_ij calculated directly, for preconditioners
+    double entry(size_t i, size_t j) const;
+
+    size_t size() const { return m_nodes.size(); }
+
+    /// Count of operator applications
+    size_t applications() const { return m_applications; }
+
+private:
+    std::unique_ptr<IColoumbCalculator> m_calculator;
+    /// Charges that nodes of m_calculator read, size is fixed since nodes keep references
+    mutable std::vector<double> m_charges;
+    std::vector<std::unique_ptr<CoulombNodeBase>> m_nodes;
+    std::vector<double> m_selfElastance;
+    const ParallelSettings& m_parallel;
+    ParallelSettings::Phase m_phase;
+
+    mutable size_t m_applications = 0;
+};
+
+}
+
+#endif // COULOMB_OPERATOR_HPP
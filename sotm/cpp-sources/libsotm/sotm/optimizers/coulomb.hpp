@@ -3,26 +3,82 @@
 
 #include "sotm/math/geometry.hpp"
 #include "sotm/base/transport-graph.hpp"
+#include "sotm/utils/const.hpp"
 #include "octree.hpp"
+#include <cmath>
 #include <string>
 #include <atomic>
+#include <memory>
+#include <array>
+#include <ostream>
 
 namespace sotm {
 
 class CoulombNodeBruteForce;
 
-struct FieldPotential
+/**
+ * Coulomb field and potential accumulated in Real. Calculators may store
+ * sources and evaluate kernel in narrower type, see coulombContribution()
+ */
+template<typename Real>
+struct FieldPotentialT
 {
-    FieldPotential(double Ex = 0, double Ey = 0, double Ez = 0, double potential = 0);
-    FieldPotential(const StaticVector<3>& E, double p);
-    StaticVector<3> field;
-    double potential = 0.0;
+    FieldPotentialT(Real Ex = 0, Real Ey = 0, Real Ez = 0, Real potential = 0) :
+        field(Ex, Ey, Ez), potential(potential)
+    { }
+
+    FieldPotentialT(const StaticVector<3, Real>& E, Real p) :
+        field(E), potential(p)
+    { }
+
+    template<typename Other>
+    explicit FieldPotentialT(const FieldPotentialT<Other>& other) :
+        field(Real(other.field.x[0]), Real(other.field.x[1]), Real(other.field.x[2])),
+        potential(Real(other.potential))
+    { }
+
+    StaticVector<3, Real> field;
+    Real potential = 0;
 
-    FieldPotential& operator+=(const FieldPotential& right);
+    FieldPotentialT& operator+=(const FieldPotentialT& right)
+    {
+        for (int i = 0; i < 3; i++)
+            field.x[i] += right.field.x[i];
+        potential += right.potential;
+        return *this;
+    }
 
-    static FieldPotential convolutionVisitor(const Position& target, const Position& object, double mass);
+    static FieldPotentialT convolutionVisitor(const Position& target, const Position& object, double mass);
 };
 
+using FieldPotential = FieldPotentialT<double>;
+
+/**
+ * Field and potential of point charge at target. Coordinates difference is taken
+ * in double, so positions far from origin do not lose precision. Kernel is evaluated
+ * in Storage type and converted to Accumulator. Zero distance gives zero result
+ */
+template<typename Storage, typename Accumulator>
+inline FieldPotentialT<Accumulator> coulombContribution(const double* target, const double* object, double charge)
+{
+    Storage d0 = Storage(target[0] - object[0]);
+    Storage d1 = Storage(target[1] - object[1]);
+    Storage d2 = Storage(target[2] - object[2]);
+    Storage r2 = d0 * d0 + d1 * d1 + d2 * d2;
+    if (r2 == Storage(0))
+        return FieldPotentialT<Accumulator>();
+    Storage inverse = Storage(1) / std::sqrt(r2);
+    Storage p = Storage(Const::Si::k * charge) * inverse;
+    Storage e = p * inverse * inverse;
+    return FieldPotentialT<Accumulator>(Accumulator(e * d0), Accumulator(e * d1), Accumulator(e * d2), Accumulator(p));
+}
+
+template<typename Real>
+FieldPotentialT<Real> FieldPotentialT<Real>::convolutionVisitor(const Position& target, const Position& object, double mass)
+{
+    return coulombContribution<Real, Real>(target.x, object.x, mass);
+}
+
 class ICoulombNode
 {
 public:
@@ -54,15 +110,60 @@ public:
     virtual void removeCN(CoulombNodeBase& cn) = 0;
     virtual CoulombNodeBase* makeNode(double& charge, Node& thisNode) = 0;
     virtual void getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distace) = 0;
+
+    /**
+     * Calculator of the same kind and settings without nodes. Its nodes may read charges
+     * from storage other than model variables, for example trial charges of iterative solvers
+     */
+    virtual std::unique_ptr<IColoumbCalculator> makeEmptyCopy() const = 0;
 };
 
 
 ///////////////////////////
 // Special comparator class for benchmark that wrap two other
+
+/**
+ * Accuracy of second calculator relatively to first one.
+ * Relative error of field is |E1 - E2| / max(|E1|, |E2|), of potential is the same
+ */
+struct CoulombComparisonStats
+{
+    /**
+     * Decimal logarithmic histogram of relative error. Bin 0 is for errors >= 1,
+     * bin k from 1 to histogramBins-2 is for [1e-k, 1e-(k-1)),
+     * last bin is for errors less than 1e-(histogramBins-2) including exact match
+     */
+    constexpr static size_t histogramBins = 14;
+    using Histogram = std::array<size_t, histogramBins>;
+
+    size_t evaluations = 0;
+    size_t compared = 0;
+    size_t nanResults = 0;
+
+    double fieldMaxError = 0.0;
+    double fieldRmsError = 0.0;
+    double potentialMaxError = 0.0;
+    double potentialRmsError = 0.0;
+
+    Histogram fieldHistogram{};
+    Histogram potentialHistogram{};
+
+    static size_t histogramBin(double relativeError);
+    static std::string histogramBinName(size_t bin);
+
+    void report(std::ostream& os) const;
+};
+
+/**
+ * Comparator returns results of first calculator and compares them with
+ * results of second one for a fraction of evaluations. Sampling is deterministic
+ * by evaluations counter. Statistics are accumulated in atomics, so getFP()
+ * may be called from many threads
+ */
 class CoulombComarator : public IColoumbCalculator
 {
 public:
-    CoulombComarator(std::unique_ptr<IColoumbCalculator> c1, std::unique_ptr<IColoumbCalculator> c2);
+    CoulombComarator(std::unique_ptr<IColoumbCalculator> c1, std::unique_ptr<IColoumbCalculator> c2, double compareFraction = 1.0);
 
     FieldPotential getFP(StaticVector<3> pos, CoulombNodeBase* exclude = nullptr) override;
     void getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distance) override;
@@ -71,16 +172,34 @@ public:
     void addCN(CoulombNodeBase& cn) override;
     void removeCN(CoulombNodeBase& cn) override;
     CoulombNodeBase* makeNode(double& charge, Node& thisNode) override;
+    std::unique_ptr<IColoumbCalculator> makeEmptyCopy() const override;
+
+    CoulombComparisonStats stats() const;
+    void resetStats();
 
 private:
-    std::string diffStr(const FieldPotential& r1, const FieldPotential& r2);
-    double err(double v1, double v2);
-    std::string header();
+    bool needCompare(size_t evaluationIndex) const;
+    void accumulate(const FieldPotential& r1, const FieldPotential& r2);
+
+    static double relativeError(double norm1, double diffNorm, double norm2);
+    static void atomicMax(std::atomic<double>& target, double value);
+    static void atomicAdd(std::atomic<double>& target, double value);
+
     std::unique_ptr<IColoumbCalculator> m_c1;
     std::unique_ptr<IColoumbCalculator> m_c2;
-    std::atomic<size_t> m_counter{0};
+    double m_compareFraction;
+
+    std::atomic<size_t> m_evaluations{0};
+    std::atomic<size_t> m_compared{0};
+    std::atomic<size_t> m_nanResults{0};
+
+    std::atomic<double> m_fieldMaxError{0.0};
+    std::atomic<double> m_fieldSqrErrorSum{0.0};
+    std::atomic<double> m_potentialMaxError{0.0};
+    std::atomic<double> m_potentialSqrErrorSum{0.0};
 
-    double m_maxDiff = 0.0;
+    std::array<std::atomic<size_t>, CoulombComparisonStats::histogramBins> m_fieldHistogram;
+    std::array<std::atomic<size_t>, CoulombComparisonStats::histogramBins> m_potentialHistogram;
 };
 
 class CoulombComaratorNode : public CoulombNodeBase
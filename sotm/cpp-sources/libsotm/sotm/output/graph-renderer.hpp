@@ -10,80 +10,174 @@
 
 #include "sotm/base/model-context.hpp"
 #include "sotm/output/render-preferences.hpp"
+#include "sotm/output/graph-snapshot.hpp"
 
 #include <vtkDataSet.h>
 #include <vtkPolyDataMapper.h>
+#include <vtkGlyph3DMapper.h>
+#include <vtkAlgorithm.h>
 #include <vtkRenderer.h>
 #include <vtkRenderWindow.h>
-#include <vtkSphereSource.h>
-#include <vtkLineSource.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
 #include <vtkCellArray.h>
-#include <vtkLine.h>
+#include <vtkDoubleArray.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkActor.h>
 #include <vtkSmartPointer.h>
 #include <vtkFollower.h>
 
 #include <vector>
+#include <utility>
+#include <set>
+#include <string>
+#include <unordered_map>
 
 namespace sotm {
 
-class SphereDrawer
-{
-public:
-	SphereDrawer();
-	SphereDrawer(StaticVector<3> pos, double radius, double color[3], const std::string& follower = std::string());
-	void create(StaticVector<3> pos, double radius, double color[3], const std::string& follower = std::string());
-	void addActors(vtkRenderer* renderer);
-
-private:
-	vtkSmartPointer<vtkActor> m_actor = nullptr;
-	vtkSmartPointer<vtkFollower> m_label = nullptr;
-};
-
+/**
+ * Renders graph with constant count of VTK actors: links are line cells of one polydata
+ * (or cylinder glyphs if RenderPreferences::lineWidth), nodes are sphere glyphs of
+ * one vtkGlyph3DMapper. Every buffer follows GraphRegister change journal: new nodes and
+ * links are appended as points and cells, frames refresh only per-object scalar arrays.
+ * Buffer is rebuilt from scratch if objects were removed or journal was overflowed.
+ * Current buffer may be filled from GraphSnapshot instead while other thread iterates graph.
+ * Follower labels are created for selected objects only
+ */
 class GraphRenderer
 {
 public:
 	GraphRenderer(ModelContext* modelContext, RenderPreferences* renderPreferences);
 	void prepareNextBuffer();
 	void prepareCurrentBuffer();
+	/// Fill current buffer from snapshot instead of graph, graph may be iterated meanwhile
+	void prepareCurrentBuffer(const GraphSnapshot& snapshot);
+	/// Add actors of current buffer. Level of detail is prepared for current camera of renderer
 	void addActorsFromCurrentBuffer(vtkRenderer* renderer);
+	/// Prepare level of detail again after camera of renderer was moved
+	void updateLevelOfDetail(vtkRenderer* renderer);
+	/// Bounds of nodes in current buffer, to set up camera before actors are added
+	void currentBufferBounds(double bounds[6]);
 	void writeCurrentBufferToFile(const std::string& filename);
 	void swapBuffers();
 
+	/// Show follower text of node when RenderPreferences::enableFollowers
+	void select(const Node* node);
+	void select(const Link* link);
+	/// @return true if node is selected after call
+	bool toggleSelection(const Node* node);
+	void clearSelection();
+	const std::set<const Node*>& selectedNodes() const { return m_selectedNodes; }
+	const std::set<const Link*>& selectedLinks() const { return m_selectedLinks; }
+
 private:
 	struct WireframeBuffer {
-		WireframeBuffer(RenderPreferences *renderPreferences);
-		void clear();
-		void prepareWireframeActor();
+		WireframeBuffer(RenderPreferences *renderPreferences, vtkAlgorithm* sphere, vtkAlgorithm* cylinder);
+
+		/// Buffer was filled from graph and follows journal since journalPosition
+		bool built = false;
+		size_t journalPosition = 0;
+
+		/// Objects in order of points and cells
+		std::vector<Node*> nodes;
+		std::vector<Link*> links;
+		std::unordered_map<const Node*, vtkIdType> nodeIds;
+		std::unordered_map<const Link*, vtkIdType> linkIds;
+		/// Added links that are not connected yet
+		std::vector<Link*> pendingLinks;
+
+		/// Nodes ids of every link cell
+		std::vector<std::pair<vtkIdType, vtkIdType>> linkEnds;
 
-		// @todo Remove most of this objects from class: smart pointers do its job successfully without this
+		/// Cells correspond to GraphSnapshot with snapshotStateHash
+		bool fromSnapshot = false;
+		size_t snapshotStateHash = 0;
+
+		/// Nodes positions, shared by links and nodes polydata
 		vtkSmartPointer<vtkPoints>            points{ vtkSmartPointer<vtkPoints>::New() };
+
 		vtkSmartPointer<vtkCellArray>         linesCellArray{ vtkSmartPointer<vtkCellArray>::New() };
 		vtkSmartPointer<vtkPolyData>          polyData{ vtkSmartPointer<vtkPolyData>::New() };
+		vtkSmartPointer<vtkUnsignedCharArray> colors{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+		vtkSmartPointer<vtkDoubleArray>       widths{ vtkSmartPointer<vtkDoubleArray>::New() };
 		vtkSmartPointer<vtkPolyDataMapper>    mapper{ vtkSmartPointer<vtkPolyDataMapper>::New() };
 		vtkSmartPointer<vtkActor>             actor{ vtkSmartPointer<vtkActor>::New() };
-		vtkSmartPointer<vtkUnsignedCharArray> colors{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
-
-		std::vector< vtkSmartPointer<vtkLine> > lines;
 
-		std::vector< vtkSmartPointer<vtkActor> > lineActors;
-
-		std::vector<SphereDrawer> sphereDrawers;
-
-		std::vector< vtkSmartPointer<vtkFollower> > wireLabels;
+		/// Links centers with direction and scale of cylinder glyph for every link
+		vtkSmartPointer<vtkPolyData>          linkGlyphs{ vtkSmartPointer<vtkPolyData>::New() };
+		vtkSmartPointer<vtkPoints>            linkCenters{ vtkSmartPointer<vtkPoints>::New() };
+		vtkSmartPointer<vtkDoubleArray>       linkDirections{ vtkSmartPointer<vtkDoubleArray>::New() };
+		vtkSmartPointer<vtkDoubleArray>       linkScales{ vtkSmartPointer<vtkDoubleArray>::New() };
+		vtkSmartPointer<vtkUnsignedCharArray> linkGlyphColors{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+		vtkSmartPointer<vtkGlyph3DMapper>     linkGlyphMapper{ vtkSmartPointer<vtkGlyph3DMapper>::New() };
+		vtkSmartPointer<vtkActor>             linkGlyphActor{ vtkSmartPointer<vtkActor>::New() };
+
+		vtkSmartPointer<vtkPolyData>          nodesPolyData{ vtkSmartPointer<vtkPolyData>::New() };
+		vtkSmartPointer<vtkDoubleArray>       nodeRadiuses{ vtkSmartPointer<vtkDoubleArray>::New() };
+		vtkSmartPointer<vtkUnsignedCharArray> nodeColors{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+		vtkSmartPointer<vtkGlyph3DMapper>     nodeMapper{ vtkSmartPointer<vtkGlyph3DMapper>::New() };
+		vtkSmartPointer<vtkActor>             nodeActor{ vtkSmartPointer<vtkActor>::New() };
+
+		/// Level of detail: links visible on screen as lines and clusters of short links as points
+		bool lodActive = false;
+		vtkSmartPointer<vtkCellArray>         lodLines{ vtkSmartPointer<vtkCellArray>::New() };
+		vtkSmartPointer<vtkPolyData>          lodPolyData{ vtkSmartPointer<vtkPolyData>::New() };
+		vtkSmartPointer<vtkUnsignedCharArray> lodColors{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+		vtkSmartPointer<vtkPolyDataMapper>    lodMapper{ vtkSmartPointer<vtkPolyDataMapper>::New() };
+		vtkSmartPointer<vtkActor>             lodActor{ vtkSmartPointer<vtkActor>::New() };
+
+		vtkSmartPointer<vtkPoints>            clusterPoints{ vtkSmartPointer<vtkPoints>::New() };
+		vtkSmartPointer<vtkCellArray>         clusterVerts{ vtkSmartPointer<vtkCellArray>::New() };
+		vtkSmartPointer<vtkPolyData>          clusterPolyData{ vtkSmartPointer<vtkPolyData>::New() };
+		vtkSmartPointer<vtkUnsignedCharArray> clusterColors{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+		vtkSmartPointer<vtkPolyDataMapper>    clusterMapper{ vtkSmartPointer<vtkPolyDataMapper>::New() };
+		vtkSmartPointer<vtkActor>             clusterActor{ vtkSmartPointer<vtkActor>::New() };
+
+		/// Glyph masks of level of detail, 0 hides glyph
+		vtkSmartPointer<vtkUnsignedCharArray> nodeMask{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+		vtkSmartPointer<vtkUnsignedCharArray> linkGlyphMask{ vtkSmartPointer<vtkUnsignedCharArray>::New() };
+
+		std::vector< vtkSmartPointer<vtkFollower> > labels;
 
 		RenderPreferences* m_renderPreferences;
 	};
 
-	void linkVisitor(sotm::Link* link, WireframeBuffer* buffer);
-	void nodeVisitor(sotm::Node* node, WireframeBuffer* buffer);
-
 	void prepareBuffer(WireframeBuffer* buffer);
+	void rebuildBuffer(WireframeBuffer* buffer);
+	void appendChanges(WireframeBuffer* buffer, const std::vector<GraphChange>& changes);
+	void appendNode(WireframeBuffer* buffer, Node* node);
+	/// @return false if link is not connected to appended nodes yet
+	bool appendLink(WireframeBuffer* buffer, Link* link);
+	void topologyModified(WireframeBuffer* buffer);
+	/**
+	 * Set colors and sizes of first nodesCount nodes and linksCount links of buffer.
+	 * nodeScalars(i, rgb) and linkScalars(i, rgb) write color of element i to rgb and return its size
+	 */
+	template<typename NodeScalars, typename LinkScalars>
+	void setScalars(WireframeBuffer* buffer, size_t nodesCount, size_t linksCount,
+			const NodeScalars& nodeScalars, const LinkScalars& linkScalars);
+	void refreshScalars(WireframeBuffer* buffer);
+	void prepareLabels(WireframeBuffer* buffer);
+	void prepareBuffer(WireframeBuffer* buffer, const GraphSnapshot& snapshot);
+	void prepareLevelOfDetail(WireframeBuffer* buffer, vtkRenderer* renderer);
+	void colorToBytes(double* rgb, unsigned char* bytes);
+	static vtkSmartPointer<vtkFollower> makeLabel(const std::string& text, const StaticVector<3>& pos, const double* color);
+	/// Sphere of radius 1
+	static vtkSmartPointer<vtkAlgorithm> makeSphereSource();
+	/// Cylinder of length 1 and diameter 1 along x axis
+	static vtkSmartPointer<vtkAlgorithm> makeCylinderSource();
 
 	sotm::ModelContext* m_modelContext;
 	RenderPreferences* m_renderPreferences;
 
-	WireframeBuffer m_buffer1{m_renderPreferences}, m_buffer2{m_renderPreferences};
+	vtkSmartPointer<vtkAlgorithm> m_sphereSource{makeSphereSource()};
+	vtkSmartPointer<vtkAlgorithm> m_cylinderSource{makeCylinderSource()};
+
+	std::set<const Node*> m_selectedNodes;
+	std::set<const Link*> m_selectedLinks;
+
+	WireframeBuffer m_buffer1{m_renderPreferences, m_sphereSource, m_cylinderSource};
+	WireframeBuffer m_buffer2{m_renderPreferences, m_sphereSource, m_cylinderSource};
 	WireframeBuffer *m_nextBuffer = &(m_buffer1), *m_currentBuffer = &(m_buffer2);
 };
 
@@ -0,0 +1,79 @@
+#ifndef GRAPH_SNAPSHOT_HPP_INCLUDED
+#define GRAPH_SNAPSHOT_HPP_INCLUDED
+
+#include "sotm/base/model-context.hpp"
+#include "sotm/base/time-iter.hpp"
+#include "sotm/math/geometry.hpp"
+#include "sotm/utils/triple-buffer.hpp"
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sotm {
+
+/**
+ * Copy of graph data needed for drawing. It does not refer to graph objects,
+ * so it may be read by other thread while graph is iterated
+ */
+struct GraphSnapshot
+{
+	struct Label
+	{
+		std::string text;
+		StaticVector<3> pos;
+		bool isLink = false;
+	};
+
+	double time = 0.0;
+	/// GraphRegister::stateHash() at the moment of snapshot. Topology is the same while it is the same
+	size_t stateHash = 0;
+
+	/// Three values for every node or link
+	std::vector<double> nodePositions;
+	std::vector<double> nodeColors;
+	std::vector<double> nodeSizes;
+
+	/// Indexes of nodes for every link
+	std::vector<std::pair<size_t, size_t>> linkNodes;
+	std::vector<double> linkColors;
+	std::vector<double> linkSizes;
+
+	/// Follower texts of selected objects
+	std::vector<Label> labels;
+
+	size_t nodesCount() const { return nodeSizes.size(); }
+	size_t linksCount() const { return linkSizes.size(); }
+};
+
+/**
+ * Periodically publishes GraphSnapshot to TripleBuffer, so consumer thread
+ * may draw latest state without stopping iterations
+ */
+class GraphSnapshotHook : public TimeHookPeriodic
+{
+public:
+	GraphSnapshotHook(ModelContext* modelContext, TripleBuffer<GraphSnapshot>* snapshots, double period = 1.0);
+
+	/// Objects which follower texts are copied to snapshots. May be called from any thread
+	void setSelection(const std::set<const Node*>& nodes, const std::set<const Link*>& links);
+
+	/// Fill and publish snapshot. Graph should not be changed while it runs
+	void publish(double time);
+
+private:
+	void hook(double time, double wantedTime) override;
+
+	ModelContext* m_modelContext;
+	TripleBuffer<GraphSnapshot>* m_snapshots;
+
+	std::set<const Node*> m_selectedNodes;
+	std::set<const Link*> m_selectedLinks;
+	std::mutex m_selectionMutex;
+};
+
+}
+
+#endif // GRAPH_SNAPSHOT_HPP_INCLUDED
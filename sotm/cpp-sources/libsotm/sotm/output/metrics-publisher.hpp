@@ -0,0 +1,111 @@
+#ifndef METRICS_PUBLISHER_HPP_INCLUDED
+#define METRICS_PUBLISHER_HPP_INCLUDED
+
+#include "sotm/base/model-context.hpp"
+#include "sotm/base/time-iter.hpp"
+#include "sotm/utils/profiling.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sotm {
+
+/// Progress of iterating at the moment of sampling. Rates are averaged since previous sample
+struct MetricsSample
+{
+    double wallTime = 0.0;
+    double time = 0.0;
+    double dt = 0.0;
+    size_t nodes = 0;
+    size_t links = 0;
+    size_t steps = 0;
+    double stepsPerSecond = 0.0;
+    /// Wall time spent in field evaluation, seconds per second. Negative if profiling is not compiled in
+    double fieldEvaluationLoad = -1.0;
+    /// Fraction of step calculations that were rejected by step adjustment
+    double rejectionRate = 0.0;
+
+    /// One line JSON object
+    std::string toJson() const;
+};
+
+/**
+ * Samples iterating progress at fixed wall clock rate and publishes it to any of:
+ *  - JSONL file rotated by size: <file>, <file>.1, <file>.2, ...
+ *  - Unix socket: every connection gets latest sample as JSON line
+ *  - Local HTTP on 127.0.0.1: every request gets latest sample as JSON
+ *  - Log at info level as one human readable line
+ *
+ * Hook is checked after every iteration, but only compares wall clock with next
+ * sampling time. Sockets are served by own thread, so iterating never waits for clients
+ */
+class MetricsPublisher : public ITimeHook
+{
+public:
+    MetricsPublisher(ModelContext* modelContext, TimeIterator* timeIterator, double periodSeconds = 1.0);
+    ~MetricsPublisher();
+
+    /// @param maxBytes File is rotated when it becomes larger. 0 to disable rotation
+    void setFile(const std::string& filename, size_t maxBytes = 64 << 20, size_t keepFiles = 3);
+    /// Write human readable summary of every sample to SOTM_LOG(info)
+    void setLogSummary(bool logSummary);
+    /// Start serving latest sample on Unix socket. Existing socket file is replaced
+    void listenUnixSocket(const std::string& path);
+    /// Start serving latest sample over HTTP on 127.0.0.1:port
+    void listenHttp(int port);
+
+    /// Sample and publish now
+    void publish();
+    /// Stop serving and close outputs
+    void stop();
+
+    MetricsSample lastSample();
+
+    void runHook(double time) override;
+    double getNextTime() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    MetricsSample sample();
+    void writeFile(const std::string& line);
+    void rotateFile();
+    void startServer();
+    void serve();
+
+    ModelContext* m_modelContext;
+    TimeIterator* m_timeIterator;
+    Clock::duration m_period;
+    Clock::time_point m_start;
+    Clock::time_point m_nextSample;
+    double m_lastTime = 0.0;
+
+    Clock::time_point m_previousWall;
+    ContiniousIteratorMetrics m_previousMetrics;
+    ProfilingSnapshot m_previousProfiling;
+
+    std::string m_filename;
+    size_t m_fileMaxBytes = 0;
+    size_t m_fileKeep = 0;
+    std::ofstream m_file;
+    bool m_logSummary = false;
+
+    MetricsSample m_lastSample;
+    std::string m_lastJson;
+    std::mutex m_lastMutex;
+
+    std::string m_socketPath;
+    /// Server thread reads descriptors while other listen function may set them
+    std::atomic<int> m_unixSocket{-1};
+    std::atomic<int> m_httpSocket{-1};
+    std::thread m_server;
+    std::atomic<bool> m_stop{false};
+};
+
+}
+
+#endif // METRICS_PUBLISHER_HPP_INCLUDED
@@ -0,0 +1,26 @@
+#ifndef PROFILING_SUMMARY_HPP_INCLUDED
+#define PROFILING_SUMMARY_HPP_INCLUDED
+
+#include "sotm/base/time-iter.hpp"
+#include "sotm/utils/profiling.hpp"
+
+namespace sotm {
+
+/**
+ * Periodically logs one info line with profiling phases totals
+ * collected since previous run of this hook
+ */
+class ProfilingSummaryHook : public TimeHookPeriodic
+{
+public:
+    ProfilingSummaryHook(double period = 1.0);
+
+private:
+    void hook(double time, double wantedTime) override;
+
+    ProfilingSnapshot m_last;
+};
+
+}
+
+#endif // PROFILING_SUMMARY_HPP_INCLUDED
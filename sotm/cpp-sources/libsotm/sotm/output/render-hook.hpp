@@ -0,0 +1,80 @@
+#ifndef RENDER_HOOK_HPP_INCLUDED
+#define RENDER_HOOK_HPP_INCLUDED
+
+#include "sotm/base/model-context.hpp"
+#include "sotm/base/time-iter.hpp"
+#include "sotm/output/graph-renderer.hpp"
+#include "sotm/output/render-preferences.hpp"
+#include "sotm/math/geometry.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sotm {
+
+/**
+ * Periodically renders graph off-screen and writes frames to PNG files
+ * <prefix>_000000.png, <prefix>_000001.png, ... that may be joined to movie.
+ *
+ * Hook only prepares next GraphRenderer buffer on iterating thread. Rendering and
+ * PNG encoding run on own thread that owns off-screen render window. To work without
+ * X server VTK should be built with OSMesa or EGL (VTK_OPENGL_HAS_OSMESA or
+ * VTK_OPENGL_HAS_EGL), otherwise X display is still needed for OpenGL context.
+ */
+class RenderHook : public TimeHookPeriodic
+{
+public:
+    RenderHook(ModelContext* modelContext, const RenderPreferences& renderPreferences, double period = 1.0);
+    ~RenderHook();
+
+    void setFilenamePrefix(const std::string& prefix);
+    void setImageSize(int width, int height);
+
+    /// Fixed camera. By default camera looks along y axis and is fitted to graph every frame
+    void setCamera(const StaticVector<3>& position, const StaticVector<3>& focalPoint);
+
+    /**
+     * If previous frame is not written yet, skip frame instead of waiting for it.
+     * Iterating never waits for rendering then, but frames are not uniform by time
+     */
+    void setDropFrames(bool dropFrames);
+
+    /// Write pending frame and stop rendering thread. Hook should not run after it
+    void finish();
+
+    size_t framesWritten();
+    size_t framesDropped();
+
+private:
+    void hook(double time, double wantedTime) override;
+    void renderLoop();
+
+    RenderPreferences m_renderPreferences;
+    GraphRenderer m_renderer;
+
+    std::string m_prefix = "frame";
+    int m_width = 1280;
+    int m_height = 720;
+    bool m_cameraSet = false;
+    StaticVector<3> m_cameraPosition;
+    StaticVector<3> m_cameraFocalPoint;
+    bool m_dropFrames = false;
+
+    size_t m_frame = 0;
+    size_t m_framesWritten = 0;
+    size_t m_framesDropped = 0;
+
+    /// Current buffer of m_renderer with m_filename is waiting for render or being rendered
+    bool m_frameReady = false;
+    bool m_stop = false;
+    std::string m_filename;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+};
+
+}
+
+#endif // RENDER_HOOK_HPP_INCLUDED
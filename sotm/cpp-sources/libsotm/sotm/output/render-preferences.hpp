@@ -8,6 +8,8 @@
 #ifndef LIBSOTM_GUI_SOURCE_RENDER_PREFERENCES_HPP_
 #define LIBSOTM_GUI_SOURCE_RENDER_PREFERENCES_HPP_
 
+#include <cstddef>
+
 class RenderPreferences
 {
 public:
@@ -15,7 +17,22 @@ public:
 	double gamma = defaultGamma;
 	bool enableFollowers = true;
 	bool enableSpheres = true;
+	/// Draw links as cylinders with diameter depending on link payload size
 	bool lineWidth = false;
+	/// Cylinder diameter for link payload size 1.0 when lineWidth
+	double linkWidthScale = 0.01;
+
+	/**
+	 * Level of detail: objects outside of camera frustum are not drawn, links shorter
+	 * than lodMinPixels on screen are merged to clusters drawn as points, spheres
+	 * smaller than lodMinPixels are not drawn
+	 */
+	bool levelOfDetail = true;
+	/// Level of detail is used only for graphs with more links than this
+	size_t lodLinksThreshold = 100000;
+	double lodMinPixels = 1.0;
+	/// Screen size of cubic cell that merges short links to one cluster
+	double lodClusterPixels = 4.0;
 
 };
 
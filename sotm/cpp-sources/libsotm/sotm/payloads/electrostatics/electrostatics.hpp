@@ -13,17 +13,29 @@
 #include "sotm/base/model-context.hpp"
 #include "sotm/math/integration.hpp"
 #include "sotm/math/field.hpp"
+#include "sotm/math/spatial-hash-grid.hpp"
 #include "sotm/output/variables.hpp"
 #include "sotm/optimizers/coulomb-brute-force.hpp"
+#include "sotm/optimizers/coulomb-operator.hpp"
+#include "sotm/utils/first-touch-array.hpp"
 #include <memory>
+#include <vector>
 
 namespace sotm
 {
 
+class ElectrostaticNodePayload;
+class ElectrostaticLinkPayload;
+class EquipotentialSolver;
+
 class ElectrostaticPhysicalContext : public PhysicalContextBase
 {
 friend class ElectrostaticNodePayload;
+friend class EquipotentialSolver;
 public:
+	ElectrostaticPhysicalContext();
+	~ElectrostaticPhysicalContext();
+
 	void destroyGraph();
 	bool readyToDestroy();
 
@@ -49,6 +61,18 @@ public:
 		return static_cast<const ElectrostaticPhysicalContext*>(context);
 	}
 
+	/**
+	 * Elastance operator over all nodes of current graph for Krylov solvers.
+	 * Index in operator vectors is node index in graphRegister.adjacency()
+	 */
+	std::unique_ptr<CoulombPotentialOperator> makePotentialOperator();
+
+	/// Solver used by step() when equipotentialChannels is set, nullptr before first use
+	const EquipotentialSolver* equipotentialSolver() const { return m_equipotentialSolver.get(); }
+
+	/// True if some node is strictly closer than distance to pos. Nodes are found by grid of collision checks
+	bool hasNodeCloser(const StaticVector<3>& pos, double distance) const;
+
     Parameter<double> airTemperature{300};
 
     Parameter<double> branchingStep;
@@ -71,6 +95,13 @@ public:
     Parameter<double> linkBetaDefault;
     Parameter<double> conductivityLimit;
 
+    /// Redistribute charge along highly conductive channels after each step, see EquipotentialSolver
+    Parameter<bool>   equipotentialChannels{false};
+    /// Link belongs to channel if its conductivity is not less than this fraction of conductivityLimit
+    Parameter<double> equipotentialConductivityFraction{0.5};
+    Parameter<double> equipotentialTolerance{1e-8};
+    Parameter<size_t> equipotentialMaxIterations{200};
+
     Function1D ionizationOverheatingInstFunc{zero};
 
     /// @todo Remove coloring/scaling functionality outside
@@ -88,6 +119,43 @@ public:
     };
 
 private:
+	struct LinkCurrentEntry
+	{
+		ElectrostaticLinkPayload* link;
+		size_t node1, node2;
+	};
+
+	/**
+	 * Build edge list of links. Entries are grouped by colors so that links
+	 * of the same color have no common nodes and currents may be added to nodes in parallel
+	 */
+	void rebuildLinkEntriesIfNeeded();
+
+	/// Calculate current of every link once and add it to charge RHS of connected nodes
+	void calculateLinkCurrents();
+
+	void addToNodesGrid(ElectrostaticNodePayload* payload, const StaticVector<3>& pos);
+	void removeFromNodesGrid(ElectrostaticNodePayload* payload, const StaticVector<3>& pos);
+	/// Nearest node strictly closer than distance, nullptr if there is no such node
+	ElectrostaticNodePayload* findNearestNode(const StaticVector<3>& pos, double distance) const;
+
+	// Tables are placed by first touch, payloads they point to are not
+	FirstTouchArray<ElectrostaticNodePayload*> m_nodePayloads;
+	FirstTouchArray<LinkCurrentEntry> m_linkEntries;
+	/// Entries of color i are [m_colorBegins[i], m_colorBegins[i+1])
+	std::vector<size_t> m_colorBegins;
+	size_t m_linkEntriesStateHash = 0;
+
+	std::unique_ptr<EquipotentialSolver> m_equipotentialSolver;
+
+	/**
+	 * Node payloads by node positions for collision checks, so new node does not scan
+	 * whole graph. Cell size is selected by the first node. Nodes should not be moved
+	 */
+	std::unique_ptr<SpatialHashGridT<ElectrostaticNodePayload*>> m_nodesGrid;
+	/// Maximal nodeRadiusBranching seen on node creation or init()
+	double m_maxNodeRadiusBranching = 0.0;
+
 	Function1D m_dischargeProb{zero};
 	Function1D m_IOInstFunc{zero};
 	std::unique_ptr<DefinedIntegral> m_integralOfProb;
@@ -113,6 +181,7 @@ public:
 	void prepareBifurcation(double time, double dt) override;
 	void doBifurcation(double time, double dt) override;
 	void init() override;
+	void onDeletePayload() override;
 	void getBranchingParameters(double time, double dt, BranchingParameters& branchingParameters) override;
 
 	void getColor(double* rgb) override;
@@ -127,6 +196,7 @@ public:
     /// For smart branching: dynamic branch len
 	double branchProbeStep = 0.001;
 
+    /// New nodes closer than sum of branching radii are connected. Should be set before init()
     double nodeRadiusBranching;
     double nodeRadiusConductivity;
 
@@ -192,6 +262,12 @@ public:
 	double getCurrent();
 	double getVoltage();
 
+	/// Calculate current and voltage and store them for calculateRHS() of the stage
+	double updateCurrent();
+
+	/// Calculate geometry dependent terms. Link should be connected
+	void updateGeometry();
+
 	double getHeatCapacity();
 
 	// Parameters
@@ -204,8 +280,14 @@ public:
 	Variable conductivity; // Simens
 	Variable temperature;
 
+	// Geometry dependent terms from updateGeometry()
+	double crossSectionPerLength = 0; // pi*r^2/l
+	double heatCapacity = 0;
+
 	// Secondary
-	//double current = 0;
+	/// Values from last updateCurrent() call
+	double current = 0;
+	double voltage = 0;
 };
 
 class ElectrostaticNodePayloadFactory : public INodePayloadFactory
@@ -0,0 +1,76 @@
+#ifndef EQUIPOTENTIAL_HPP_INCLUDED
+#define EQUIPOTENTIAL_HPP_INCLUDED
+
+#include "sotm/math/krylov.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace sotm {
+
+class ElectrostaticPhysicalContext;
+class ElectrostaticNodePayload;
+class Node;
+
+/**
+ * Quasi-static charge redistribution along highly conductive channels.
+ *
+ * Channel is a connected subgraph of links with effective conductivity not less than
+ * ElectrostaticPhysicalContext::equipotentialConductivityFraction * conductivityLimit.
+ * Relaxation time of such channel is much less than integration step, so its charge is
+ * distributed to make potential equal along the channel while total charge is conserved:
+ *
+ *     K q = V - phiOther,  sum(q) = Q
+ *
+ * where K is elastance matrix of channel nodes (node self term k / r and Coulomb terms
+ * k / r_ij), phiOther is potential of external field and all charges outside of channel.
+ * K is symmetric positive definite, so K a = 1 and K b = -phiOther are solved by
+ * conjugate gradient and q = V a + b with V chosen to conserve Q.
+ *
+ * K is applied by CoulombPotentialOperator, so its Coulomb part is calculated by the
+ * configured Coulomb engine. Loops of big channels run in parallel by step phase
+ * settings, ParallelSettings::serialThreshold keeps small channels serial.
+ */
+class EquipotentialSolver
+{
+public:
+    struct Stats
+    {
+        size_t channels = 0;
+        size_t nodes = 0;
+        size_t iterations = 0;
+        size_t notConverged = 0;
+    };
+
+    EquipotentialSolver(ElectrostaticPhysicalContext& context);
+
+    /**
+     * Redistribute charges of channels for the end of current step.
+     * Should be called after last RK stage and before variables step(): target charges
+     * are taken from charge.previous + charge.delta, and charge.delta is corrected
+     */
+    void equalize();
+
+    const Stats& lastStats() const { return m_stats; }
+
+private:
+    void findChannels();
+    void solveChannel(const std::vector<ElectrostaticNodePayload*>& channel);
+
+    size_t findRoot(size_t i);
+
+    ElectrostaticPhysicalContext& m_context;
+
+    std::vector<size_t> m_parents;
+    std::vector<std::vector<ElectrostaticNodePayload*>> m_channels;
+
+    // Channel being solved
+    std::vector<Node*> m_nodes;
+    std::vector<double> m_selfElastance;
+
+    Stats m_stats;
+};
+
+}  // namespace sotm
+
+#endif // EQUIPOTENTIAL_HPP_INCLUDED
@@ -0,0 +1,78 @@
+#ifndef FIRST_TOUCH_ARRAY_HPP_INCLUDED
+#define FIRST_TOUCH_ARRAY_HPP_INCLUDED
+
+#include "sotm/base/parallel.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+namespace sotm
+{
+
+/**
+ * Fixed size array that is not touched on allocation. Its elements should be
+ * written first time by ParallelSettings::parallelFor() over the same ranges that
+ * are used later by sweeps, so with ParallelSettings::numaAware every memory page
+ * is placed to NUMA node whose threads process it
+ */
+template<typename T>
+class FirstTouchArray
+{
+	static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+		"FirstTouchArray is for plain data only");
+public:
+	FirstTouchArray() = default;
+	FirstTouchArray(const FirstTouchArray&) = delete;
+	FirstTouchArray& operator=(const FirstTouchArray&) = delete;
+
+	~FirstTouchArray()
+	{
+		std::free(m_data);
+	}
+
+	/// Reallocate for size elements. Elements are not initialized
+	void allocate(size_t size)
+	{
+		std::free(m_data);
+		m_data = nullptr;
+		m_size = size;
+		if (size == 0)
+			return;
+		m_data = static_cast<T*>(std::malloc(size * sizeof(T)));
+		if (m_data == nullptr)
+			throw std::bad_alloc();
+	}
+
+	/// Reallocate and set element i to generator(i) with parallel loop of phase
+	template<typename Generator>
+	void assign(const ParallelSettings& parallel, ParallelSettings::Phase phase, size_t size, const Generator& generator)
+	{
+		allocate(size);
+		parallel.forEach(phase, size, [this, &generator](size_t i) { m_data[i] = generator(i); });
+	}
+
+	void clear()
+	{
+		allocate(0);
+	}
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	T& operator[](size_t i) { return m_data[i]; }
+	const T& operator[](size_t i) const { return m_data[i]; }
+
+	T* begin() { return m_data; }
+	T* end() { return m_data + m_size; }
+	const T* begin() const { return m_data; }
+	const T* end() const { return m_data + m_size; }
+
+private:
+	T* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+}
+
+#endif // FIRST_TOUCH_ARRAY_HPP_INCLUDED
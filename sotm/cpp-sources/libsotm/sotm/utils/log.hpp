@@ -0,0 +1,142 @@
+#ifndef LOG_HPP_INCLUDED
+#define LOG_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+/**
+ * Levelled logging for library and application code:
+ *
+ *     SOTM_LOG(info) << "[R-K4] Increasing step to " << dt;
+ *
+ * Levels below SOTM_LOG_MIN_LEVEL are eliminated by compiler together with
+ * arguments calculation. By default debug and trace are compiled in only for
+ * DEBUG builds. Levels below Log::level() are skipped at run time before any
+ * formatting.
+ *
+ * Every call site is rate limited: messages over Log::rateLimit() per second
+ * are dropped and counted, the count is reported with next passed message.
+ *
+ * Messages are collected in per-thread buffer and written to output by large
+ * blocks. Background thread writes buffers of all threads every Log::flushPeriod(),
+ * so buffered message is not delayed longer. Warnings and errors go to error
+ * output immediately. Log::flush() writes buffers of all threads.
+ *
+ * Macro is one expression, so it is safe in unbraced if/else.
+ */
+
+#define SOTM_LOG_LEVEL_TRACE      0
+#define SOTM_LOG_LEVEL_DEBUG      1
+#define SOTM_LOG_LEVEL_INFO       2
+#define SOTM_LOG_LEVEL_WARNING    3
+#define SOTM_LOG_LEVEL_ERROR      4
+
+#ifndef SOTM_LOG_MIN_LEVEL
+    #ifdef DEBUG
+        #define SOTM_LOG_MIN_LEVEL    SOTM_LOG_LEVEL_TRACE
+    #else
+        #define SOTM_LOG_MIN_LEVEL    SOTM_LOG_LEVEL_INFO
+    #endif
+#endif
+
+#define SOTM_LOG(lvl) \
+    (static_cast<int>(::sotm::LogLevel::lvl) < SOTM_LOG_MIN_LEVEL \
+        || !::sotm::Log::enabled(::sotm::LogLevel::lvl)) ? (void) 0 \
+    : ::sotm::LogVoidify() & ::sotm::LogMessage(::sotm::LogLevel::lvl, \
+        []() -> ::sotm::LogRateLimiter& { static ::sotm::LogRateLimiter limiter; return limiter; }()).stream()
+
+namespace sotm
+{
+
+enum class LogLevel : int
+{
+    trace = SOTM_LOG_LEVEL_TRACE,
+    debug = SOTM_LOG_LEVEL_DEBUG,
+    info = SOTM_LOG_LEVEL_INFO,
+    warning = SOTM_LOG_LEVEL_WARNING,
+    error = SOTM_LOG_LEVEL_ERROR,
+    none
+};
+
+class Log
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static void setLevel(LogLevel level);
+    static LogLevel level();
+    static bool enabled(LogLevel level)
+    {
+        return static_cast<int>(level) >= static_cast<int>(levelValue());
+    }
+
+    /// Output for trace, debug and info. Default is std::cout
+    static void setOutput(std::ostream* output);
+    /// Output for warnings and errors. Default is std::cerr
+    static void setErrorOutput(std::ostream* output);
+
+    /// Messages per second from every call site. 0 for no limit
+    static void setRateLimit(size_t messagesPerSecond);
+    static size_t rateLimit();
+
+    /// Period of background flushing. 0 to write every message immediately
+    static void setFlushPeriod(Clock::duration period);
+    static Clock::duration flushPeriod();
+
+    /// Write buffered messages of all threads
+    static void flush();
+
+    /// Add message line. Thread-safe
+    static void write(LogLevel level, const std::string& message);
+
+private:
+    static LogLevel& levelValue();
+};
+
+/// Counts messages from one call site per one second window
+class LogRateLimiter
+{
+public:
+    /**
+     * Returns true if message may be logged.
+     * @param suppressed Count of messages dropped since previous passed one
+     */
+    bool pass(size_t& suppressed);
+
+private:
+    std::mutex m_mutex;
+    Log::Clock::time_point m_windowStart;
+    size_t m_passed = 0;
+    size_t m_suppressed = 0;
+};
+
+class LogMessage
+{
+public:
+    LogMessage(LogLevel level, LogRateLimiter& limiter);
+    ~LogMessage();
+
+    std::ostream& stream() { return m_stream; }
+
+private:
+    LogLevel m_level;
+    /// Initialized before m_pass, that is calculated with it
+    size_t m_suppressed = 0;
+    bool m_pass;
+    std::ostringstream m_stream;
+};
+
+/// Makes SOTM_LOG() stream expression void to match other branch of conditional operator
+struct LogVoidify
+{
+    /// Has lower priority than << and higher than ?:
+    void operator&(std::ostream&) { }
+};
+
+}
+
+#endif // LOG_HPP_INCLUDED
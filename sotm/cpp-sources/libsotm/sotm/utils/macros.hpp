@@ -55,6 +55,13 @@
 	#define SOTM_INLINE	inline
 #endif
 
+// Pointer is the only way to access its data in scope, so compiler may vectorize loops over it
+#ifdef __GNUC__
+	#define SOTM_RESTRICT	__restrict__
+#else
+	#define SOTM_RESTRICT
+#endif
+
 //////////////////////////////////////////////////////////////////////
 // Macros to add static initializer and deinitializer to class
 //
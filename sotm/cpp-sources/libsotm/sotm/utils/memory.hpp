@@ -74,8 +74,10 @@ public:
 	{
 		if (m_pobject != nullptr)
 		{
-			m_pobject->release();
+			// Object may own this wrapper, so it should be detached before release
+			T* pobject = m_pobject;
 			m_pobject = nullptr;
+			pobject->release();
 		}
 	}
 
@@ -0,0 +1,118 @@
+#ifndef PROFILING_HPP_INCLUDED
+#define PROFILING_HPP_INCLUDED
+
+#include "sotm/utils/macros.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * Hot-path timers and counters. They are compiled in only if SOTM_PROFILING
+ * is defined (CMake option SOTM_PROFILING), otherwise SOTM_PROFILE_SCOPE
+ * expands to nothing and Profiler reports that profiling is disabled.
+ *
+ * Phases may be nested, i.e. calculateRHS is inside of rk4Stage*,
+ * so totals should not be summed up.
+ */
+
+#define SOTM_PROFILING_CONCAT_IMPL(a, b)  a##b
+#define SOTM_PROFILING_CONCAT(a, b)       SOTM_PROFILING_CONCAT_IMPL(a, b)
+
+#ifdef SOTM_PROFILING
+    #define SOTM_PROFILE_SCOPE(phase)     sotm::ScopedTimer SOTM_PROFILING_CONCAT(sotmScopedTimer, __LINE__)(phase)
+#else
+    #define SOTM_PROFILE_SCOPE(phase)
+#endif
+
+namespace sotm
+{
+
+enum class ProfilingPhase : int
+{
+    rebuildOptimization = 0,
+    fieldEvaluation,
+    calculateRHS,
+    rk4Stage1,
+    rk4Stage2,
+    rk4Stage3,
+    rk4Stage4,
+    prepareBifurcation,
+    doBifurcation,
+    graphCommit,
+    outputHooks,
+    equipotentialSolve,
+
+    count
+};
+
+struct ProfilingPhaseStats
+{
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+
+    double totalSeconds() const { return totalNs * 1e-9; }
+    double meanNs() const { return calls == 0 ? 0.0 : double(totalNs) / calls; }
+};
+
+using ProfilingSnapshot = std::array<ProfilingPhaseStats, static_cast<size_t>(ProfilingPhase::count)>;
+
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// True if library was compiled with SOTM_PROFILING
+    static bool compiledIn();
+
+    static const char* phaseName(ProfilingPhase phase);
+
+    /// Add one call of phase. Thread-safe
+    static void add(ProfilingPhase phase, Clock::time_point begin, Clock::time_point end);
+
+    /// Get current totals of all phases. Thread-safe, but totals may be slightly inconsistent while running
+    static ProfilingSnapshot snapshot();
+    /// Zero totals and drop collected trace events. Tracing is not stopped
+    static void reset();
+
+    /**
+     * One line summary of phases that was called at least once, like
+     * "[Profiling] calculateRHS: 40 calls, 0.012 s; ..."
+     * If previous is not null, only difference with previous snapshot is printed
+     */
+    static std::string summary(const ProfilingSnapshot* previous = nullptr);
+
+    /**
+     * Start collecting events for Chrome trace (chrome://tracing, Perfetto).
+     * Field evaluations are too frequent and are not recorded as events.
+     * @param maxEvents Events after this count are dropped
+     */
+    static void startTrace(size_t maxEvents = 1000000);
+    static void stopTrace();
+
+    /// Write collected events in Chrome trace event JSON format
+    static bool writeChromeTrace(const std::string& filename);
+};
+
+class ScopedTimer
+{
+public:
+    ScopedTimer(ProfilingPhase phase) :
+        m_phase(phase),
+        m_begin(Profiler::Clock::now())
+    { }
+
+    ~ScopedTimer()
+    {
+        Profiler::add(m_phase, m_begin, Profiler::Clock::now());
+    }
+
+private:
+    ProfilingPhase m_phase;
+    Profiler::Clock::time_point m_begin;
+};
+
+}
+
+#endif // PROFILING_HPP_INCLUDED
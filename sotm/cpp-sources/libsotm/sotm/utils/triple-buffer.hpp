@@ -0,0 +1,64 @@
+#ifndef TRIPLE_BUFFER_HPP_INCLUDED
+#define TRIPLE_BUFFER_HPP_INCLUDED
+
+#include <atomic>
+
+namespace sotm
+{
+
+/**
+ * Lock-free handoff of latest value from one producer thread to one consumer thread.
+ * Producer fills writeBuffer() and publishes it, consumer takes latest published
+ * buffer by update(). Nobody waits: producer always has free buffer to write and
+ * consumer keeps its buffer until it takes newer one. Values published between
+ * consumer updates are skipped. Buffers are reused, so T may keep its capacity
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	/// Buffer owned by producer. Its content is buffer published two or more times before
+	T& writeBuffer() { return m_buffers[m_write]; }
+
+	/// Make writeBuffer() latest published value and take other buffer for writing
+	void publish()
+	{
+		unsigned int previous = m_middle.exchange(m_write | freshBit, std::memory_order_acq_rel);
+		m_write = previous & indexMask;
+	}
+
+	/**
+	 * Take latest published value to readBuffer() if it was published after previous update
+	 * @return true if readBuffer() changed
+	 */
+	bool update()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & freshBit) == 0)
+			return false;
+		unsigned int previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+		m_read = previous & indexMask;
+		return true;
+	}
+
+	/// Buffer owned by consumer. Default constructed value until first update()
+	T& readBuffer() { return m_buffers[m_read]; }
+	const T& readBuffer() const { return m_buffers[m_read]; }
+
+private:
+	constexpr static unsigned int indexMask = 3;
+	constexpr static unsigned int freshBit = 4;
+
+	T m_buffers[3];
+	/// Index of buffer between producer and consumer with freshBit if consumer did not take it yet
+	alignas(64) std::atomic<unsigned int> m_middle{1};
+	alignas(64) unsigned int m_write = 0;
+	alignas(64) unsigned int m_read = 2;
+};
+
+}
+
+#endif // TRIPLE_BUFFER_HPP_INCLUDED
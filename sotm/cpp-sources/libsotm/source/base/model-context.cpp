@@ -1,5 +1,5 @@
 #include "sotm/base/model-context.hpp"
-#include <tbb/tbb.h>
+#include "sotm/utils/profiling.hpp"
 
 using namespace sotm;
 
@@ -50,6 +50,7 @@ void ModelContext::calculateSecondaryValues(double time)
 
 void ModelContext::calculateRHS(double time)
 {
+	SOTM_PROFILE_SCOPE(ProfilingPhase::calculateRHS);
 	m_physicalContext->calculateRHS(time);
 	payloadsRegister.calculateRHS(time);
 }
@@ -80,13 +81,15 @@ double ModelContext::getMinimalStepsCount()
 void ModelContext::prepareBifurcation(double time, double dt)
 {
 	ASSERT(dt >= 0, "Cannot prepare bifurcations when dt < 0");
+	SOTM_PROFILE_SCOPE(ProfilingPhase::prepareBifurcation);
 
 	m_physicalContext->prepareBifurcation(time, dt);
 
-	if (parallelSettings.parallelBifurcationIteration.prepareBifurcation)
+	if (parallelSettings.runParallel(ParallelSettings::Phase::prepareBifurcation,
+			graphRegister.nodesCount() + graphRegister.linksCount()))
 	{
 		rebuildBufurcatableVectorIfNeeded();
-		tbb::parallel_for( size_t(0), m_bifurcatableObjects.size(),
+		parallelSettings.parallelFor(ParallelSettings::Phase::prepareBifurcation, 0, m_bifurcatableObjects.size(),
 			[this, time, dt]( size_t i ) {
 				m_bifurcatableObjects[i]->prepareBifurcation(time, dt);
 			}
@@ -111,6 +114,7 @@ void ModelContext::prepareBifurcation(double time, double dt)
 void ModelContext::doBifurcation(double time, double dt)
 {
 	ASSERT(dt >= 0, "Cannot iterate bifurcations when dt < 0");
+	SOTM_PROFILE_SCOPE(ProfilingPhase::doBifurcation);
 
 	m_physicalContext->doBifurcation(time, dt);
 
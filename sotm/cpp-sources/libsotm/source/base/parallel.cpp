@@ -1,3 +1,259 @@
 #include "sotm/base/parallel.hpp"
 
+#include <tbb/task_scheduler_observer.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+    #include <sched.h>
+#endif
+
 ParallelSettings ParallelSettings::parallelDisabled;
+
+namespace {
+
+#ifdef __linux__
+
+/// Parse CPUs list in sysfs format like "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list)
+{
+	std::vector<int> result;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ','))
+	{
+		if (range.empty() || range == "\n")
+			continue;
+		size_t dash = range.find('-');
+		int first = std::stoi(range.substr(0, dash));
+		int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+		for (int cpu = first; cpu <= last; cpu++)
+			result.push_back(cpu);
+	}
+	return result;
+}
+
+/// CPUs of every NUMA node that are allowed for process
+std::vector<std::vector<int>> systemNumaNodes()
+{
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	bool haveAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+	std::vector<std::vector<int>> nodes;
+	for (int node = 0; ; node++)
+	{
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if (!file.is_open())
+			break;
+		std::string list;
+		std::getline(file, list);
+		std::vector<int> cpus;
+		for (int cpu : parseCpuList(list))
+		{
+			if (!haveAllowed || CPU_ISSET(cpu, &allowed))
+				cpus.push_back(cpu);
+		}
+		if (!cpus.empty())
+			nodes.push_back(cpus);
+	}
+	return nodes;
+}
+
+/**
+ * Binds threads entering arena to CPUs of its NUMA node or, if pin, every thread slot
+ * to single CPU. Affinity of thread is restored when it leaves arena
+ */
+class CpuBindingObserver : public tbb::task_scheduler_observer
+{
+public:
+	CpuBindingObserver(tbb::task_arena& arena, const std::vector<int>& cpus, bool pin) :
+		tbb::task_scheduler_observer(arena),
+		m_cpus(cpus),
+		m_pin(pin)
+	{
+		observe(true);
+	}
+
+	~CpuBindingObserver()
+	{
+		observe(false);
+	}
+
+	void on_scheduler_entry(bool) override
+	{
+		if (m_depth++ != 0)
+			return;
+		m_restore = sched_getaffinity(0, sizeof(m_saved), &m_saved) == 0;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (m_pin)
+		{
+			int slot = tbb::this_task_arena::current_thread_index();
+			CPU_SET(m_cpus[size_t(slot < 0 ? 0 : slot) % m_cpus.size()], &set);
+		} else {
+			for (int cpu : m_cpus)
+				CPU_SET(cpu, &set);
+		}
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+
+	void on_scheduler_exit(bool) override
+	{
+		if (--m_depth != 0)
+			return;
+		if (m_restore)
+			sched_setaffinity(0, sizeof(m_saved), &m_saved);
+	}
+
+private:
+	std::vector<int> m_cpus;
+	bool m_pin;
+
+	static thread_local int m_depth;
+	static thread_local bool m_restore;
+	static thread_local cpu_set_t m_saved;
+};
+
+thread_local int CpuBindingObserver::m_depth = 0;
+thread_local bool CpuBindingObserver::m_restore = false;
+thread_local cpu_set_t CpuBindingObserver::m_saved;
+
+#else
+
+std::vector<std::vector<int>> systemNumaNodes()
+{
+	return std::vector<std::vector<int>>();
+}
+
+/// Threads binding is implemented for Linux only
+class CpuBindingObserver
+{
+public:
+	CpuBindingObserver(tbb::task_arena&, const std::vector<int>&, bool) {}
+};
+
+#endif
+
+}
+
+struct ParallelSettings::Arenas
+{
+	std::unique_ptr<tbb::task_arena> arena;
+	/// Empty if not numaAware
+	std::vector<std::unique_ptr<tbb::task_arena>> numaArenas;
+	/// Destroyed before arenas they observe
+	std::vector<std::unique_ptr<CpuBindingObserver>> observers;
+	/// Part of node i is [begin + size*weights[i]/weights.back(), begin + size*weights[i+1]/weights.back())
+	std::vector<size_t> weights;
+};
+
+ParallelSettings::ParallelSettings()
+{
+	reconfigure();
+}
+
+ParallelSettings::~ParallelSettings()
+{
+}
+
+void ParallelSettings::reconfigure()
+{
+	std::shared_ptr<Arenas> result = std::make_shared<Arenas>();
+
+	if (isolateArena || threadsCount != 0)
+	{
+		int concurrency = threadsCount == 0 ? int(tbb::task_arena::automatic) : int(threadsCount);
+		result->arena.reset(new tbb::task_arena(concurrency));
+	}
+
+	if (numaAware)
+	{
+		std::vector<std::vector<int>> nodesCpus = numaNodesCpus.empty() ? systemNumaNodes() : numaNodesCpus;
+		if (nodesCpus.empty())
+			nodesCpus.push_back(std::vector<int>());
+
+		size_t totalCpus = 0;
+		for (auto &it : nodesCpus)
+			totalCpus += it.size();
+
+		result->weights.push_back(0);
+		for (auto &cpus : nodesCpus)
+		{
+			// Node without known CPUs gets tbb default concurrency
+			int concurrency = cpus.empty() ? int(tbb::task_arena::automatic) : int(cpus.size());
+			if (threadsCount != 0 && !cpus.empty())
+				concurrency = int(std::max<size_t>(1, (threadsCount * cpus.size() + totalCpus - 1) / totalCpus));
+
+			result->numaArenas.emplace_back(new tbb::task_arena(concurrency));
+			result->numaArenas.back()->initialize();
+			if (!cpus.empty())
+				result->observers.emplace_back(new CpuBindingObserver(*result->numaArenas.back(), cpus, pinThreads));
+			result->weights.push_back(result->weights.back() + (cpus.empty() ? 1 : size_t(concurrency)));
+		}
+	}
+
+	m_arenas = result;
+}
+
+bool ParallelSettings::enabled(Phase phase) const
+{
+	switch (phase)
+	{
+	case Phase::calculateSecondaryValues: return parallelContiniousIteration.calculateSecondaryValues;
+	case Phase::calculateRHS:             return parallelContiniousIteration.calculateRHS;
+	case Phase::addRHSToDelta:            return parallelContiniousIteration.addRHSToDelta;
+	case Phase::makeSubIteration:         return parallelContiniousIteration.makeSubIteration;
+	case Phase::step:                     return parallelContiniousIteration.step;
+	case Phase::prepareBifurcation:       return parallelBifurcationIteration.prepareBifurcation;
+	default:                              return false;
+	}
+}
+
+bool ParallelSettings::runParallel(Phase phase, size_t size) const
+{
+	return enabled(phase) && size > 1 && size >= serialThreshold;
+}
+
+size_t ParallelSettings::numaNodesCount() const
+{
+	return numaNodesCount(*m_arenas);
+}
+
+void ParallelSettings::numaPart(size_t node, size_t begin, size_t end, size_t& partBegin, size_t& partEnd) const
+{
+	numaPart(*m_arenas, node, begin, end, partBegin, partEnd);
+}
+
+size_t ParallelSettings::numaNodesCount(const Arenas& arenas)
+{
+	return arenas.numaArenas.empty() ? 1 : arenas.numaArenas.size();
+}
+
+void ParallelSettings::numaPart(const Arenas& arenas, size_t node, size_t begin, size_t end, size_t& partBegin, size_t& partEnd)
+{
+	if (arenas.numaArenas.empty())
+	{
+		partBegin = node == 0 ? begin : end;
+		partEnd = end;
+		return;
+	}
+	const std::vector<size_t>& weights = arenas.weights;
+	size_t size = end - begin;
+	partBegin = begin + size * weights[node] / weights.back();
+	partEnd = begin + size * weights[node + 1] / weights.back();
+}
+
+tbb::task_arena* ParallelSettings::arena(const Arenas& arenas)
+{
+	return arenas.arena.get();
+}
+
+tbb::task_arena& ParallelSettings::numaArena(const Arenas& arenas, size_t node)
+{
+	return *arenas.numaArenas[node];
+}
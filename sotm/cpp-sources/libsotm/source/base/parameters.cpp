@@ -1,4 +1,5 @@
 #include "sotm/base/parameters.hpp"
+#include "sotm/utils/log.hpp"
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
@@ -55,7 +56,7 @@ void ParametersGroup::save(const std::string& filename)
 	ofstream outputFile(filename.c_str(), std::ios::out);
 	if (!outputFile.is_open())
 	{
-		cerr << "ERROR: Cannot open file " << filename << " to write current parameters!" << endl;
+		SOTM_LOG(error) << "Cannot open file " << filename << " to write current parameters!";
 		return;
 	}
 
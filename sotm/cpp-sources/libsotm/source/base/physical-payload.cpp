@@ -8,8 +8,6 @@
 #include "sotm/base/physical-payload.hpp"
 #include "sotm/utils/assert.hpp"
 
-#include <tbb/tbb.h>
-
 using namespace sotm;
 
 PhysicalPayloadsRegister::PhysicalPayloadsRegister(const ParallelSettings* parallelSettings) :
@@ -49,10 +47,10 @@ void PhysicalPayloadsRegister::clearSubiteration()
 
 void PhysicalPayloadsRegister::calculateSecondaryValues(double time)
 {
-	if (m_parallelSettings->parallelContiniousIteration.calculateSecondaryValues)
+	if (m_parallelSettings->runParallel(ParallelSettings::Phase::calculateSecondaryValues, m_payloads.size()))
 	{
 		rebuildPayloadsVectorIfNeeded();
-		tbb::parallel_for( size_t(0), m_payloadsVector.size(),
+		m_parallelSettings->parallelFor(ParallelSettings::Phase::calculateSecondaryValues, 0, m_payloadsVector.size(),
 			[this, time]( size_t i ) {
 				m_payloadsVector[i]->calculateSecondaryValues(time);
 			}
@@ -65,10 +63,10 @@ void PhysicalPayloadsRegister::calculateSecondaryValues(double time)
 
 void PhysicalPayloadsRegister::calculateRHS(double time)
 {
-	if (m_parallelSettings->parallelContiniousIteration.calculateRHS)
+	if (m_parallelSettings->runParallel(ParallelSettings::Phase::calculateRHS, m_payloads.size()))
 	{
 		rebuildPayloadsVectorIfNeeded();
-		tbb::parallel_for( size_t(0), m_payloadsVector.size(),
+		m_parallelSettings->parallelFor(ParallelSettings::Phase::calculateRHS, 0, m_payloadsVector.size(),
 			[this, time]( size_t i ) {
 				m_payloadsVector[i]->calculateRHS(time);
 			}
@@ -81,10 +79,10 @@ void PhysicalPayloadsRegister::calculateRHS(double time)
 
 void PhysicalPayloadsRegister::addRHSToDelta(double m)
 {
-	if (m_parallelSettings->parallelContiniousIteration.addRHSToDelta)
+	if (m_parallelSettings->runParallel(ParallelSettings::Phase::addRHSToDelta, m_payloads.size()))
 	{
 		rebuildPayloadsVectorIfNeeded();
-		tbb::parallel_for( size_t(0), m_payloadsVector.size(),
+		m_parallelSettings->parallelFor(ParallelSettings::Phase::addRHSToDelta, 0, m_payloadsVector.size(),
 			[this, m]( size_t i ) {
 				m_payloadsVector[i]->addRHSToDelta(m);
 			}
@@ -97,10 +95,10 @@ void PhysicalPayloadsRegister::addRHSToDelta(double m)
 
 void PhysicalPayloadsRegister::makeSubIteration(double dt)
 {
-	if (m_parallelSettings->parallelContiniousIteration.addRHSToDelta)
+	if (m_parallelSettings->runParallel(ParallelSettings::Phase::makeSubIteration, m_payloads.size()))
 	{
 		rebuildPayloadsVectorIfNeeded();
-		tbb::parallel_for( size_t(0), m_payloadsVector.size(),
+		m_parallelSettings->parallelFor(ParallelSettings::Phase::makeSubIteration, 0, m_payloadsVector.size(),
 			[this, dt]( size_t i ) {
 				m_payloadsVector[i]->makeSubIteration(dt);
 			}
@@ -113,10 +111,10 @@ void PhysicalPayloadsRegister::makeSubIteration(double dt)
 
 void PhysicalPayloadsRegister::step()
 {
-	if (m_parallelSettings->parallelContiniousIteration.step)
+	if (m_parallelSettings->runParallel(ParallelSettings::Phase::step, m_payloads.size()))
 	{
 		rebuildPayloadsVectorIfNeeded();
-		tbb::parallel_for( size_t(0), m_payloadsVector.size(),
+		m_parallelSettings->parallelFor(ParallelSettings::Phase::step, 0, m_payloadsVector.size(),
 			[this]( size_t i ) {
 				m_payloadsVector[i]->step();
 			}
@@ -141,7 +139,9 @@ double PhysicalPayloadsRegister::getMinimalStepsCount()
 
 void PhysicalPayloadsRegister::destroyAll()
 {
-    for (auto &it: m_payloads)
+    // onDeletePayload() removes payload from m_payloads, so iterating over a copy
+    std::vector<AnyPhysicalPayloadBase*> payloads(m_payloads.begin(), m_payloads.end());
+    for (auto &it: payloads)
         it->onDeletePayload();
 }
 
@@ -1,7 +1,7 @@
 #include "sotm/base/time-iter.hpp"
 #include "sotm/utils/assert.hpp"
-
-#include <iostream>
+#include "sotm/utils/profiling.hpp"
+#include "sotm/utils/log.hpp"
 
 using namespace sotm;
 
@@ -9,7 +9,7 @@ const ContiniousIteratorParameters ContinuousTimeIteratorBase::defaultParameters
 
 void TimeHookPeriodic::runHook(double time)
 {
-	std::cout << "Next run: " << m_nextRun << std::endl;
+	SOTM_LOG(trace) << "Next run: " << m_nextRun;
 	//m_lastRun = time;
 	hook(time, m_nextRun);
 	m_nextRun += m_period;
@@ -182,11 +182,17 @@ void TimeIterator::callHook()
 	if (m_timeHooks.empty())
 		return;
 	double time = m_continiousIterator->time();
-	if (time >= m_nextHookTime)
+	if (time < m_nextHookTime)
+		return;
+
+	SOTM_PROFILE_SCOPE(ProfilingPhase::outputHooks);
+	// Every due hook runs once, so hook that is due after every iteration does not block others
+	for (auto &hook : m_timeHooks)
 	{
-		m_timeHooks[m_nextHook]->runHook(time);
-		findNextHook();
+		if (hook->getNextTime() <= time)
+			hook->runHook(time);
 	}
+	findNextHook();
 }
 
 void TimeIterator::findNextHook()
@@ -223,3 +229,8 @@ ContiniousIteratorParameters& TimeIterator::continiousIterParameters()
 {
 	return m_contIteratorParameters;
 }
+
+const ContiniousIteratorMetrics& TimeIterator::metrics()
+{
+	return m_continiousIterator->metrics();
+}
@@ -2,12 +2,132 @@
 #include "sotm/base/model-context.hpp"
 #include "sotm/base/physical-payload.hpp"
 #include "sotm/utils/utils.hpp"
+#include "sotm/utils/profiling.hpp"
 
 #include <tbb/tbb.h>
 
+#include <algorithm>
+#include <numeric>
+
 using namespace sotm;
 using namespace tbb;
 
+////////////////////////////
+// GraphAdjacency
+
+void GraphAdjacency::build(const std::set<Node*>& nodes, const std::set<Link*>& links)
+{
+	this->nodes.assign(nodes.begin(), nodes.end());
+	m_nodeIndexes.clear();
+	m_nodeIndexes.reserve(this->nodes.size());
+	for (size_t i = 0; i < this->nodes.size(); i++)
+		m_nodeIndexes[this->nodes[i]] = i;
+
+	this->links.clear();
+	linkNodes.clear();
+	linkLengths.clear();
+	std::vector<size_t> degrees(this->nodes.size(), 0);
+	for (auto link : links)
+	{
+		if (!link->isConnected())
+			continue;
+		size_t n1 = nodeIndex(link->getNode1());
+		size_t n2 = nodeIndex(link->getNode2());
+		if (n1 == noIndex || n2 == noIndex)
+			continue;
+		this->links.push_back(link);
+		linkNodes.emplace_back(n1, n2);
+		linkLengths.push_back(link->length());
+		degrees[n1]++;
+		degrees[n2]++;
+	}
+
+	rowBegins.resize(this->nodes.size() + 1);
+	rowBegins[0] = 0;
+	std::partial_sum(degrees.begin(), degrees.end(), rowBegins.begin() + 1);
+
+	neighbours.resize(rowBegins.back());
+	neighbourLinks.resize(rowBegins.back());
+	std::vector<size_t> filled(rowBegins.begin(), rowBegins.end() - 1);
+	for (size_t i = 0; i < linkNodes.size(); i++)
+	{
+		size_t n1 = linkNodes[i].first, n2 = linkNodes[i].second;
+		neighbours[filled[n1]] = n2; neighbourLinks[filled[n1]++] = i;
+		neighbours[filled[n2]] = n1; neighbourLinks[filled[n2]++] = i;
+	}
+
+	// Sorting every row by neighbour index to use binary search
+	std::vector<std::pair<size_t, size_t>> row;
+	for (size_t node = 0; node < this->nodes.size(); node++)
+	{
+		row.clear();
+		for (size_t j = rowBegins[node]; j < rowBegins[node+1]; j++)
+			row.emplace_back(neighbours[j], neighbourLinks[j]);
+		std::sort(row.begin(), row.end());
+		for (size_t j = 0; j < row.size(); j++)
+		{
+			neighbours[rowBegins[node] + j] = row[j].first;
+			neighbourLinks[rowBegins[node] + j] = row[j].second;
+		}
+	}
+}
+
+size_t GraphAdjacency::nodeIndex(const Node* node) const
+{
+	auto it = m_nodeIndexes.find(node);
+	return it == m_nodeIndexes.end() ? noIndex : it->second;
+}
+
+bool GraphAdjacency::hasNeighbour(size_t node, size_t neighbour) const
+{
+	auto begin = neighbours.begin() + rowBegins[node];
+	auto end = neighbours.begin() + rowBegins[node+1];
+	return std::binary_search(begin, end, neighbour);
+}
+
+bool GraphAdjacency::hasNeighbour(const Node* node, const Node* neighbour) const
+{
+	size_t n1 = nodeIndex(node), n2 = nodeIndex(neighbour);
+	if (n1 == noIndex || n2 == noIndex)
+		return false;
+	return hasNeighbour(n1, n2);
+}
+
+void GraphAdjacency::partition(size_t maxBlockSize, std::vector<std::vector<size_t>>& blocks) const
+{
+	ASSERT(maxBlockSize > 0, "Block size should be positive");
+	blocks.clear();
+	std::vector<bool> assigned(nodes.size(), false);
+	std::vector<size_t> queue;
+	for (size_t seed = 0; seed < nodes.size(); seed++)
+	{
+		if (assigned[seed])
+			continue;
+		std::vector<size_t> block;
+		queue.clear();
+		queue.push_back(seed);
+		assigned[seed] = true;
+		for (size_t head = 0; head < queue.size() && block.size() < maxBlockSize; head++)
+		{
+			size_t node = queue[head];
+			block.push_back(node);
+			for (size_t j = rowBegins[node]; j < rowBegins[node+1]; j++)
+			{
+				size_t neighbour = neighbours[j];
+				if (!assigned[neighbour] && block.size() + queue.size() - head - 1 < maxBlockSize)
+				{
+					assigned[neighbour] = true;
+					queue.push_back(neighbour);
+				}
+			}
+		}
+		blocks.push_back(block);
+	}
+}
+
+////////////////////////////
+// GraphRegister
+
 void GraphRegister::addLink(Link* link)
 {
 	ASSERT(m_links.find(link) == m_links.end() && m_linksToAdd.find(link) == m_linksToAdd.end(),
@@ -17,6 +137,7 @@ void GraphRegister::addLink(Link* link)
 		m_linksToAdd.insert(link);
 	} else {
 		m_links.insert(link);
+		record(GraphChange::Type::linkAdded, nullptr, link);
 		changeStateHash();
 	}
 }
@@ -30,6 +151,7 @@ void GraphRegister::addNode(Node* node)
 		m_nodesToAdd.insert(node);
 	} else {
 		m_nodes.insert(node);
+		record(GraphChange::Type::nodeAdded, node, nullptr);
 		changeStateHash();
 	}
 }
@@ -42,6 +164,7 @@ void GraphRegister::rmLink(Link* link)
 		m_linksToDelete.insert(link);
 	} else {
 		m_links.erase(link);
+		record(GraphChange::Type::linkRemoved, nullptr, link);
 		changeStateHash();
 	}
 }
@@ -54,10 +177,33 @@ void GraphRegister::rmNode(Node* node)
 		m_nodesToDelete.insert(node);
 	} else {
 		m_nodes.erase(node);
+		record(GraphChange::Type::nodeRemoved, node, nullptr);
 		changeStateHash();
 	}
 }
 
+void GraphRegister::linkConnected()
+{
+	if (m_iteratingNow)
+		m_connectionsChanged = true;
+	else
+		changeStateHash();
+}
+
+GraphRegister::ChangesBatch::ChangesBatch(GraphRegister& graph) :
+	m_graph(graph),
+	m_outer(!graph.m_iteratingNow)
+{
+	if (m_outer)
+		m_graph.beginIterating();
+}
+
+GraphRegister::ChangesBatch::~ChangesBatch()
+{
+	if (m_outer)
+		m_graph.endIterating();
+}
+
 void GraphRegister::applyNodeVisitor(NodeVisitor v)
 {
 	beginIterating();
@@ -115,14 +261,14 @@ void GraphRegister::applyLinkVisitorWithoutGraphChganges(LinkVisitor v, bool opt
 Node* GraphRegister::getNearestNode(const StaticVector<3>& point, bool searchOverReceintlyAdded)
 {
 	Node* result = nullptr;
-	double minDist = 0.0;
+	double minDistSquared = 0.0;
 
-	auto visitor = [&point, &minDist, &result] (Node* node) {
-        double d = (node->pos - point).norm();
-		if (d < minDist || result == nullptr)
+	auto visitor = [&point, &minDistSquared, &result] (Node* node) {
+        double d = distanceSquared(node->pos, point);
+		if (d < minDistSquared || result == nullptr)
 		{
 			result = node;
-			minDist = d;
+			minDistSquared = d;
 		}
 	};
 
@@ -151,6 +297,20 @@ size_t GraphRegister::stateHash()
 	return m_stateHash;
 }
 
+const GraphAdjacency& GraphRegister::adjacency()
+{
+	if (m_adjacencyStateHash != m_stateHash)
+	{
+		std::unique_lock<std::mutex> lock(m_adjacencyMutex);
+		if (m_adjacencyStateHash != m_stateHash)
+		{
+			m_adjacency.build(m_nodes, m_links);
+			m_adjacencyStateHash = m_stateHash;
+		}
+	}
+	return m_adjacency;
+}
+
 void GraphRegister::beginIterating()
 {
 	m_iteratingNow = true;
@@ -158,31 +318,40 @@ void GraphRegister::beginIterating()
 
 void GraphRegister::endIterating()
 {
+	SOTM_PROFILE_SCOPE(ProfilingPhase::graphCommit);
 	m_iteratingNow = false;
 
 	if (!m_nodesToAdd.empty()
 		|| !m_nodesToDelete.empty()
 		|| !m_linksToAdd.empty()
-		|| !m_linksToDelete.empty())
+		|| !m_linksToDelete.empty()
+		|| m_connectionsChanged)
 	{
+		m_connectionsChanged = false;
 		changeStateHash();
     } else {
 		return;
     }
 
 	m_nodes.insert(m_nodesToAdd.begin(), m_nodesToAdd.end());
+	for (auto it = m_nodesToAdd.begin(); it != m_nodesToAdd.end(); ++it)
+		record(GraphChange::Type::nodeAdded, *it, nullptr);
 
 	m_nodesToAdd.clear();
 	m_links.insert(m_linksToAdd.begin(), m_linksToAdd.end());
+	for (auto it = m_linksToAdd.begin(); it != m_linksToAdd.end(); ++it)
+		record(GraphChange::Type::linkAdded, nullptr, *it);
 	m_linksToAdd.clear();
 	for (auto it = m_nodesToDelete.begin(); it != m_nodesToDelete.end(); ++it)
 	{
 		m_nodes.erase(*it);
+		record(GraphChange::Type::nodeRemoved, *it, nullptr);
 	}
 	m_nodesToDelete.clear();
 	for (auto it = m_linksToDelete.begin(); it != m_linksToDelete.end(); ++it)
 	{
 		m_links.erase(*it);
+		record(GraphChange::Type::linkRemoved, nullptr, *it);
 	}
 	m_linksToDelete.clear();
 }
@@ -192,6 +361,58 @@ void GraphRegister::changeStateHash()
 	m_stateHash++;
 }
 
+size_t GraphRegister::journalEnd()
+{
+	std::unique_lock<std::mutex> lock(m_journalMutex);
+	return m_journalBegin + m_journal.size();
+}
+
+bool GraphRegister::changesSince(size_t& position, std::vector<GraphChange>& changes)
+{
+	std::unique_lock<std::mutex> lock(m_journalMutex);
+	changes.clear();
+	size_t end = m_journalBegin + m_journal.size();
+	if (position < m_journalBegin || position > end)
+	{
+		position = end;
+		return false;
+	}
+	changes.insert(changes.end(), m_journal.begin() + (position - m_journalBegin), m_journal.end());
+	position = end;
+	return true;
+}
+
+void GraphRegister::setJournalCapacity(size_t capacity)
+{
+	std::unique_lock<std::mutex> lock(m_journalMutex);
+	m_journalCapacity = capacity;
+	while (m_journal.size() > m_journalCapacity)
+	{
+		m_journal.pop_front();
+		m_journalBegin++;
+	}
+}
+
+void GraphRegister::record(GraphChange::Type type, Node* node, Link* link)
+{
+	std::unique_lock<std::mutex> lock(m_journalMutex);
+	if (m_journalCapacity == 0)
+	{
+		m_journalBegin++;
+		return;
+	}
+	if (m_journal.size() == m_journalCapacity)
+	{
+		m_journal.pop_front();
+		m_journalBegin++;
+	}
+	GraphChange change;
+	change.type = type;
+	change.node = node;
+	change.link = link;
+	m_journal.push_back(change);
+}
+
 void GraphRegister::buildVectorsForIteration()
 {
     if (m_nodesLinksVectorsStateHash != m_stateHash)
@@ -202,7 +423,7 @@ void GraphRegister::buildVectorsForIteration()
         if (m_nodesLinksVectorsStateHash == m_stateHash)
             return;
         m_nodesVector = NodeVector(m_nodes.begin(), m_nodes.end());
-        m_linksVector = LinkVector(m_linksVector.begin(), m_linksVector.end());
+        m_linksVector = LinkVector(m_links.begin(), m_links.end());
         m_nodesLinksVectorsStateHash = m_stateHash;
     }
 }
@@ -326,6 +547,10 @@ void Link::connect(Node* n1, Node* n2)
 	m_n2.assign(n2);
 	n1->addLink(this);
 	n2->addLink(this);
+	m_length = distance(n1->pos, n2->pos);
+	m_inverseLength = m_length == 0.0 ? 0.0 : 1.0 / m_length;
+	// Adjacency snapshots are rebuilt by state hash
+	m_context->graphRegister.linkConnected();
 }
 
 Node* Link::getNode1()
@@ -338,21 +563,12 @@ Node* Link::getNode2()
 	return m_n2.data();
 }
 
-Node* Link::getNode(unsigned int index)
-{
-	return index == 0 ? m_n1.data() : m_n2.data();
-}
-
-double Link::length()
+bool Link::isConnected()
 {
-    return (m_n1->pos - m_n2->pos).norm();
+	return m_n1.assigned() && m_n2.assigned();
 }
 
-double Link::lengthCached()
+Node* Link::getNode(unsigned int index)
 {
-	if (m_lengthCached < 0.0) {
-		m_lengthCached = length();
-	}
-	return m_lengthCached;
+	return index == 0 ? m_n1.data() : m_n2.data();
 }
-
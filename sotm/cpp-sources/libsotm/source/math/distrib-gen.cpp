@@ -18,8 +18,8 @@ DistributionResult<SphericalPoint> sotm::generateDischargeDirection(
 		double r,
 		double E0,
 		double E1,
-		Function1D distribution,
-		Function1D integralDistribution
+		const Function1D& distribution,
+		const DefinedIntegral& integralDistribution
 )
 {
 	/**
@@ -33,11 +33,11 @@ DistributionResult<SphericalPoint> sotm::generateDischargeDirection(
 
 	if (fabs(E0 / E1) < externalMin) {
 		// We have small external field so we can generate uniform distribution by Omega
-        double val = Random::uniform(0.0, 1.0) / (2*M_PI * r * r * dt * distribution(E1));
+		double val = Random::uniform(0.0, 1.0) / (2*M_PI * r * r * dt * distribution(E1));
 		if (val <= 2.0)
 		{
 			double cosTheta = 1.0-val;
-            result.phi = Random::uniform(0.0, 2*M_PI);
+			result.phi = Random::uniform(0.0, 2*M_PI);
 			result.theta = acos(cosTheta);
 			return DistributionResult<SphericalPoint>(result);
 		} else {
@@ -45,21 +45,19 @@ DistributionResult<SphericalPoint> sotm::generateDischargeDirection(
 		}
 	}
 
-    double val = Random::uniform(0.0, 1.0) * E0 / (2*M_PI * r * r * dt);
+	double val = Random::uniform(0.0, 1.0) * E0 / (2*M_PI * r * r * dt);
 	double tmp = integralDistribution(E0+E1) - val;
 	if (tmp < 0)
 	{
 		return DistributionResult<SphericalPoint>();
 	}
 
-    result.phi = Random::uniform(0.0, 2*M_PI);
+	result.phi = Random::uniform(0.0, 2*M_PI);
 
-    MonotonicFunctionSolver solver(integralDistribution, E1-1.5*E0, E1+1.5*E0, M_PI / 1000.0);
-
-	if (!solver.inRange(tmp))
+	double arg = 0.0; // == E_1 + E_0 * cos(theta)
+	if (!integralDistribution.inverse(tmp, E1-1.5*E0, E1+1.5*E0, arg))
 		return DistributionResult<SphericalPoint>();
 
-	double arg = solver(tmp); // == E_1 + E_0 * cos(theta)
 	double cosTheta = (arg-E1)/E0;
 	if (cosTheta > 1.0 || cosTheta < -1.0)
 		return DistributionResult<SphericalPoint>();
@@ -17,7 +17,7 @@ TrapezoidFunc::TrapezoidFunc(double amplitude, double zScale, double zRecession,
 	ASSERT(m_zRecession >= 0.0, "TrapezoidFunc: zRecession should not be negative");
 }
 
-double TrapezoidFunc::operator()(double z)
+double TrapezoidFunc::operator()(double z) const
 {
 	double dz = z - m_z0;
 	if (std::abs(dz) <= m_zScale / 2.0)
@@ -47,7 +47,22 @@ double TrapezoidFunc::operator()(double z)
 	return 0.0;
 }
 
-double TrapezoidFunc::maxAbs()
+double TrapezoidFunc::derivative(double z) const
+{
+	double dz = z - m_z0;
+	if (std::abs(dz) <= m_zScale / 2.0)
+		return m_amplitude;
+
+	if (std::abs(dz) >= m_zScale / 2.0 + m_zRecession)
+		return 0.0;
+
+	if (dz > m_zScale / 2.0)
+		return -2.0 * m_a * (dz - m_zScale / 2.0 - m_zRecession);
+
+	return 2.0 * m_a * (dz + m_zScale / 2.0 + m_zRecession);
+}
+
+double TrapezoidFunc::maxAbs() const
 {
 	return m_c;
 }
@@ -8,32 +8,79 @@
 #include "sotm/math/integration.hpp"
 
 #include <cmath>
+#include <algorithm>
 
 using namespace sotm;
 
 DefinedIntegral::DefinedIntegral(Function1D target, double from, double to, size_t pointsCount) :
 		m_from(from),
-		m_to(to)
+		m_to(to),
+		m_dx((to - from) / pointsCount)
 {
 	m_results.resize(pointsCount, 0);
-	double range = m_to - m_from;
-	double dx = range / pointsCount;
 
+	// m_results[i] is integral from m_from to pointArg(i)
 	for (size_t i=1; i<pointsCount; i++)
 	{
-		m_results[i] = m_results[i-1] + target(m_from + dx*(i-0.5))*dx;
+		m_results[i] = m_results[i-1] + target(m_from + m_dx*(i-0.5))*m_dx;
 	}
 }
 
-double DefinedIntegral::operator()(double arg)
+double DefinedIntegral::operator()(double arg) const
 {
-	if (arg < m_from)
+	if (arg <= m_from)
 		return 0;
 
-	if (arg > m_to)
+	double position = (arg - m_from) / m_dx;
+	if (position >= m_results.size() - 1)
 		return m_results.back();
 
-	size_t index = round((arg-m_from) * (m_results.size()-1) / (m_to - m_from));
-	return m_results[index];
+	size_t index = position;
+	double t = position - index;
+	return m_results[index] + (m_results[index+1] - m_results[index]) * t;
+}
+
+bool DefinedIntegral::inverse(double value, double from, double to, double& arg) const
+{
+	double fromValue = (*this)(from);
+	double toValue = (*this)(to);
+	if ((fromValue - value) * (toValue - value) > 0)
+		return false;
+
+	auto begin = m_results.begin() + pointIndex(from);
+	auto end = m_results.begin() + std::min(pointIndex(to) + 2, m_results.size());
+	auto it = std::lower_bound(begin, end, value);
+
+	if (it == begin)
+	{
+		arg = from;
+		return true;
+	}
+
+	if (it == end)
+	{
+		arg = to;
+		return true;
+	}
+
+	size_t index = it - m_results.begin();
+	double t = (value - m_results[index-1]) / (m_results[index] - m_results[index-1]);
+	arg = std::min(std::max(pointArg(index-1) + t * m_dx, from), to);
+	return true;
+}
+
+double DefinedIntegral::pointArg(size_t index) const
+{
+	return m_from + index * m_dx;
+}
+
+size_t DefinedIntegral::pointIndex(double arg) const
+{
+	if (arg <= m_from)
+		return 0;
+	double position = floor((arg - m_from) / m_dx);
+	if (position >= m_results.size() - 1)
+		return m_results.size() - 1;
+	return position;
 }
 
@@ -0,0 +1,74 @@
+#include "sotm/math/krylov.hpp"
+
+#include <utility>
+
+using namespace sotm;
+
+void BlockJacobiPreconditioner::operator()(const std::vector<double>& r, std::vector<double>& z) const
+{
+    z.resize(r.size());
+    std::vector<double> y;
+    for (size_t b = 0; b < m_blocks.size(); b++)
+    {
+        const std::vector<size_t>& block = m_blocks[b];
+        const std::vector<double>& lu = m_factors[b];
+        const std::vector<size_t>& pivots = m_pivots[b];
+        size_t n = block.size();
+
+        y.resize(n);
+        for (size_t i = 0; i < n; i++)
+            y[i] = r[block[pivots[i]]];
+
+        // L y = P r, L has unit diagonal
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < i; j++)
+                y[i] -= lu[i*n + j] * y[j];
+
+        // U x = y
+        for (size_t i = n; i-- > 0; )
+        {
+            for (size_t j = i + 1; j < n; j++)
+                y[i] -= lu[i*n + j] * y[j];
+            // Singular block is skipped, that is identity preconditioning for its rest
+            if (lu[i*n + i] != 0.0)
+                y[i] /= lu[i*n + i];
+        }
+
+        for (size_t i = 0; i < n; i++)
+            z[block[i]] = y[i];
+    }
+}
+
+void BlockJacobiPreconditioner::factorize(std::vector<double>& lu, std::vector<size_t>& pivots, size_t n)
+{
+    pivots.resize(n);
+    for (size_t i = 0; i < n; i++)
+        pivots[i] = i;
+
+    for (size_t k = 0; k < n; k++)
+    {
+        size_t pivot = k;
+        for (size_t i = k + 1; i < n; i++)
+            if (std::fabs(lu[i*n + k]) > std::fabs(lu[pivot*n + k]))
+                pivot = i;
+
+        if (pivot != k)
+        {
+            for (size_t j = 0; j < n; j++)
+                std::swap(lu[k*n + j], lu[pivot*n + j]);
+            std::swap(pivots[k], pivots[pivot]);
+        }
+
+        double diagonal = lu[k*n + k];
+        if (diagonal == 0.0)
+            continue;
+
+        for (size_t i = k + 1; i < n; i++)
+        {
+            double factor = lu[i*n + k] / diagonal;
+            lu[i*n + k] = factor;
+            for (size_t j = k + 1; j < n; j++)
+                lu[i*n + j] -= factor * lu[k*n + j];
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#include "sotm/math/spatial-hash-grid.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace sotm;
+
+SpatialHashGridBase::SpatialHashGridBase(double cellSize) :
+    m_cellSize(cellSize)
+{
+    if (!(cellSize > 0.0))
+        throw std::runtime_error("Spatial hash grid cell size should be positive");
+}
+
+int64_t SpatialHashGridBase::cellIndex(double coordinate) const
+{
+    return static_cast<int64_t>(std::floor(coordinate / m_cellSize));
+}
+
+SpatialHashGridBase::Key SpatialHashGridBase::key(int64_t ix, int64_t iy, int64_t iz)
+{
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return (uint64_t(ix) & mask) << 42 | (uint64_t(iy) & mask) << 21 | (uint64_t(iz) & mask);
+}
+
+SpatialHashGridBase::Key SpatialHashGridBase::key(const StaticVector<3>& point) const
+{
+    return key(cellIndex(point[0]), cellIndex(point[1]), cellIndex(point[2]));
+}
@@ -4,61 +4,125 @@
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <type_traits>
 
 using namespace sotm;
 
+namespace {
+
+/// Part of nodes cloud size, pairs closer than it are evaluated in double if Storage is narrower
+const double nearFraction = 1e-2;
+
+}
+
 //////////////////////
 // CoulombBruteForce
-CoulombBruteForce::CoulombBruteForce(GraphRegister& graph) :
+template<typename Storage, typename Accumulator>
+CoulombBruteForceT<Storage, Accumulator>::CoulombBruteForceT(GraphRegister& graph) :
     m_graph(graph)
 {
     // todo: add scales to m_scales
 }
 
-FieldPotential CoulombBruteForce::getFP(StaticVector<3> pos, CoulombNodeBase* exclude)
+template<typename Storage, typename Accumulator>
+FieldPotential CoulombBruteForceT<Storage, Accumulator>::getFP(StaticVector<3> pos, CoulombNodeBase* exclude)
 {
     buildNodesVector();
 
-    double potential = 0.0;
-    StaticVector<3> E;
+    Storage target[3];
+    double extent = m_extent;
+    for (int i = 0; i < 3; i++)
+    {
+        target[i] = Storage(pos.x[i] - m_origin.x[i]);
+        extent = std::max(extent, std::fabs(pos.x[i] - m_origin.x[i]));
+    }
+    const Storage nearSquared = Storage(nearFraction * extent * nearFraction * extent);
+
+    // Excluded node splits arrays to two ranges, so kernel loop has no branches
+    size_t size = m_x.size();
+    size_t excluded = size;
+    if (exclude != nullptr)
+    {
+        CoulombNodeBruteForce* node = static_cast<CoulombNodeBruteForce*>(exclude);
+        if (node->m_index < size && m_nodesNotIsolatedVector[node->m_index] == node)
+            excluded = node->m_index;
+    }
+
+    FieldPotentialT<Accumulator> result;
+    sum(result, pos, target, nearSquared, 0, excluded);
+    if (excluded != size)
+        sum(result, pos, target, nearSquared, excluded + 1, size);
+
+    const Accumulator k = Const::Si::k;
+    return FieldPotential(
+        double(k * result.field.x[0]), double(k * result.field.x[1]), double(k * result.field.x[2]),
+        double(k * result.potential)
+    );
+}
 
-    for (auto it: m_nodesNotIsolatedVector)
+template<typename Storage, typename Accumulator>
+void CoulombBruteForceT<Storage, Accumulator>::sum(FieldPotentialT<Accumulator>& result, const StaticVector<3>& pos, const Storage* target, Storage nearSquared, size_t begin, size_t end) const
+{
+    const Storage* x = m_x.data();
+    const Storage* y = m_y.data();
+    const Storage* z = m_z.data();
+    const double* const* q = m_charges.data();
+    const Storage tx = target[0], ty = target[1], tz = target[2];
+
+    Accumulator potential = 0, ex = 0, ey = 0, ez = 0;
+    for (size_t i = begin; i < end; i++)
     {
-        // Skip this node
-        if (static_cast<CoulombNodeBase*>(it) == exclude)
+        Storage dx = tx - x[i];
+        Storage dy = ty - y[i];
+        Storage dz = tz - z[i];
+        Storage distanceSquared = dx * dx + dy * dy + dz * dz;
+        if (!std::is_same<Storage, double>::value && distanceSquared < nearSquared)
+        {
+            // Stored coordinates are rounded, so near pair is evaluated from node position
+            StaticVector<3> d = pos - m_nodesNotIsolatedVector[i]->node.pos;
+            double inverseExact = 1.0 / d.norm();
+            double dpExact = *q[i] * inverseExact;
+            double tmpExact = dpExact * inverseExact * inverseExact;
+            potential += Accumulator(dpExact);
+            ex += Accumulator(tmpExact * d.x[0]);
+            ey += Accumulator(tmpExact * d.x[1]);
+            ez += Accumulator(tmpExact * d.x[2]);
             continue;
-        StaticVector<3> r1 = it->node.pos;
-        double dist = (pos - r1).norm();
-        double charge = it->charge;
-
-        double dp = Const::Si::k * charge / dist;
-        double tmp = dp / (dist * dist);
+        }
+        Storage inverse = Storage(1) / std::sqrt(distanceSquared);
+        Storage dp = Storage(*q[i]) * inverse;
+        Storage tmp = dp * inverse * inverse;
 
         potential += dp;
-
-        E.x[0] += tmp * (pos.x[0]-r1.x[0]);
-        E.x[1] += tmp * (pos.x[1]-r1.x[1]);
-        E.x[2] += tmp * (pos.x[2]-r1.x[2]);
-    };
-
-    return FieldPotential(E, potential);
+        ex += tmp * dx;
+        ey += tmp * dy;
+        ez += tmp * dz;
+    }
+    result.potential += potential;
+    result.field.x[0] += ex;
+    result.field.x[1] += ey;
+    result.field.x[2] += ez;
 }
 
-void CoulombBruteForce::rebuildOptimization()
+template<typename Storage, typename Accumulator>
+void CoulombBruteForceT<Storage, Accumulator>::rebuildOptimization()
 {
-
+    buildNodesVector();
 }
 
-CoulombNodeBase* CoulombBruteForce::makeNode(double& charge, Node& thisNode)
+template<typename Storage, typename Accumulator>
+CoulombNodeBase* CoulombBruteForceT<Storage, Accumulator>::makeNode(double& charge, Node& thisNode)
 {
     return new CoulombNodeBruteForce(*this, charge, thisNode);
 }
 
-void CoulombBruteForce::getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distance)
+template<typename Storage, typename Accumulator>
+void CoulombBruteForceT<Storage, Accumulator>::getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distance)
 {
     for (auto it: m_nodesNotIsolatedVector)
     {
-        double d = (pos - it->node.pos).norm();
+        double d = sotm::distance(pos, it->node.pos);
         if (d <= distance)
         {
             container.push_back(it);
@@ -66,31 +130,75 @@ void CoulombBruteForce::getClose(std::vector<CoulombNodeBase*>& container, const
     };
 }
 
-void CoulombBruteForce::addCN(CoulombNodeBase& cn)
+template<typename Storage, typename Accumulator>
+std::unique_ptr<IColoumbCalculator> CoulombBruteForceT<Storage, Accumulator>::makeEmptyCopy() const
+{
+    return std::unique_ptr<IColoumbCalculator>(new CoulombBruteForceT<Storage, Accumulator>(m_graph));
+}
+
+template<typename Storage, typename Accumulator>
+void CoulombBruteForceT<Storage, Accumulator>::addCN(CoulombNodeBase& cn)
 {
     m_nodesNotIsolated.insert(static_cast<CoulombNodeBruteForce*>(&cn));
     m_nodesNotIsolatedVector.push_back(static_cast<CoulombNodeBruteForce*>(&cn));
+    m_arraysDirty = true;
 }
 
-void CoulombBruteForce::removeCN(CoulombNodeBase& cn)
+template<typename Storage, typename Accumulator>
+void CoulombBruteForceT<Storage, Accumulator>::removeCN(CoulombNodeBase& cn)
 {
     m_nodesNotIsolated.erase(static_cast<CoulombNodeBruteForce*>(&cn));
     m_vectorDirty = true;
 }
 
-void CoulombBruteForce::buildNodesVector()
+template<typename Storage, typename Accumulator>
+void CoulombBruteForceT<Storage, Accumulator>::buildNodesVector()
 {
-    if (!m_vectorDirty)
+    if (!m_vectorDirty && !m_arraysDirty)
         return;
 
-    m_nodesNotIsolatedVector.clear();
+    if (m_vectorDirty)
+    {
+        m_nodesNotIsolatedVector.clear();
 
-    for (auto it: m_nodesNotIsolated)
-        m_nodesNotIsolatedVector.push_back(it);
+        for (auto it: m_nodesNotIsolated)
+            m_nodesNotIsolatedVector.push_back(it);
+    }
+
+    size_t size = m_nodesNotIsolatedVector.size();
+
+    // Coordinates are stored relative to centre, so float storage keeps precision far from origin
+    m_origin = StaticVector<3>();
+    for (auto it: m_nodesNotIsolatedVector)
+        m_origin += it->node.pos;
+    if (size != 0)
+        m_origin /= double(size);
+    m_extent = 0.0;
+    for (auto it: m_nodesNotIsolatedVector)
+        for (int i = 0; i < 3; i++)
+            m_extent = std::max(m_extent, std::fabs(it->node.pos.x[i] - m_origin.x[i]));
+
+    m_x.resize(size);
+    m_y.resize(size);
+    m_z.resize(size);
+    m_charges.resize(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        CoulombNodeBruteForce* node = m_nodesNotIsolatedVector[i];
+        node->m_index = i;
+        m_x[i] = Storage(node->node.pos.x[0] - m_origin.x[0]);
+        m_y[i] = Storage(node->node.pos.x[1] - m_origin.x[1]);
+        m_z[i] = Storage(node->node.pos.x[2] - m_origin.x[2]);
+        m_charges[i] = &node->charge;
+    }
 
     m_vectorDirty = false;
+    m_arraysDirty = false;
 }
 
+template class sotm::CoulombBruteForceT<double, double>;
+template class sotm::CoulombBruteForceT<float, double>;
+
 ////////////////////////
 // CoulombNodeTrivial
 
@@ -0,0 +1,619 @@
+#include "sotm/optimizers/coulomb-distributed.hpp"
+#include "sotm/utils/const.hpp"
+#include "sotm/utils/assert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+
+using namespace sotm;
+
+namespace {
+
+enum class Command : int
+{
+    evaluate = 1,
+    stop = 2
+};
+
+/// Node record sent from rank 0 to domain owner: x, y, z, charge
+constexpr int nodeRecordSize = 4;
+/// Halo record: x, y, z, charge, global cell index
+constexpr int haloRecordSize = 5;
+/// Result record: Ex, Ey, Ez, potential
+constexpr int resultRecordSize = 4;
+/// Domain bounding box: min x, y, z, max x, y, z
+constexpr int boxSize = 6;
+
+/// Summary of cell sent to all ranks
+struct CellSummary
+{
+    double center[3];
+    double charge;
+    double dipole[3];
+    double radius;
+};
+constexpr int cellSummarySize = sizeof(CellSummary) / sizeof(double);
+static_assert(sizeof(CellSummary) == 8 * sizeof(double), "CellSummary should be plain array of doubles");
+
+struct Request
+{
+    double command;
+    double cellSize;
+    double theta;
+    double parallel;
+    double threadsCount;
+};
+constexpr int requestSize = sizeof(Request) / sizeof(double);
+
+double distanceToBox(const double* box, const double* point)
+{
+    double sum = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        double d = std::max(0.0, std::max(box[i] - point[i], point[i] - box[3+i]));
+        sum += d * d;
+    }
+    return std::sqrt(sum);
+}
+
+void addExact(const double* target, const double* source, FieldPotential& result)
+{
+    double d[3] = {target[0] - source[0], target[1] - source[1], target[2] - source[2]};
+    double dist = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    if (dist == 0.0)
+        return; // Node itself
+    double p = Const::Si::k * source[3] / dist;
+    double e = p / (dist * dist);
+    result.potential += p;
+    for (int i = 0; i < 3; i++)
+        result.field.x[i] += e * d[i];
+}
+
+void addMultipole(const double* target, const CellSummary& cell, FieldPotential& result)
+{
+    double d[3] = {target[0] - cell.center[0], target[1] - cell.center[1], target[2] - cell.center[2]};
+    double dist2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    if (dist2 == 0.0)
+        return; // Only possible for single node cell at target position
+    double dist = std::sqrt(dist2);
+    double inv3 = 1.0 / (dist2 * dist);
+    double pd = cell.dipole[0]*d[0] + cell.dipole[1]*d[1] + cell.dipole[2]*d[2];
+
+    result.potential += Const::Si::k * (cell.charge / dist + pd * inv3);
+    for (int i = 0; i < 3; i++)
+    {
+        result.field.x[i] += Const::Si::k * (
+            cell.charge * d[i] * inv3
+            + 3.0 * pd * d[i] * inv3 / dist2
+            - cell.dipole[i] * inv3
+        );
+    }
+}
+
+/**
+ * Hierarchy over cell summaries of all ranks. Every level merges cells of 2x2x2 blocks
+ * of previous level, block with one cell is passed to next level as is. Merged summary
+ * has center in mean of children centers, dipole moment is moved to it and radius
+ * covers children spheres. Target visits children of block only if block is in near field
+ */
+class CellTree
+{
+public:
+    CellTree(const std::vector<CellSummary>& cells, double cellSize)
+    {
+        std::vector<std::pair<std::array<long, 3>, size_t>> level;
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            std::array<long, 3> key;
+            for (int j = 0; j < 3; j++)
+                key[j] = static_cast<long>(std::floor(cells[c].center[j] / cellSize));
+            m_items.push_back(Item{cells[c], c, 0, 0});
+            level.push_back(std::make_pair(key, c));
+        }
+
+        // Keys converge to 0 and -1 after bits count of long halvings, remaining items go to root
+        for (size_t depth = 0; level.size() > 1 && depth < 8 * sizeof(long); depth++)
+        {
+            std::map<std::array<long, 3>, std::vector<size_t>> blocks;
+            for (auto &it : level)
+            {
+                std::array<long, 3> parent;
+                for (int j = 0; j < 3; j++)
+                    parent[j] = it.first[j] >= 0 ? it.first[j] / 2 : -((1 - it.first[j]) / 2);
+                blocks[parent].push_back(it.second);
+            }
+            level.clear();
+            for (auto &it : blocks)
+                level.push_back(std::make_pair(it.first, merge(it.second)));
+        }
+
+        if (level.size() == 1)
+        {
+            m_root = level.front().second;
+        } else {
+            std::vector<size_t> children;
+            for (auto &it : level)
+                children.push_back(it.second);
+            m_root = merge(children);
+        }
+    }
+
+    /**
+     * Call far(summary) for biggest blocks in far field of target and near(cell) for
+     * cells that are not in far field. Block is far if radius <= theta * distance
+     */
+    template<typename Near, typename Far>
+    void visit(const double* target, double theta, std::vector<size_t>& stack, Near near, Far far) const
+    {
+        if (m_items.empty())
+            return;
+        stack.clear();
+        stack.push_back(m_root);
+        while (!stack.empty())
+        {
+            const Item& item = m_items[stack.back()];
+            stack.pop_back();
+            const CellSummary& s = item.summary;
+            double d[3] = {target[0] - s.center[0], target[1] - s.center[1], target[2] - s.center[2]};
+            double dist = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+            if (s.radius <= theta * dist)
+            {
+                far(s);
+            } else if (item.childrenCount == 0) {
+                near(item.cell);
+            } else {
+                for (size_t i = 0; i < item.childrenCount; i++)
+                    stack.push_back(m_children[item.firstChild + i]);
+            }
+        }
+    }
+
+private:
+    struct Item
+    {
+        CellSummary summary;
+        /// Index of cell for leaf
+        size_t cell;
+        size_t firstChild;
+        size_t childrenCount;
+    };
+
+    size_t merge(const std::vector<size_t>& children)
+    {
+        if (children.size() == 1)
+            return children.front();
+
+        Item item = {};
+        item.firstChild = m_children.size();
+        item.childrenCount = children.size();
+        CellSummary& s = item.summary;
+        for (size_t c : children)
+            for (int j = 0; j < 3; j++)
+                s.center[j] += m_items[c].summary.center[j] / children.size();
+        for (size_t c : children)
+        {
+            const CellSummary& child = m_items[c].summary;
+            double d2 = 0.0;
+            s.charge += child.charge;
+            for (int j = 0; j < 3; j++)
+            {
+                double d = child.center[j] - s.center[j];
+                s.dipole[j] += child.dipole[j] + child.charge * d;
+                d2 += d * d;
+            }
+            s.radius = std::max(s.radius, std::sqrt(d2) + child.radius);
+            m_children.push_back(c);
+        }
+        m_items.push_back(item);
+        return m_items.size() - 1;
+    }
+
+    std::vector<Item> m_items;
+    std::vector<size_t> m_children;
+    size_t m_root = 0;
+};
+
+/**
+ * Collective part of evaluation for all ranks.
+ * @param records Node records of all ranks one after another. Used on rank 0 only
+ * @param counts Nodes count of every rank. Used on rank 0 only
+ * @param results Result records in the same order as records. Filled on rank 0 only
+ * @param parallel Settings of this rank, threads count is taken from request
+ * @return Count of halo nodes sent by all ranks, valid on rank 0
+ */
+size_t evaluateCollective(
+        MPI_Comm comm,
+        const Request& request,
+        const std::vector<double>& records,
+        const std::vector<int>& counts,
+        std::vector<double>& results,
+        size_t& totalCells,
+        ParallelSettings& parallel)
+{
+    int rank = 0, size = 1;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // Scatter domains
+    int localCount = 0;
+    MPI_Scatter(counts.data(), 1, MPI_INT, &localCount, 1, MPI_INT, 0, comm);
+
+    std::vector<int> recordCounts, recordOffsets;
+    if (rank == 0)
+    {
+        recordCounts.resize(size);
+        recordOffsets.resize(size);
+        for (int i = 0, offset = 0; i < size; i++)
+        {
+            recordCounts[i] = counts[i] * nodeRecordSize;
+            recordOffsets[i] = offset;
+            offset += recordCounts[i];
+        }
+    }
+    std::vector<double> local(localCount * nodeRecordSize);
+    MPI_Scatterv(records.data(), recordCounts.data(), recordOffsets.data(), MPI_DOUBLE,
+                 local.data(), localCount * nodeRecordSize, MPI_DOUBLE, 0, comm);
+
+    // Cells of own domain in deterministic order
+    std::map<std::array<long, 3>, std::vector<int>> cellsMap;
+    double box[boxSize] = {
+        std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()
+    };
+    for (int i = 0; i < localCount; i++)
+    {
+        const double* r = &local[i * nodeRecordSize];
+        std::array<long, 3> key;
+        for (int j = 0; j < 3; j++)
+        {
+            key[j] = static_cast<long>(std::floor(r[j] / request.cellSize));
+            box[j] = std::min(box[j], r[j]);
+            box[3+j] = std::max(box[3+j], r[j]);
+        }
+        cellsMap[key].push_back(i);
+    }
+
+    std::vector<std::vector<int>> ownCells;
+    std::vector<CellSummary> ownSummaries;
+    for (auto &it : cellsMap)
+    {
+        const std::vector<int>& members = it.second;
+        CellSummary s = {};
+        for (int m : members)
+            for (int j = 0; j < 3; j++)
+                s.center[j] += local[m * nodeRecordSize + j] / members.size();
+        for (int m : members)
+        {
+            const double* r = &local[m * nodeRecordSize];
+            double d2 = 0.0;
+            s.charge += r[3];
+            for (int j = 0; j < 3; j++)
+            {
+                double d = r[j] - s.center[j];
+                s.dipole[j] += r[3] * d;
+                d2 += d * d;
+            }
+            s.radius = std::max(s.radius, std::sqrt(d2));
+        }
+        ownCells.push_back(members);
+        ownSummaries.push_back(s);
+    }
+
+    // Share cell summaries and domain boxes
+    int ownCellsCount = ownCells.size();
+    std::vector<int> cellsCounts(size), cellsOffsets(size);
+    MPI_Allgather(&ownCellsCount, 1, MPI_INT, cellsCounts.data(), 1, MPI_INT, comm);
+    std::vector<int> summaryCounts(size), summaryOffsets(size);
+    totalCells = 0;
+    for (int i = 0; i < size; i++)
+    {
+        cellsOffsets[i] = totalCells;
+        summaryCounts[i] = cellsCounts[i] * cellSummarySize;
+        summaryOffsets[i] = totalCells * cellSummarySize;
+        totalCells += cellsCounts[i];
+    }
+    std::vector<CellSummary> summaries(totalCells);
+    MPI_Allgatherv(ownSummaries.data(), ownCellsCount * cellSummarySize, MPI_DOUBLE,
+                   summaries.data(), summaryCounts.data(), summaryOffsets.data(), MPI_DOUBLE, comm);
+
+    std::vector<double> boxes(size * boxSize);
+    MPI_Allgather(box, boxSize, MPI_DOUBLE, boxes.data(), boxSize, MPI_DOUBLE, comm);
+
+    // Halo exchange: cell is sent to rank if it is in near field of any point of rank's domain
+    std::vector<std::vector<double>> haloToRank(size);
+    for (size_t c = 0; c < ownCells.size(); c++)
+    {
+        const CellSummary& s = ownSummaries[c];
+        for (int r = 0; r < size; r++)
+        {
+            if (r == rank || s.radius <= request.theta * distanceToBox(&boxes[r * boxSize], s.center))
+                continue;
+            for (int m : ownCells[c])
+            {
+                const double* record = &local[m * nodeRecordSize];
+                haloToRank[r].insert(haloToRank[r].end(), record, record + nodeRecordSize);
+                haloToRank[r].push_back(cellsOffsets[rank] + c);
+            }
+        }
+    }
+
+    std::vector<int> sendCounts(size), sendOffsets(size), recvCounts(size), recvOffsets(size);
+    std::vector<double> haloSend;
+    for (int r = 0; r < size; r++)
+    {
+        sendOffsets[r] = haloSend.size();
+        sendCounts[r] = haloToRank[r].size();
+        haloSend.insert(haloSend.end(), haloToRank[r].begin(), haloToRank[r].end());
+    }
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, comm);
+    int haloReceived = 0;
+    for (int r = 0; r < size; r++)
+    {
+        recvOffsets[r] = haloReceived;
+        haloReceived += recvCounts[r];
+    }
+    std::vector<double> haloRecv(haloReceived);
+    MPI_Alltoallv(haloSend.data(), sendCounts.data(), sendOffsets.data(), MPI_DOUBLE,
+                  haloRecv.data(), recvCounts.data(), recvOffsets.data(), MPI_DOUBLE, comm);
+
+    // Sources of near cells: own cells and halo
+    std::vector<std::vector<double>> cellSources(totalCells);
+    for (size_t c = 0; c < ownCells.size(); c++)
+    {
+        std::vector<double>& sources = cellSources[cellsOffsets[rank] + c];
+        for (int m : ownCells[c])
+            sources.insert(sources.end(), &local[m * nodeRecordSize], &local[m * nodeRecordSize] + nodeRecordSize);
+    }
+    for (int i = 0; i < haloReceived; i += haloRecordSize)
+    {
+        size_t cell = static_cast<size_t>(haloRecv[i + 4]);
+        cellSources[cell].insert(cellSources[cell].end(), &haloRecv[i], &haloRecv[i] + nodeRecordSize);
+    }
+
+    // Field at own nodes
+    CellTree tree(summaries, request.cellSize);
+    std::vector<double> localResults(localCount * resultRecordSize);
+    auto evaluate = [&](size_t i)
+    {
+        const double* target = &local[i * nodeRecordSize];
+        FieldPotential fp;
+        std::vector<size_t> stack;
+        tree.visit(target, request.theta, stack,
+            [&](size_t c)
+            {
+                const std::vector<double>& sources = cellSources[c];
+                // Sources may be absent only by rounding on halo bound, multipole is good enough there
+                if (sources.empty())
+                {
+                    addMultipole(target, summaries[c], fp);
+                    return;
+                }
+                for (size_t j = 0; j < sources.size(); j += nodeRecordSize)
+                    addExact(target, &sources[j], fp);
+            },
+            [&](const CellSummary& s)
+            {
+                addMultipole(target, s, fp);
+            }
+        );
+        double* result = &localResults[i * resultRecordSize];
+        result[0] = fp.field.x[0];
+        result[1] = fp.field.x[1];
+        result[2] = fp.field.x[2];
+        result[3] = fp.potential;
+    };
+
+    if (request.parallel != 0.0)
+    {
+        size_t threadsCount = static_cast<size_t>(request.threadsCount);
+        if (parallel.threadsCount != threadsCount)
+        {
+            parallel.threadsCount = threadsCount;
+            parallel.reconfigure();
+        }
+        parallel.parallelFor(ParallelSettings::Phase::calculateSecondaryValues, 0, localCount, evaluate);
+    } else {
+        for (int i = 0; i < localCount; i++)
+            evaluate(i);
+    }
+
+    // Gather results
+    std::vector<int> resultCounts, resultOffsets;
+    if (rank == 0)
+    {
+        resultCounts.resize(size);
+        resultOffsets.resize(size);
+        for (int i = 0, offset = 0; i < size; i++)
+        {
+            resultCounts[i] = counts[i] * resultRecordSize;
+            resultOffsets[i] = offset;
+            offset += resultCounts[i];
+        }
+        results.resize(records.size() / nodeRecordSize * resultRecordSize);
+    }
+    MPI_Gatherv(localResults.data(), localCount * resultRecordSize, MPI_DOUBLE,
+                results.data(), resultCounts.data(), resultOffsets.data(), MPI_DOUBLE, 0, comm);
+
+    unsigned long haloSent = haloSend.size() / haloRecordSize, haloTotal = 0;
+    MPI_Reduce(&haloSent, &haloTotal, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0, comm);
+    return haloTotal;
+}
+
+}
+
+///////////////////////////
+// CoulombDistributed
+
+CoulombDistributed::CoulombDistributed(GraphRegister& graph, MPI_Comm comm, const DistributedCoulombParameters& parameters) :
+    m_graph(graph),
+    m_comm(comm),
+    m_parameters(parameters)
+{
+    ASSERT(m_parameters.cellSize > 0.0, "Cell size should be positive");
+    ASSERT(m_parameters.theta > 0.0, "Theta should be positive");
+}
+
+FieldPotential CoulombDistributed::getFP(StaticVector<3> pos, CoulombNodeBase* exclude)
+{
+    // Arbitrary point: exact sum on rank 0, all charges are here
+    FieldPotential result;
+    for (auto it : m_nodes)
+    {
+        if (static_cast<CoulombNodeBase*>(it) == exclude)
+            continue;
+        double source[4] = {it->node.pos.x[0], it->node.pos.x[1], it->node.pos.x[2], it->charge};
+        addExact(pos.x, source, result);
+    }
+    return result;
+}
+
+CoulombNodeBase* CoulombDistributed::makeNode(double& charge, Node& thisNode)
+{
+    return new CoulombNodeDistributed(*this, charge, thisNode);
+}
+
+std::unique_ptr<IColoumbCalculator> CoulombDistributed::makeEmptyCopy() const
+{
+    return std::unique_ptr<IColoumbCalculator>(new CoulombDistributed(m_graph, m_comm, m_parameters));
+}
+
+void CoulombDistributed::getClose(std::vector<CoulombNodeBase*>& container, const StaticVector<3>& pos, double distance)
+{
+    for (auto it : m_nodes)
+    {
+        if (sotm::distance(pos, it->node.pos) <= distance)
+            container.push_back(it);
+    }
+}
+
+void CoulombDistributed::rebuildOptimization()
+{
+    int size = 1;
+    MPI_Comm_size(m_comm, &size);
+
+    std::vector<CoulombNodeDistributed*> nodes(m_nodes.begin(), m_nodes.end());
+
+    // Slabs along the longest extent. Ties are broken by position to be independent of pointers order
+    double minPos[3] = {0.0, 0.0, 0.0}, maxPos[3] = {0.0, 0.0, 0.0};
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            double x = nodes[i]->node.pos.x[j];
+            minPos[j] = i == 0 ? x : std::min(minPos[j], x);
+            maxPos[j] = i == 0 ? x : std::max(maxPos[j], x);
+        }
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; j++)
+        if (maxPos[j] - minPos[j] > maxPos[axis] - minPos[axis])
+            axis = j;
+
+    std::sort(nodes.begin(), nodes.end(),
+        [axis](const CoulombNodeDistributed* a, const CoulombNodeDistributed* b)
+        {
+            const double* pa = a->node.pos.x;
+            const double* pb = b->node.pos.x;
+            if (pa[axis] != pb[axis])
+                return pa[axis] < pb[axis];
+            return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+        }
+    );
+
+    std::vector<int> counts(size);
+    for (int r = 0; r < size; r++)
+        counts[r] = nodes.size() * (r + 1) / size - nodes.size() * r / size;
+
+    std::vector<double> records(nodes.size() * nodeRecordSize);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        double* record = &records[i * nodeRecordSize];
+        record[0] = nodes[i]->node.pos.x[0];
+        record[1] = nodes[i]->node.pos.x[1];
+        record[2] = nodes[i]->node.pos.x[2];
+        record[3] = nodes[i]->charge;
+    }
+
+    Request request;
+    request.command = static_cast<double>(Command::evaluate);
+    request.cellSize = m_parameters.cellSize;
+    request.theta = m_parameters.theta;
+    request.parallel = m_parameters.parallel ? 1.0 : 0.0;
+    request.threadsCount = static_cast<double>(m_parameters.threadsCount);
+    MPI_Bcast(&request, requestSize, MPI_DOUBLE, 0, m_comm);
+
+    std::vector<double> results;
+    size_t cells = 0;
+    size_t halo = evaluateCollective(m_comm, request, records, counts, results, cells, m_parallelSettings);
+
+    m_evaluation++;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const double* result = &results[i * resultRecordSize];
+        nodes[i]->m_result = FieldPotential(result[0], result[1], result[2], result[3]);
+        nodes[i]->m_evaluation = m_evaluation;
+    }
+
+    m_stats.evaluations++;
+    m_stats.cells = cells;
+    m_stats.haloNodes = halo;
+}
+
+void CoulombDistributed::runWorker(MPI_Comm comm)
+{
+    std::vector<double> records, results;
+    std::vector<int> counts;
+    ParallelSettings parallel;
+    for (;;)
+    {
+        Request request;
+        MPI_Bcast(&request, requestSize, MPI_DOUBLE, 0, comm);
+        if (static_cast<Command>(static_cast<int>(request.command)) == Command::stop)
+            break;
+        size_t cells = 0;
+        evaluateCollective(comm, request, records, counts, results, cells, parallel);
+    }
+}
+
+void CoulombDistributed::stopWorkers(MPI_Comm comm)
+{
+    Request request = {};
+    request.command = static_cast<double>(Command::stop);
+    MPI_Bcast(&request, requestSize, MPI_DOUBLE, 0, comm);
+}
+
+void CoulombDistributed::addCN(CoulombNodeBase& cn)
+{
+    m_nodes.insert(static_cast<CoulombNodeDistributed*>(&cn));
+}
+
+void CoulombDistributed::removeCN(CoulombNodeBase& cn)
+{
+    m_nodes.erase(static_cast<CoulombNodeDistributed*>(&cn));
+}
+
+///////////////////////////
+// CoulombNodeDistributed
+
+CoulombNodeDistributed::CoulombNodeDistributed(CoulombDistributed& co, double& charge, Node& thisNode) :
+    CoulombNodeBase(charge, thisNode),
+    m_co(co)
+{
+    m_co.addCN(*this);
+}
+
+CoulombNodeDistributed::~CoulombNodeDistributed()
+{
+    m_co.removeCN(*this);
+}
+
+FieldPotential CoulombNodeDistributed::getFP()
+{
+    if (m_evaluation != 0 && m_evaluation == m_co.m_evaluation)
+        return m_result;
+    // Node is created after last rebuild
+    return m_co.getFP(node.pos, this);
+}
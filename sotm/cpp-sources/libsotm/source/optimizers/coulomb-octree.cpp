@@ -1,9 +1,10 @@
 #include "sotm/optimizers/coulomb-octree.hpp"
 #include "sotm/utils/const.hpp"
+#include "sotm/utils/log.hpp"
 
-#include <iostream>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
 
 using namespace sotm;
 
@@ -11,10 +12,35 @@ using namespace sotm;
 // CoulombOctree
 
 CoulombOctree::CoulombOctree(GraphRegister& graph, std::unique_ptr<const octree::IScalesConfig> scales) :
-    m_graph(graph),
-    m_scales(std::move(scales))
+    m_graph(graph)
 {
+    setScales(std::move(scales));
+}
+
+CoulombOctree::CoulombOctree(GraphRegister& graph, std::shared_ptr<const octree::IScalesConfig> scales) :
+    m_graph(graph)
+{
+    setScales(scales);
+}
 
+CoulombOctree::CoulombOctree(GraphRegister& graph, const OctreeAutoTuning& tuning) :
+    m_graph(graph),
+    m_autoTuning(true),
+    m_tuning(tuning)
+{
+    if (m_tuning.linearCandidates.empty() && m_tuning.discreteCandidates.empty())
+        throw std::runtime_error("Octree auto tuning needs at least one scales candidate");
+    for (auto &it : m_tuning.discreteCandidates)
+    {
+        if (!it)
+            throw std::runtime_error("Octree auto tuning discrete scales candidate is null");
+    }
+    std::sort(m_tuning.linearCandidates.begin(), m_tuning.linearCandidates.end());
+    // The most precise linear scales are used until the first tuning
+    if (!m_tuning.linearCandidates.empty())
+        setScales(std::make_shared<octree::LinearScales>(m_tuning.linearCandidates.front()));
+    else
+        setScales(m_tuning.discreteCandidates.front());
 }
 
 FieldPotential CoulombOctree::getFP(StaticVector<3> pos, CoulombNodeBase* exclude)
@@ -29,10 +55,10 @@ FieldPotential CoulombOctree::getFP(StaticVector<3> pos, CoulombNodeBase* exclud
 
     FieldPotential octreeResult;
 
-    octreeResult  = m_convolution.convolute(m_octreePositive, pos.x, FieldPotential::convolutionVisitor);
-    octreeResult += m_convolution.convolute(m_octreeNegative, pos.x, FieldPotential::convolutionVisitor);
+    octreeResult  = m_convolution->convolute(m_octreePositive, pos.x, FieldPotential::convolutionVisitor);
+    octreeResult += m_convolution->convolute(m_octreeNegative, pos.x, FieldPotential::convolutionVisitor);
 
-    return octreeResult;
+    return FieldPotential(octreeResult);
 }
 
 CoulombNodeBase* CoulombOctree::makeNode(double& charge, Node& thisNode)
@@ -52,21 +78,51 @@ void CoulombOctree::getClose(std::vector<CoulombNodeBase*>& container, const Sta
     }
 }
 
+std::unique_ptr<IColoumbCalculator> CoulombOctree::makeEmptyCopy() const
+{
+    return std::unique_ptr<IColoumbCalculator>(new CoulombOctree(m_graph, m_scales));
+}
+
 void CoulombOctree::rebuildOptimization()
 {
     m_octreeNegative.clear();
     m_octreePositive.clear();
 
-    octree::CenterMassUpdatingMute cmumn(m_octreeNegative);
-    octree::CenterMassUpdatingMute cmump(m_octreePositive);
-
-    for (auto &it: m_nodesNotIsolated)
     {
-        if (it->charge >= 0)
-            m_octreePositive.add(it->m_ectreeElement);
-        else
-            m_octreeNegative.add(it->m_ectreeElement);
+        octree::CenterMassUpdatingMute cmumn(m_octreeNegative);
+        octree::CenterMassUpdatingMute cmump(m_octreePositive);
+
+        for (auto &it: m_nodesNotIsolated)
+        {
+            if (it->charge >= 0)
+                m_octreePositive.add(it->m_ectreeElement);
+            else
+                m_octreeNegative.add(it->m_ectreeElement);
+        }
     }
+
+    if (needTuning())
+        tune();
+}
+
+bool CoulombOctree::isAutoTuned() const
+{
+    return m_autoTuning;
+}
+
+double CoulombOctree::tunedLinearScale() const
+{
+    return m_tunedLinearScale;
+}
+
+long CoulombOctree::tunedDiscreteCandidate() const
+{
+    return m_tunedDiscreteCandidate;
+}
+
+size_t CoulombOctree::tunedNodesCount() const
+{
+    return m_tunedNodesCount;
 }
 
 void CoulombOctree::addCN(CoulombNodeBase& cn)
@@ -79,6 +135,135 @@ void CoulombOctree::removeCN(CoulombNodeBase& cn)
     m_nodesNotIsolated.erase(static_cast<CoulombNodeOctree*>(&cn));
 }
 
+void CoulombOctree::setScales(std::shared_ptr<const octree::IScalesConfig> scales)
+{
+    // Convolution keeps reference to scales, so it should be recreated first
+    m_convolution.reset();
+    m_scales = scales;
+    m_convolution.reset(new octree::Convolution<FieldPotential>(*m_scales));
+}
+
+bool CoulombOctree::needTuning() const
+{
+    if (!m_autoTuning || m_nodesNotIsolated.empty())
+        return false;
+    if (m_tunedNodesCount == 0)
+        return true;
+    return m_nodesNotIsolated.size() >= m_tunedNodesCount * m_tuning.retuneGrowth;
+}
+
+void CoulombOctree::tune()
+{
+    // Nodes are sorted by position to select the same targets on every run
+    std::vector<CoulombNodeOctree*> nodes(m_nodesNotIsolated.begin(), m_nodesNotIsolated.end());
+    std::sort(nodes.begin(), nodes.end(),
+        [](const CoulombNodeOctree* a, const CoulombNodeOctree* b)
+        {
+            return std::lexicographical_compare(a->node.pos.x, a->node.pos.x + 3, b->node.pos.x, b->node.pos.x + 3);
+        }
+    );
+
+    size_t samples = std::max<size_t>(1, std::min(m_tuning.samples, nodes.size()));
+    size_t stride = nodes.size() / samples;
+
+    std::vector<StaticVector<3>> targets;
+    std::vector<FieldPotential> exact;
+    targets.reserve(samples);
+    exact.reserve(samples);
+    for (size_t i = 0; i < samples; i++)
+    {
+        const StaticVector<3>& target = nodes[i * stride]->node.pos;
+        FieldPotential sum;
+        for (auto it : nodes)
+            sum += coulombContribution<double, double>(target.x, it->node.pos.x, it->charge);
+        targets.push_back(target);
+        exact.push_back(sum);
+    }
+
+    std::vector<TuningResult> candidates;
+    for (double linearScale : m_tuning.linearCandidates)
+    {
+        TuningResult r;
+        r.scales = std::make_shared<octree::LinearScales>(linearScale);
+        r.linearScale = linearScale;
+        candidates.push_back(r);
+    }
+    for (size_t i = 0; i < m_tuning.discreteCandidates.size(); i++)
+    {
+        TuningResult r;
+        r.scales = m_tuning.discreteCandidates[i];
+        r.discreteCandidate = long(i);
+        candidates.push_back(r);
+    }
+
+    TuningResult best;
+    TuningResult mostPrecise;
+    bool found = false;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        TuningResult& r = candidates[i];
+        evaluateCandidate(r, targets, exact);
+        if (i == 0 || std::max(r.fieldError, r.potentialError) < std::max(mostPrecise.fieldError, mostPrecise.potentialError))
+            mostPrecise = r;
+
+        if (r.fieldError > m_tuning.maxRelativeError || r.potentialError > m_tuning.maxRelativeError)
+            continue;
+
+        if (!found || r.visits <= best.visits)
+            best = r;
+        found = true;
+    }
+
+    if (!found)
+    {
+        SOTM_LOG(warning) << "Octree scales auto tuning cannot reach relative error " << m_tuning.maxRelativeError
+                          << ", the most precise candidate is used";
+        best = mostPrecise;
+    }
+
+    setScales(best.scales);
+    m_tunedLinearScale = best.linearScale;
+    m_tunedDiscreteCandidate = best.discreteCandidate;
+    m_tunedNodesCount = nodes.size();
+
+    SOTM_LOG(info) << "Octree scales auto tuned for " << nodes.size() << " nodes: "
+                   << (best.discreteCandidate < 0 ? "linear " : "discrete candidate ")
+                   << (best.discreteCandidate < 0 ? best.linearScale : double(best.discreteCandidate))
+                   << ", field error " << best.fieldError << ", potential error " << best.potentialError
+                   << ", " << double(best.visits) / targets.size() << " visits per evaluation";
+}
+
+void CoulombOctree::evaluateCandidate(TuningResult& candidate, const std::vector<StaticVector<3>>& targets, const std::vector<FieldPotential>& exact)
+{
+    octree::Convolution<FieldPotential> convolution(*candidate.scales);
+
+    size_t visits = 0;
+    auto countingVisitor = [&visits](const Position& target, const Position& object, double mass)
+    {
+        visits++;
+        return FieldPotential::convolutionVisitor(target, object, mass);
+    };
+
+    double fieldSqrSum = 0.0, potentialSqrSum = 0.0;
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        FieldPotential sum = convolution.convolute(m_octreePositive, targets[i].x, countingVisitor);
+        sum += convolution.convolute(m_octreeNegative, targets[i].x, countingVisitor);
+        FieldPotential fp(sum);
+
+        double fieldScale = std::max(fp.field.norm(), exact[i].field.norm());
+        double potentialScale = std::max(fabs(fp.potential), fabs(exact[i].potential));
+        double fieldError = fieldScale == 0.0 ? 0.0 : (fp.field - exact[i].field).norm() / fieldScale;
+        double potentialError = potentialScale == 0.0 ? 0.0 : fabs(fp.potential - exact[i].potential) / potentialScale;
+        fieldSqrSum += fieldError * fieldError;
+        potentialSqrSum += potentialError * potentialError;
+    }
+
+    candidate.fieldError = sqrt(fieldSqrSum / targets.size());
+    candidate.potentialError = sqrt(potentialSqrSum / targets.size());
+    candidate.visits = visits;
+}
+
 ////////////////////////
 // CoulombNodeOctree
 
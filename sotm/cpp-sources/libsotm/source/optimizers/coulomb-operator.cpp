@@ -0,0 +1,53 @@
+#include "sotm/optimizers/coulomb-operator.hpp"
+#include "sotm/utils/const.hpp"
+#include "sotm/utils/assert.hpp"
+
+#include <algorithm>
+
+using namespace sotm;
+
+CoulombPotentialOperator::CoulombPotentialOperator(
+        const IColoumbCalculator& calculator,
+        const std::vector<Node*>& nodes,
+        const std::vector<double>& selfElastance,
+        const ParallelSettings& parallel,
+        ParallelSettings::Phase phase) :
+    m_calculator(calculator.makeEmptyCopy()),
+    m_charges(nodes.size(), 0.0),
+    m_selfElastance(selfElastance),
+    m_parallel(parallel),
+    m_phase(phase)
+{
+    ASSERT(nodes.size() == m_selfElastance.size(), "Nodes and self elastance vectors should have the same size");
+
+    m_nodes.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+        m_nodes.emplace_back(m_calculator->makeNode(m_charges[i], *nodes[i]));
+    m_calculator->rebuildOptimization();
+}
+
+void CoulombPotentialOperator::operator()(const std::vector<double>& charges, std::vector<double>& potentials) const
+{
+    size_t n = m_nodes.size();
+    ASSERT(charges.size() == n, "Charges vector size should be equal to operator size");
+    m_applications++;
+
+    std::copy(charges.begin(), charges.end(), m_charges.begin());
+    m_calculator->rebuildOptimization();
+
+    potentials.resize(n);
+    m_parallel.forEach(m_phase, n, [this, &charges, &potentials](size_t i)
+    {
+        potentials[i] = m_nodes[i]->getFP().potential + m_selfElastance[i] * charges[i];
+    });
+}
+
+double CoulombPotentialOperator::entry(size_t i, size_t j) const
+{
+    if (i == j)
+        return m_selfElastance[i];
+    double dist = distance(m_nodes[i]->node.pos, m_nodes[j]->node.pos);
+    if (dist == 0.0)
+        return 0.0;
+    return Const::Si::k / dist;
+}
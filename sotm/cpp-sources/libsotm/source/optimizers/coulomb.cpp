@@ -7,61 +7,69 @@
 
 using namespace sotm;
 
-//////////////////////
-// FieldPotential
-FieldPotential::FieldPotential(double Ex, double Ey, double Ez, double potential) :
-    field(Ex, Ey, Ez),
-    potential(potential)
-{
-
-}
-
-FieldPotential::FieldPotential(const StaticVector<3>& E, double p) :
-    field(E),
-    potential(p)
+////////////////////////
+// CoulombComparisonStats
+size_t CoulombComparisonStats::histogramBin(double relativeError)
 {
-
+    if (relativeError >= 1.0)
+        return 0;
+    for (size_t bin = 1; bin < histogramBins - 1; bin++)
+    {
+        if (relativeError >= std::pow(10.0, -double(bin)))
+            return bin;
+    }
+    return histogramBins - 1;
 }
 
-FieldPotential& FieldPotential::operator+=(const FieldPotential& right)
+std::string CoulombComparisonStats::histogramBinName(size_t bin)
 {
-    field += right.field;
-    potential += right.potential;
-    return *this;
+    if (bin == 0)
+        return ">=1";
+    if (bin >= histogramBins - 1)
+        return "<1e-" + std::to_string(histogramBins - 2);
+    return "1e-" + std::to_string(bin);
 }
 
-FieldPotential FieldPotential::convolutionVisitor(const Position& target, const Position& object, double mass)
+void CoulombComparisonStats::report(std::ostream& os) const
 {
-    double dist = target.distTo(object);
-    if (dist == 0.0)
-        return FieldPotential();
-    double p = Const::Si::k * mass / dist;
-    double tmp = p / (dist * dist);
-
-    FieldPotential fp;
-    const double *p1 = target.x;
-    const double *p2 = object.x;
-    double *pres = fp.field.x;
-    fp.potential = p;
-    for (int i=0; i<3; i++)
-        pres[i] = tmp * (p1[i]-p2[i]);
+    os << "[Compare] " << compared << " of " << evaluations << " evaluations compared";
+    if (nanResults != 0)
+        os << ", " << nanResults << " results with nan";
+    os << std::endl;
+    if (compared == 0)
+        return;
 
-    return fp;
+    os << "[Compare] field:     max = " << fieldMaxError << ", rms = " << fieldRmsError << std::endl;
+    os << "[Compare] potential: max = " << potentialMaxError << ", rms = " << potentialRmsError << std::endl;
+    os << "[Compare] relative error histogram (bin: field / potential):" << std::endl;
+    for (size_t i = 0; i < histogramBins; i++)
+    {
+        if (fieldHistogram[i] == 0 && potentialHistogram[i] == 0)
+            continue;
+        os << "[Compare]   " << histogramBinName(i) << ": " << fieldHistogram[i] << " / " << potentialHistogram[i] << std::endl;
+    }
 }
 
-////////////////////////
+//////////////////////
 // CoulombComarator
-CoulombComarator::CoulombComarator(std::unique_ptr<IColoumbCalculator> c1, std::unique_ptr<IColoumbCalculator> c2) :
-    m_c1(std::move(c1)), m_c2(std::move(c2))
+CoulombComarator::CoulombComarator(std::unique_ptr<IColoumbCalculator> c1, std::unique_ptr<IColoumbCalculator> c2, double compareFraction) :
+    m_c1(std::move(c1)), m_c2(std::move(c2)),
+    m_compareFraction(std::min(std::max(compareFraction, 0.0), 1.0))
 {
-
+    resetStats();
 }
 
 FieldPotential CoulombComarator::getFP(StaticVector<3> pos, CoulombNodeBase* exclude)
 {
-    FieldPotential r1 = m_c1->getFP(pos, static_cast<CoulombComaratorNode*>(exclude)->m_n1.get());
-    FieldPotential r2 = m_c2->getFP(pos, static_cast<CoulombComaratorNode*>(exclude)->m_n2.get());
-    std::cout << diffStr(r1, r2) << std::endl;
+    auto comparatorNode = static_cast<CoulombComaratorNode*>(exclude);
+    size_t index = m_evaluations.fetch_add(1, std::memory_order_relaxed);
+
+    FieldPotential r1 = m_c1->getFP(pos, comparatorNode ? comparatorNode->m_n1.get() : nullptr);
+    if (!needCompare(index))
+        return r1;
+
+    FieldPotential r2 = m_c2->getFP(pos, comparatorNode ? comparatorNode->m_n2.get() : nullptr);
+    accumulate(r1, r2);
     return r1;
 }
 
@@ -97,43 +105,109 @@ CoulombNodeBase* CoulombComarator::makeNode(double& charge, Node& thisNode)
     );
 }
 
-std::string CoulombComarator::diffStr(const FieldPotential& r1, const FieldPotential& r2)
+std::unique_ptr<IColoumbCalculator> CoulombComarator::makeEmptyCopy() const
 {
-    std::ostringstream oss;
-    m_counter++;
+    return std::unique_ptr<IColoumbCalculator>(
+        new CoulombComarator(m_c1->makeEmptyCopy(), m_c2->makeEmptyCopy(), m_compareFraction)
+    );
+}
 
-    if (std::isnan(r2.potential))
-        oss << header() << "[ERROR] r2.potential == nan" << std::endl;
+CoulombComparisonStats CoulombComarator::stats() const
+{
+    CoulombComparisonStats result;
+    result.evaluations = m_evaluations.load();
+    result.compared = m_compared.load();
+    result.nanResults = m_nanResults.load();
+    result.fieldMaxError = m_fieldMaxError.load();
+    result.potentialMaxError = m_potentialMaxError.load();
 
-    for (int i=0; i<3; i++)
-        if (std::isnan(r2.field[i]))
-            oss << header() << "[ERROR] r2.field[" << i << "]== nan" << std::endl;
+    // Results with nan are not accumulated to errors
+    size_t accumulated = result.compared - std::min(result.compared, result.nanResults);
+    if (accumulated != 0)
+    {
+        result.fieldRmsError = sqrt(m_fieldSqrErrorSum.load() / accumulated);
+        result.potentialRmsError = sqrt(m_potentialSqrErrorSum.load() / accumulated);
+    }
 
-    oss << header() << " eps(potential) = " << err(r1.potential, r2.potential) << std::endl;
+    for (size_t i = 0; i < CoulombComparisonStats::histogramBins; i++)
+    {
+        result.fieldHistogram[i] = m_fieldHistogram[i].load();
+        result.potentialHistogram[i] = m_potentialHistogram[i].load();
+    }
+    return result;
+}
 
+void CoulombComarator::resetStats()
+{
+    m_evaluations = 0;
+    m_compared = 0;
+    m_nanResults = 0;
+    m_fieldMaxError = 0.0;
+    m_fieldSqrErrorSum = 0.0;
+    m_potentialMaxError = 0.0;
+    m_potentialSqrErrorSum = 0.0;
+    for (size_t i = 0; i < CoulombComparisonStats::histogramBins; i++)
+    {
+        m_fieldHistogram[i] = 0;
+        m_potentialHistogram[i] = 0;
+    }
+}
+
+bool CoulombComarator::needCompare(size_t evaluationIndex) const
+{
+    // Evaluation is compared if integer part of accumulated fraction changes on it,
+    // so exactly floor(n * fraction) evaluations of n are compared
+    double before = std::floor(evaluationIndex * m_compareFraction);
+    double after = std::floor((evaluationIndex + 1) * m_compareFraction);
+    return after > before;
+}
+
+void CoulombComarator::accumulate(const FieldPotential& r1, const FieldPotential& r2)
+{
+    m_compared.fetch_add(1, std::memory_order_relaxed);
+
+    bool hasNan = std::isnan(r1.potential) || std::isnan(r2.potential);
     for (int i=0; i<3; i++)
+        hasNan = hasNan || std::isnan(r1.field[i]) || std::isnan(r2.field[i]);
+
+    if (hasNan)
     {
-        oss << header() << " eps(E[" << i << "]) = " << err(r1.field[i], r2.field[i]) << std::endl;
+        m_nanResults.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
 
-    oss << header() << " max error = " << m_maxDiff;
-    return oss.str();
+    double fieldError = relativeError(r1.field.norm(), (r1.field - r2.field).norm(), r2.field.norm());
+    double potentialError = relativeError(fabs(r1.potential), fabs(r1.potential - r2.potential), fabs(r2.potential));
+
+    atomicMax(m_fieldMaxError, fieldError);
+    atomicMax(m_potentialMaxError, potentialError);
+    atomicAdd(m_fieldSqrErrorSum, fieldError * fieldError);
+    atomicAdd(m_potentialSqrErrorSum, potentialError * potentialError);
+
+    m_fieldHistogram[CoulombComparisonStats::histogramBin(fieldError)].fetch_add(1, std::memory_order_relaxed);
+    m_potentialHistogram[CoulombComparisonStats::histogramBin(potentialError)].fetch_add(1, std::memory_order_relaxed);
+}
+
+double CoulombComarator::relativeError(double norm1, double diffNorm, double norm2)
+{
+    double scale = std::max(norm1, norm2);
+    if (scale == 0.0)
+        return 0.0;
+    return diffNorm / scale;
 }
 
-double CoulombComarator::err(double v1, double v2)
+void CoulombComarator::atomicMax(std::atomic<double>& target, double value)
 {
-    double err = 0.0;
-    v1 = fabs(v1); v2 = fabs(v2);
-    if (v1 != 0.0 || v2 != 0.0)
-        err = fabs(v1-v2) / std::max(v1, v2);
-    if (err > m_maxDiff)
-        m_maxDiff = err;
-    return err;
+    double current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    { }
 }
 
-std::string CoulombComarator::header()
+void CoulombComarator::atomicAdd(std::atomic<double>& target, double value)
 {
-    return std::string("[Compare ") + std::to_string(m_counter) + "] ";
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+    { }
 }
 
 ////////////////////////
@@ -1,4 +1,5 @@
 #include "sotm/output/graph-file-writer.hpp"
+#include "sotm/utils/log.hpp"
 
 #include <vtkCellData.h>
 #include <vtkXMLPolyDataWriter.h>
@@ -39,7 +40,7 @@ void FileWriter::writeNodes(const std::string& filename)
 	std::ofstream output(filename.c_str(), std::ios::out);
 	if (!output.is_open())
 	{
-		std::cerr << "Cannot open file " << filename << std::endl;
+		SOTM_LOG(error) << "Cannot open file " << filename;
 		return;
 	}
 
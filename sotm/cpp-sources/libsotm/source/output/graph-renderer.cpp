@@ -6,64 +6,109 @@
  */
 
 #include <sotm/output/graph-renderer.hpp>
+#include <vtkCamera.h>
 #include <vtkCellData.h>
+#include <vtkPointData.h>
 #include <vtkProperty.h>
 #include <vtkVectorText.h>
+#include <vtkSphereSource.h>
+#include <vtkCylinderSource.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
 #include <vtkXMLPolyDataWriter.h>
 
 #include <cmath>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
 
 using namespace sotm;
 
-SphereDrawer::SphereDrawer()
-{
-}
+namespace {
 
-SphereDrawer::SphereDrawer(StaticVector<3> pos, double radius, double color[3], const std::string& follower)
+/// Cube of level of detail grid. Cubes of level l have size 2^l and are aligned like octree nodes
+struct ClusterKey
 {
-	create(pos, radius, color, follower);
-}
+	int level;
+	long long x, y, z;
+
+	bool operator==(const ClusterKey& other) const
+	{
+		return level == other.level && x == other.x && y == other.y && z == other.z;
+	}
+};
 
-void SphereDrawer::create(StaticVector<3> pos, double radius, double color[3], const std::string& follower)
+struct ClusterKeyHash
 {
-	vtkSmartPointer<vtkSphereSource> m_source = vtkSmartPointer<vtkSphereSource>::New();
-	m_source->SetCenter(pos.x);
-	m_source->SetRadius(radius);
+	size_t operator()(const ClusterKey& key) const
+	{
+		size_t hash = std::hash<long long>()(key.x);
+		hash = hash * 31 + std::hash<long long>()(key.y);
+		hash = hash * 31 + std::hash<long long>()(key.z);
+		return hash * 31 + std::hash<int>()(key.level);
+	}
+};
 
-	vtkSmartPointer<vtkPolyDataMapper> m_mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-	m_mapper->SetInputConnection(m_source->GetOutputPort());
+/// Links merged to one point, weighted by length
+struct Cluster
+{
+	double center[3] = {0.0, 0.0, 0.0};
+	double color[3] = {0.0, 0.0, 0.0};
+	double weight = 0.0;
+};
 
-	if (!follower.empty())
+/// Camera frustum and size of screen pixel in world units
+class ScreenMetrics
+{
+public:
+	ScreenMetrics(vtkRenderer* renderer)
 	{
-		vtkSmartPointer<vtkVectorText> textSource = vtkSmartPointer<vtkVectorText>::New();
-		textSource->SetText(follower.c_str());
-
-		// Create a mapper
-		vtkSmartPointer<vtkPolyDataMapper> textMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-		textMapper->SetInputConnection( textSource->GetOutputPort() );
-
-		m_label = vtkSmartPointer<vtkFollower>::New();
-		m_label->SetMapper( textMapper );
-		m_label->GetProperty()->SetColor( 1, 0, 0 ); // red
-		m_label->SetPosition(pos.x);
-		m_label->PickableOff();
-		m_label->SetScale(0.05);
+		vtkCamera* camera = renderer->GetActiveCamera();
+		camera->GetFrustumPlanes(renderer->GetTiledAspectRatio(), m_planes);
+		for (int i = 0; i < 6; i++)
+		{
+			double* plane = &m_planes[4 * i];
+			double norm = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			if (norm != 0.0)
+				for (int j = 0; j < 4; j++)
+					plane[j] /= norm;
+		}
+		camera->GetPosition(m_position);
+		int height = std::max(1, renderer->GetSize()[1]);
+		m_parallel = camera->GetParallelProjection() != 0;
+		if (m_parallel)
+			m_pixel = 2.0 * camera->GetParallelScale() / height;
+		else
+			m_pixel = 2.0 * std::tan(camera->GetViewAngle() * M_PI / 360.0) / height;
 	}
 
-	m_actor = vtkSmartPointer<vtkActor>::New();
-	m_actor->GetProperty()->SetColor(color);
-	m_actor->SetMapper(m_mapper);
-}
+	/// Sphere is at least partly inside of frustum. Plane normals point inside
+	bool visible(const double* center, double radius) const
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			const double* plane = &m_planes[4 * i];
+			if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] < -radius)
+				return false;
+		}
+		return true;
+	}
 
-void SphereDrawer::addActors(vtkRenderer* renderer)
-{
-	renderer->AddActor(m_actor);
-	if (m_label)
+	double pixelSize(const double* point) const
 	{
-		m_label->SetCamera(renderer->GetActiveCamera());
-		renderer->AddActor(m_label);
+		if (m_parallel)
+			return m_pixel;
+		double d[3] = {point[0] - m_position[0], point[1] - m_position[1], point[2] - m_position[2]};
+		return std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) * m_pixel;
 	}
 
+private:
+	double m_planes[24];
+	double m_position[3];
+	double m_pixel;
+	bool m_parallel;
+};
+
 }
 
 GraphRenderer::GraphRenderer(sotm::ModelContext* modelContext, RenderPreferences* renderPreferences) :
@@ -82,176 +127,646 @@ void GraphRenderer::prepareCurrentBuffer()
 	prepareBuffer(m_currentBuffer);
 }
 
-void GraphRenderer::prepareBuffer(WireframeBuffer* buffer)
+void GraphRenderer::prepareCurrentBuffer(const GraphSnapshot& snapshot)
 {
-	buffer->clear();
+	prepareBuffer(m_currentBuffer, snapshot);
+}
 
-	m_modelContext->graphRegister.applyLinkVisitor(
-		[this, buffer] (sotm::Link* link)
+void GraphRenderer::prepareBuffer(WireframeBuffer* buffer)
+{
+	GraphRegister& graph = m_modelContext->graphRegister;
+	std::vector<GraphChange> changes;
+	bool incremental = buffer->built && graph.changesSince(buffer->journalPosition, changes);
+	for (auto &it : changes)
+	{
+		if (it.type == GraphChange::Type::nodeRemoved || it.type == GraphChange::Type::linkRemoved)
 		{
-			linkVisitor(link, buffer);
+			// Cells of removed objects cannot be deleted in place without renumbering
+			incremental = false;
+			break;
 		}
-	);
-	if (m_renderPreferences->enableSpheres)
-	{
-		m_modelContext->graphRegister.applyNodeVisitor(
-			[this, buffer] (sotm::Node* node)
-			{
-				nodeVisitor(node, buffer);
-			}
-		);
 	}
-	buffer->prepareWireframeActor();
+
+	if (incremental)
+		appendChanges(buffer, changes);
+	else
+		rebuildBuffer(buffer);
+
+	refreshScalars(buffer);
+	prepareLabels(buffer);
 }
 
-void GraphRenderer::addActorsFromCurrentBuffer(vtkRenderer* renderer)
+void GraphRenderer::rebuildBuffer(WireframeBuffer* buffer)
 {
-	if (m_renderPreferences->lineWidth)
+	GraphRegister& graph = m_modelContext->graphRegister;
+	buffer->journalPosition = graph.journalEnd();
+	buffer->built = true;
+	buffer->fromSnapshot = false;
+
+	buffer->nodes.clear();
+	buffer->links.clear();
+	buffer->nodeIds.clear();
+	buffer->linkIds.clear();
+	buffer->pendingLinks.clear();
+
+	buffer->points->Reset();
+	buffer->nodeRadiuses->Reset();
+	buffer->nodeColors->Reset();
+	// New cell array, polydata caches cells of previous one
+	buffer->linesCellArray = vtkSmartPointer<vtkCellArray>::New();
+	buffer->polyData->SetLines(buffer->linesCellArray);
+	buffer->linkEnds.clear();
+	buffer->colors->Reset();
+	buffer->widths->Reset();
+	buffer->linkCenters->Reset();
+	buffer->linkDirections->Reset();
+	buffer->linkScales->Reset();
+	buffer->linkGlyphColors->Reset();
+
+	const GraphAdjacency& adjacency = graph.adjacency();
+	for (auto &it : adjacency.nodes)
+		appendNode(buffer, it);
+	for (auto &it : adjacency.links)
+		appendLink(buffer, it);
+
+	topologyModified(buffer);
+}
+
+void GraphRenderer::appendChanges(WireframeBuffer* buffer, const std::vector<GraphChange>& changes)
+{
+	size_t nodesCount = buffer->nodes.size();
+	size_t linksCount = buffer->links.size();
+	for (auto &it : changes)
 	{
-		for (auto& la : m_currentBuffer->lineActors)
-			renderer->AddActor(la);
-	} else {
-		renderer->AddActor(m_currentBuffer->actor);
+		if (it.type == GraphChange::Type::nodeAdded)
+			appendNode(buffer, it.node);
+		else if (it.type == GraphChange::Type::linkAdded)
+			buffer->pendingLinks.push_back(it.link);
 	}
 
-	for (auto& sd : m_currentBuffer->sphereDrawers)
-			sd.addActors(renderer);
-
-	for (auto& wl : m_currentBuffer->wireLabels)
+	// Links are registered before connection, so some of them may wait for next frame
+	std::vector<Link*> notConnected;
+	for (auto &it : buffer->pendingLinks)
 	{
-		wl->SetCamera(renderer->GetActiveCamera());
-		renderer->AddActor(wl);
+		if (!appendLink(buffer, it))
+			notConnected.push_back(it);
 	}
+	buffer->pendingLinks.swap(notConnected);
+
+	if (buffer->nodes.size() != nodesCount || buffer->links.size() != linksCount)
+		topologyModified(buffer);
 }
 
-void GraphRenderer::writeCurrentBufferToFile(const std::string& filename)
+void GraphRenderer::appendNode(WireframeBuffer* buffer, Node* node)
 {
-	vtkSmartPointer<vtkXMLPolyDataWriter> writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
-	writer->SetInputData(m_currentBuffer->polyData);
-	writer->SetFileName("Line.vtp");
-	writer->Write();
+	if (buffer->nodeIds.count(node) != 0)
+		return;
+
+	const unsigned char black[3] = {0, 0, 0};
+	buffer->nodeIds[node] = buffer->points->InsertNextPoint(node->pos.x);
+	buffer->nodes.push_back(node);
+	buffer->nodeRadiuses->InsertNextValue(0.0);
+	buffer->nodeColors->InsertNextTypedTuple(black);
 }
 
-GraphRenderer::WireframeBuffer::WireframeBuffer(RenderPreferences *renderPreferences) :
-		m_renderPreferences(renderPreferences)
+bool GraphRenderer::appendLink(WireframeBuffer* buffer, Link* link)
 {
-	clear();
+	if (buffer->linkIds.count(link) != 0)
+		return true;
+
+	Node* node1 = link->getNode1();
+	Node* node2 = link->getNode2();
+	if (node1 == nullptr || node2 == nullptr)
+		return false;
+	auto id1 = buffer->nodeIds.find(node1);
+	auto id2 = buffer->nodeIds.find(node2);
+	if (id1 == buffer->nodeIds.end() || id2 == buffer->nodeIds.end())
+		return false;
+
+	vtkIdType ids[2] = { id1->second, id2->second };
+	buffer->linkIds[link] = buffer->linesCellArray->InsertNextCell(2, ids);
+	buffer->linkEnds.push_back(std::make_pair(ids[0], ids[1]));
+	buffer->links.push_back(link);
+
+	// Nodes do not move, so link geometry is set once
+	StaticVector<3> center = (node1->pos + node2->pos) / 2.0;
+	StaticVector<3> direction = node2->pos - node1->pos;
+	double scale[3] = {direction.norm(), 0.0, 0.0};
+	const unsigned char black[3] = {0, 0, 0};
+	buffer->colors->InsertNextTypedTuple(black);
+	buffer->widths->InsertNextValue(0.0);
+	buffer->linkCenters->InsertNextPoint(center.x);
+	buffer->linkDirections->InsertNextTuple(direction.x);
+	buffer->linkScales->InsertNextTuple(scale);
+	buffer->linkGlyphColors->InsertNextTypedTuple(black);
+	return true;
 }
 
-void GraphRenderer::WireframeBuffer::clear()
+void GraphRenderer::topologyModified(WireframeBuffer* buffer)
 {
-	points->Reset();
-	linesCellArray->Reset();
-	polyData->Reset();
-	colors->Reset();
-	colors->SetNumberOfComponents(3);
-	lines.clear();
-	lineActors.clear();
-	sphereDrawers.clear();
-	wireLabels.clear();
+	buffer->points->Modified();
+	buffer->linesCellArray->Modified();
+	buffer->polyData->DeleteCells();
+	buffer->polyData->Modified();
+	buffer->nodesPolyData->Modified();
+	buffer->linkCenters->Modified();
+	buffer->linkDirections->Modified();
+	buffer->linkGlyphs->Modified();
 }
 
-void GraphRenderer::WireframeBuffer::prepareWireframeActor()
+template<typename NodeScalars, typename LinkScalars>
+void GraphRenderer::setScalars(WireframeBuffer* buffer, size_t nodesCount, size_t linksCount,
+		const NodeScalars& nodeScalars, const LinkScalars& linkScalars)
 {
-	if (!m_renderPreferences->lineWidth)
+	unsigned char bytes[3];
+	if (m_renderPreferences->enableSpheres)
 	{
-		polyData->SetPoints(points);
-		polyData->SetLines(linesCellArray);
-		polyData->GetCellData()->SetScalars(colors);
+		for (size_t i = 0; i < nodesCount; i++)
+		{
+			double rgb[3] = {1.0, 1.0, 1.0};
+			double radius = nodeScalars(i, rgb);
+			colorToBytes(rgb, bytes);
+			buffer->nodeColors->SetTypedTuple(i, bytes);
+			buffer->nodeRadiuses->SetValue(i, radius);
+		}
+		buffer->nodeColors->Modified();
+		buffer->nodeRadiuses->Modified();
+	}
 
-		mapper->SetInputData(polyData);
-		actor->SetMapper(mapper);
-		//actor->GetProperty()->SetLineWidth(5);
+	for (size_t i = 0; i < linksCount; i++)
+	{
+		double rgb[3] = {1.0, 1.0, 1.0};
+		double width = linkScalars(i, rgb);
+		colorToBytes(rgb, bytes);
+		buffer->colors->SetTypedTuple(i, bytes);
+		buffer->widths->SetValue(i, width);
+
+		if (m_renderPreferences->lineWidth)
+		{
+			double diameter = width * m_renderPreferences->linkWidthScale;
+			double length = buffer->linkScales->GetComponent(i, 0);
+			buffer->linkScales->SetTuple3(i, length, diameter, diameter);
+			buffer->linkGlyphColors->SetTypedTuple(i, bytes);
+		}
+	}
+
+	buffer->colors->Modified();
+	buffer->widths->Modified();
+	if (m_renderPreferences->lineWidth)
+	{
+		buffer->linkScales->Modified();
+		buffer->linkGlyphColors->Modified();
 	}
 }
 
-void GraphRenderer::swapBuffers()
+void GraphRenderer::refreshScalars(WireframeBuffer* buffer)
 {
-	std::swap(m_nextBuffer, m_currentBuffer);
+	setScalars(buffer, buffer->nodes.size(), buffer->links.size(),
+		[buffer](size_t i, double* rgb) -> double {
+			Node* node = buffer->nodes[i];
+			node->payload->getColor(rgb);
+			return node->payload->getSize();
+		},
+		[buffer](size_t i, double* rgb) -> double {
+			Link* link = buffer->links[i];
+			link->payload->getColor(rgb);
+			return link->payload->getSize();
+		}
+	);
 }
 
-void GraphRenderer::linkVisitor(sotm::Link* link, WireframeBuffer* buffer)
+void GraphRenderer::prepareLabels(WireframeBuffer* buffer)
 {
-	auto& p1 = link->getNode1()->pos;
-	auto& p2 = link->getNode2()->pos;
-	StaticVector<3> center = (p1 + p2) / 2.0;
-	if (m_renderPreferences->lineWidth)
+	buffer->labels.clear();
+
+	// Deleted objects are removed from selection
+	for (auto it = m_selectedNodes.begin(); it != m_selectedNodes.end(); )
+	{
+		if (buffer->nodeIds.count(*it) == 0)
+			it = m_selectedNodes.erase(it);
+		else
+			++it;
+	}
+	for (auto it = m_selectedLinks.begin(); it != m_selectedLinks.end(); )
+	{
+		if (buffer->linkIds.count(*it) == 0)
+			it = m_selectedLinks.erase(it);
+		else
+			++it;
+	}
+
+	if (!m_renderPreferences->enableFollowers)
+		return;
+
+	const double nodeLabelColor[3] = {1.0, 0.0, 0.0};
+	for (auto &it : m_selectedNodes)
 	{
-		// Line-by-line rendering
-		vtkSmartPointer<vtkLineSource> lineSource = vtkSmartPointer<vtkLineSource>::New();
-		lineSource->SetPoint1(p1.x);
-		lineSource->SetPoint2(p2.x);
-		lineSource->Update();
-
-		vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-		mapper->SetInputConnection(lineSource->GetOutputPort());
-		vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
-		actor->SetMapper(mapper);
-		actor->GetProperty()->SetLineWidth(link->payload->getSize());
+		Node* node = buffer->nodes[buffer->nodeIds[it]];
+		std::string text = node->payload->getFollowerText();
+		if (!text.empty())
+			buffer->labels.push_back(makeLabel(text, node->pos, nodeLabelColor));
+	}
+
+	const double linkLabelColor[3] = {0.2, 0.8, 0.1};
+	for (auto &it : m_selectedLinks)
+	{
+		Link* link = buffer->links[buffer->linkIds[it]];
+		std::string text = link->payload->getFollowerText();
+		if (text.empty())
+			continue;
+		StaticVector<3> center = (link->getNode1()->pos + link->getNode2()->pos) / 2.0;
+		buffer->labels.push_back(makeLabel(text, center, linkLabelColor));
+	}
+}
 
+void GraphRenderer::prepareBuffer(WireframeBuffer* buffer, const GraphSnapshot& snapshot)
+{
+	size_t nodesCount = snapshot.nodesCount();
+	size_t linksCount = snapshot.linksCount();
+
+	if (!buffer->fromSnapshot || buffer->snapshotStateHash != snapshot.stateHash)
+	{
+		// Buffer does not follow graph journal any more and is rebuilt when graph is drawn next time
+		buffer->built = false;
+		buffer->nodes.clear();
+		buffer->links.clear();
+		buffer->nodeIds.clear();
+		buffer->linkIds.clear();
+		buffer->pendingLinks.clear();
+		buffer->fromSnapshot = true;
+		buffer->snapshotStateHash = snapshot.stateHash;
+
+		buffer->points->SetNumberOfPoints(nodesCount);
+		for (size_t i = 0; i < nodesCount; i++)
+			buffer->points->SetPoint(i, &snapshot.nodePositions[3 * i]);
+		buffer->nodeRadiuses->SetNumberOfTuples(nodesCount);
+		buffer->nodeColors->SetNumberOfTuples(nodesCount);
+
+		buffer->linesCellArray = vtkSmartPointer<vtkCellArray>::New();
+		buffer->polyData->SetLines(buffer->linesCellArray);
+		buffer->linkEnds.resize(linksCount);
+		buffer->colors->SetNumberOfTuples(linksCount);
+		buffer->widths->SetNumberOfTuples(linksCount);
+		buffer->linkCenters->SetNumberOfPoints(linksCount);
+		buffer->linkDirections->SetNumberOfTuples(linksCount);
+		buffer->linkScales->SetNumberOfTuples(linksCount);
+		buffer->linkGlyphColors->SetNumberOfTuples(linksCount);
+		for (size_t i = 0; i < linksCount; i++)
 		{
-			double rgb[3] = {1.0, 1.0, 1.0};
-			link->payload->getColor(rgb);
-			actor->GetProperty()->SetColor(rgb);
+			const std::pair<size_t, size_t>& ends = snapshot.linkNodes[i];
+			vtkIdType ids[2] = { vtkIdType(ends.first), vtkIdType(ends.second) };
+			buffer->linesCellArray->InsertNextCell(2, ids);
+			buffer->linkEnds[i] = std::make_pair(ids[0], ids[1]);
+
+			const double* p1 = &snapshot.nodePositions[3 * ends.first];
+			const double* p2 = &snapshot.nodePositions[3 * ends.second];
+			StaticVector<3> center((p1[0] + p2[0]) / 2.0, (p1[1] + p2[1]) / 2.0, (p1[2] + p2[2]) / 2.0);
+			StaticVector<3> direction(p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]);
+			double scale[3] = {direction.norm(), 0.0, 0.0};
+			buffer->linkCenters->SetPoint(i, center.x);
+			buffer->linkDirections->SetTuple(i, direction.x);
+			buffer->linkScales->SetTuple(i, scale);
 		}
 
-		buffer->lineActors.push_back(actor);
-		// Line-by-line rendering end
+		topologyModified(buffer);
+	}
+
+	setScalars(buffer, nodesCount, linksCount,
+		[&snapshot](size_t i, double* rgb) -> double {
+			for (size_t j = 0; j < 3; j++)
+				rgb[j] = snapshot.nodeColors[3 * i + j];
+			return snapshot.nodeSizes[i];
+		},
+		[&snapshot](size_t i, double* rgb) -> double {
+			for (size_t j = 0; j < 3; j++)
+				rgb[j] = snapshot.linkColors[3 * i + j];
+			return snapshot.linkSizes[i];
+		}
+	);
+
+	buffer->labels.clear();
+	if (!m_renderPreferences->enableFollowers)
+		return;
+
+	const double nodeLabelColor[3] = {1.0, 0.0, 0.0};
+	const double linkLabelColor[3] = {0.2, 0.8, 0.1};
+	for (auto &it : snapshot.labels)
+		buffer->labels.push_back(makeLabel(it.text, it.pos, it.isLink ? linkLabelColor : nodeLabelColor));
+}
+
+void GraphRenderer::addActorsFromCurrentBuffer(vtkRenderer* renderer)
+{
+	WireframeBuffer* buffer = m_currentBuffer;
+	buffer->lodActive = m_renderPreferences->levelOfDetail
+			&& buffer->linkEnds.size() > m_renderPreferences->lodLinksThreshold;
+	buffer->nodeMapper->SetMasking(buffer->lodActive);
+	buffer->linkGlyphMapper->SetMasking(buffer->lodActive);
+	if (buffer->lodActive)
+	{
+		buffer->nodesPolyData->GetPointData()->AddArray(buffer->nodeMask);
+		buffer->linkGlyphs->GetPointData()->AddArray(buffer->linkGlyphMask);
+		prepareLevelOfDetail(buffer, renderer);
 	} else {
-		vtkIdType id1 = buffer->points->InsertNextPoint( p1.x );
-		vtkIdType id2 = buffer->points->InsertNextPoint( p2.x );
+		buffer->nodesPolyData->GetPointData()->RemoveArray("mask");
+		buffer->linkGlyphs->GetPointData()->RemoveArray("mask");
+	}
 
-		vtkSmartPointer<vtkLine> line = vtkSmartPointer<vtkLine>::New();
-		line->GetPointIds()->SetId(0, id1);
-		line->GetPointIds()->SetId(1, id2);
+	if (m_renderPreferences->lineWidth)
+		renderer->AddActor(buffer->linkGlyphActor);
+	else
+		renderer->AddActor(buffer->lodActive ? buffer->lodActor : buffer->actor);
 
-		buffer->lines.push_back(line);
-		// Color source stub
+	if (buffer->lodActive)
+		renderer->AddActor(buffer->clusterActor);
 
-		double rgb[3] = {1.0, 1.0, 1.0};
-		link->payload->getColor(rgb);
-		unsigned char color_uchar[] =
-			{
-				(unsigned char) ( pow(rgb[0], m_renderPreferences->gamma)*255 ),
-				(unsigned char) ( pow(rgb[1], m_renderPreferences->gamma)*255 ),
-				(unsigned char) ( pow(rgb[2], m_renderPreferences->gamma)*255 ),
-			};
-		buffer->colors->InsertNextTypedTuple(color_uchar);
-		//buffer->colors->InsertNe
-
-		buffer->linesCellArray->InsertNextCell(line);
+	if (m_renderPreferences->enableSpheres)
+		renderer->AddActor(buffer->nodeActor);
+
+	for (auto& label : buffer->labels)
+	{
+		label->SetCamera(renderer->GetActiveCamera());
+		renderer->AddActor(label);
 	}
+}
 
-	std::string linkFollowerText = link->payload->getFollowerText();
+void GraphRenderer::updateLevelOfDetail(vtkRenderer* renderer)
+{
+	if (m_currentBuffer->lodActive)
+		prepareLevelOfDetail(m_currentBuffer, renderer);
+}
+
+void GraphRenderer::currentBufferBounds(double bounds[6])
+{
+	m_currentBuffer->points->GetBounds(bounds);
+}
+
+void GraphRenderer::prepareLevelOfDetail(WireframeBuffer* buffer, vtkRenderer* renderer)
+{
+	ScreenMetrics screen(renderer);
+	double minPixels = m_renderPreferences->lodMinPixels;
+	double clusterPixels = std::max(minPixels, m_renderPreferences->lodClusterPixels);
+
+	vtkIdType nodesCount = buffer->points->GetNumberOfPoints();
+	buffer->nodeMask->SetNumberOfTuples(nodesCount);
+	if (m_renderPreferences->enableSpheres)
+	{
+		for (vtkIdType i = 0; i < nodesCount; i++)
+		{
+			double pos[3];
+			buffer->points->GetPoint(i, pos);
+			double radius = buffer->nodeRadiuses->GetValue(i);
+			bool show = screen.visible(pos, radius) && 2.0 * radius >= minPixels * screen.pixelSize(pos);
+			buffer->nodeMask->SetValue(i, show ? 1 : 0);
+		}
+		buffer->nodeMask->Modified();
+	}
+
+	size_t linksCount = buffer->linkEnds.size();
+	buffer->linkGlyphMask->SetNumberOfTuples(linksCount);
+	buffer->lodLines = vtkSmartPointer<vtkCellArray>::New();
+	buffer->lodColors->Reset();
+	std::unordered_map<ClusterKey, Cluster, ClusterKeyHash> clusters;
+
+	for (size_t i = 0; i < linksCount; i++)
+	{
+		const std::pair<vtkIdType, vtkIdType>& ends = buffer->linkEnds[i];
+		double p1[3], p2[3], center[3];
+		buffer->points->GetPoint(ends.first, p1);
+		buffer->points->GetPoint(ends.second, p2);
+		double length2 = 0.0;
+		for (int j = 0; j < 3; j++)
+		{
+			center[j] = (p1[j] + p2[j]) / 2.0;
+			length2 += (p2[j] - p1[j]) * (p2[j] - p1[j]);
+		}
+		double length = std::sqrt(length2);
 
-	if (m_renderPreferences->enableFollowers && !linkFollowerText.empty())
+		unsigned char show = 0;
+		if (screen.visible(center, length / 2.0))
+		{
+			unsigned char bytes[3];
+			buffer->colors->GetTypedTuple(i, bytes);
+			double pixel = screen.pixelSize(center);
+			if (length >= minPixels * pixel)
+			{
+				show = 1;
+				if (!m_renderPreferences->lineWidth)
+				{
+					vtkIdType ids[2] = { ends.first, ends.second };
+					buffer->lodLines->InsertNextCell(2, ids);
+					buffer->lodColors->InsertNextTypedTuple(bytes);
+				}
+			} else if (pixel > 0.0) {
+				// Cube size is power of 2 close to clusterPixels on screen
+				int level = int(std::ceil(std::log2(clusterPixels * pixel)));
+				double size = std::ldexp(1.0, level);
+				ClusterKey key{
+					level,
+					(long long) std::floor(center[0] / size),
+					(long long) std::floor(center[1] / size),
+					(long long) std::floor(center[2] / size)
+				};
+				Cluster& cluster = clusters[key];
+				// Zero length links still count
+				double weight = std::max(length, 1e-3 * pixel);
+				for (int j = 0; j < 3; j++)
+				{
+					cluster.center[j] += center[j] * weight;
+					cluster.color[j] += bytes[j] * weight;
+				}
+				cluster.weight += weight;
+			}
+		}
+		buffer->linkGlyphMask->SetValue(i, show);
+	}
+	buffer->linkGlyphMask->Modified();
+	buffer->lodPolyData->SetLines(buffer->lodLines);
+	buffer->lodColors->Modified();
+	buffer->lodPolyData->Modified();
+
+	buffer->clusterPoints->Reset();
+	buffer->clusterVerts = vtkSmartPointer<vtkCellArray>::New();
+	buffer->clusterColors->Reset();
+	for (auto &it : clusters)
 	{
+		const Cluster& cluster = it.second;
+		double pos[3];
+		unsigned char bytes[3];
+		for (int j = 0; j < 3; j++)
+		{
+			pos[j] = cluster.center[j] / cluster.weight;
+			bytes[j] = (unsigned char) std::min(255.0, cluster.color[j] / cluster.weight);
+		}
+		vtkIdType id = buffer->clusterPoints->InsertNextPoint(pos);
+		buffer->clusterVerts->InsertNextCell(1, &id);
+		buffer->clusterColors->InsertNextTypedTuple(bytes);
+	}
+	buffer->clusterPolyData->SetVerts(buffer->clusterVerts);
+	buffer->clusterPoints->Modified();
+	buffer->clusterColors->Modified();
+	buffer->clusterPolyData->Modified();
+	buffer->clusterActor->GetProperty()->SetPointSize(std::max(1.0, clusterPixels / 2.0));
+}
 
-		vtkSmartPointer<vtkVectorText> textSource = vtkSmartPointer<vtkVectorText>::New();
-		textSource->SetText(linkFollowerText.c_str());
+void GraphRenderer::writeCurrentBufferToFile(const std::string& filename)
+{
+	vtkSmartPointer<vtkXMLPolyDataWriter> writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+	writer->SetInputData(m_currentBuffer->polyData);
+	writer->SetFileName(filename.c_str());
+	writer->Write();
+}
+
+void GraphRenderer::swapBuffers()
+{
+	std::swap(m_nextBuffer, m_currentBuffer);
+}
 
-		// Create a mapper
-		vtkSmartPointer<vtkPolyDataMapper> textMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-		textMapper->SetInputConnection( textSource->GetOutputPort() );
+void GraphRenderer::select(const Node* node)
+{
+	if (node)
+		m_selectedNodes.insert(node);
+}
 
-		vtkSmartPointer<vtkFollower> label = vtkSmartPointer<vtkFollower>::New();
+void GraphRenderer::select(const Link* link)
+{
+	if (link)
+		m_selectedLinks.insert(link);
+}
 
-		label = vtkSmartPointer<vtkFollower>::New();
-		label->SetMapper( textMapper );
-		label->GetProperty()->SetColor( 0.2, 0.8, 0.1 );
-		label->SetPosition(center.x);
-		label->PickableOff();
-		label->SetScale(0.05);
-		buffer->wireLabels.push_back(label);
+bool GraphRenderer::toggleSelection(const Node* node)
+{
+	if (!node)
+		return false;
+	if (m_selectedNodes.erase(node) != 0)
+		return false;
+	m_selectedNodes.insert(node);
+	return true;
+}
+
+void GraphRenderer::clearSelection()
+{
+	m_selectedNodes.clear();
+	m_selectedLinks.clear();
+}
+
+void GraphRenderer::colorToBytes(double* rgb, unsigned char* bytes)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		double value = std::min(1.0, std::max(0.0, rgb[i]));
+		bytes[i] = (unsigned char) ( pow(value, m_renderPreferences->gamma)*255 );
 	}
 }
 
-void GraphRenderer::nodeVisitor(sotm::Node* node, WireframeBuffer* buffer)
+vtkSmartPointer<vtkFollower> GraphRenderer::makeLabel(const std::string& text, const StaticVector<3>& pos, const double* color)
 {
-	double rgb[3];
-	node->payload->getColor(rgb);
-	if (m_renderPreferences->enableFollowers)
-		buffer->sphereDrawers.push_back(SphereDrawer(node->pos, node->payload->getSize(), rgb, node->payload->getFollowerText()));
-	else
-		buffer->sphereDrawers.push_back(SphereDrawer(node->pos, node->payload->getSize(), rgb, ""));
+	vtkSmartPointer<vtkVectorText> textSource = vtkSmartPointer<vtkVectorText>::New();
+	textSource->SetText(text.c_str());
+
+	vtkSmartPointer<vtkPolyDataMapper> textMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+	textMapper->SetInputConnection( textSource->GetOutputPort() );
+
+	vtkSmartPointer<vtkFollower> label = vtkSmartPointer<vtkFollower>::New();
+	label->SetMapper( textMapper );
+	label->GetProperty()->SetColor( color[0], color[1], color[2] );
+	label->SetPosition(pos.x);
+	label->PickableOff();
+	label->SetScale(0.05);
+	return label;
+}
+
+vtkSmartPointer<vtkAlgorithm> GraphRenderer::makeSphereSource()
+{
+	vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+	sphere->SetRadius(1.0);
+	sphere->SetThetaResolution(12);
+	sphere->SetPhiResolution(8);
+	return vtkSmartPointer<vtkAlgorithm>(sphere.GetPointer());
+}
+
+vtkSmartPointer<vtkAlgorithm> GraphRenderer::makeCylinderSource()
+{
+	vtkSmartPointer<vtkCylinderSource> cylinder = vtkSmartPointer<vtkCylinderSource>::New();
+	cylinder->SetHeight(1.0);
+	cylinder->SetRadius(0.5);
+	cylinder->SetResolution(8);
+
+	// vtkCylinderSource is along y, glyph mapper orients x along direction
+	vtkSmartPointer<vtkTransform> toX = vtkSmartPointer<vtkTransform>::New();
+	toX->RotateZ(-90.0);
+
+	vtkSmartPointer<vtkTransformPolyDataFilter> filter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+	filter->SetTransform(toX);
+	filter->SetInputConnection(cylinder->GetOutputPort());
+	return vtkSmartPointer<vtkAlgorithm>(filter.GetPointer());
+}
+
+GraphRenderer::WireframeBuffer::WireframeBuffer(RenderPreferences *renderPreferences, vtkAlgorithm* sphere, vtkAlgorithm* cylinder) :
+		m_renderPreferences(renderPreferences)
+{
+	// Links as lines
+	colors->SetName("color");
+	colors->SetNumberOfComponents(3);
+	widths->SetName("width");
+	polyData->SetPoints(points);
+	polyData->SetLines(linesCellArray);
+	polyData->GetCellData()->SetScalars(colors);
+	polyData->GetCellData()->AddArray(widths);
+	mapper->SetInputData(polyData);
+	actor->SetMapper(mapper);
+
+	// Links as cylinders
+	linkDirections->SetName("direction");
+	linkDirections->SetNumberOfComponents(3);
+	linkScales->SetName("scale");
+	linkScales->SetNumberOfComponents(3);
+	linkGlyphColors->SetName("color");
+	linkGlyphColors->SetNumberOfComponents(3);
+	linkGlyphs->SetPoints(linkCenters);
+	linkGlyphs->GetPointData()->AddArray(linkDirections);
+	linkGlyphs->GetPointData()->AddArray(linkScales);
+	linkGlyphs->GetPointData()->SetScalars(linkGlyphColors);
+	linkGlyphMapper->SetInputData(linkGlyphs);
+	linkGlyphMapper->SetSourceConnection(cylinder->GetOutputPort());
+	linkGlyphMapper->SetOrientationArray("direction");
+	linkGlyphMapper->SetOrientationModeToDirection();
+	linkGlyphMapper->SetScaleArray("scale");
+	linkGlyphMapper->SetScaleModeToScaleByVectorComponents();
+	linkGlyphActor->SetMapper(linkGlyphMapper);
+
+	// Nodes as spheres
+	nodeRadiuses->SetName("radius");
+	nodeColors->SetName("color");
+	nodeColors->SetNumberOfComponents(3);
+	nodesPolyData->SetPoints(points);
+	nodesPolyData->GetPointData()->AddArray(nodeRadiuses);
+	nodesPolyData->GetPointData()->SetScalars(nodeColors);
+	nodeMapper->SetInputData(nodesPolyData);
+	nodeMapper->SetSourceConnection(sphere->GetOutputPort());
+	nodeMapper->OrientOff();
+	nodeMapper->SetScaleArray("radius");
+	nodeMapper->SetScaleModeToScaleByMagnitude();
+	nodeActor->SetMapper(nodeMapper);
+
+	// Level of detail
+	nodeMask->SetName("mask");
+	nodeMapper->SetMaskArray("mask");
+	linkGlyphMask->SetName("mask");
+	linkGlyphMapper->SetMaskArray("mask");
+
+	lodColors->SetName("color");
+	lodColors->SetNumberOfComponents(3);
+	lodPolyData->SetPoints(points);
+	lodPolyData->SetLines(lodLines);
+	lodPolyData->GetCellData()->SetScalars(lodColors);
+	lodMapper->SetInputData(lodPolyData);
+	lodActor->SetMapper(lodMapper);
+
+	clusterColors->SetName("color");
+	clusterColors->SetNumberOfComponents(3);
+	clusterPolyData->SetPoints(clusterPoints);
+	clusterPolyData->SetVerts(clusterVerts);
+	clusterPolyData->GetCellData()->SetScalars(clusterColors);
+	clusterMapper->SetInputData(clusterPolyData);
+	clusterActor->SetMapper(clusterMapper);
 }
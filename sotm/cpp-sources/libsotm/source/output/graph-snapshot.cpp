@@ -0,0 +1,95 @@
+#include "sotm/output/graph-snapshot.hpp"
+
+using namespace sotm;
+
+GraphSnapshotHook::GraphSnapshotHook(ModelContext* modelContext, TripleBuffer<GraphSnapshot>* snapshots, double period) :
+	m_modelContext(modelContext),
+	m_snapshots(snapshots)
+{
+	setPeriod(period);
+}
+
+void GraphSnapshotHook::setSelection(const std::set<const Node*>& nodes, const std::set<const Link*>& links)
+{
+	std::unique_lock<std::mutex> lock(m_selectionMutex);
+	m_selectedNodes = nodes;
+	m_selectedLinks = links;
+}
+
+void GraphSnapshotHook::publish(double time)
+{
+	GraphRegister& graph = m_modelContext->graphRegister;
+	const GraphAdjacency& adjacency = graph.adjacency();
+	GraphSnapshot& snapshot = m_snapshots->writeBuffer();
+
+	snapshot.time = time;
+	snapshot.stateHash = graph.stateHash();
+
+	// Vectors of reused buffer keep their capacity, so steady state publishing does not allocate
+	size_t nodesCount = adjacency.nodes.size();
+	snapshot.nodePositions.resize(3 * nodesCount);
+	snapshot.nodeColors.resize(3 * nodesCount);
+	snapshot.nodeSizes.resize(nodesCount);
+	for (size_t i = 0; i < nodesCount; i++)
+	{
+		Node* node = adjacency.nodes[i];
+		double* rgb = &snapshot.nodeColors[3 * i];
+		rgb[0] = rgb[1] = rgb[2] = 1.0;
+		node->payload->getColor(rgb);
+		snapshot.nodeSizes[i] = node->payload->getSize();
+		for (int j = 0; j < 3; j++)
+			snapshot.nodePositions[3 * i + j] = node->pos[j];
+	}
+
+	size_t linksCount = adjacency.links.size();
+	snapshot.linkNodes.assign(adjacency.linkNodes.begin(), adjacency.linkNodes.end());
+	snapshot.linkColors.resize(3 * linksCount);
+	snapshot.linkSizes.resize(linksCount);
+	for (size_t i = 0; i < linksCount; i++)
+	{
+		Link* link = adjacency.links[i];
+		double* rgb = &snapshot.linkColors[3 * i];
+		rgb[0] = rgb[1] = rgb[2] = 1.0;
+		link->payload->getColor(rgb);
+		snapshot.linkSizes[i] = link->payload->getSize();
+	}
+
+	snapshot.labels.clear();
+	{
+		std::unique_lock<std::mutex> lock(m_selectionMutex);
+		for (auto &it : m_selectedNodes)
+		{
+			size_t index = adjacency.nodeIndex(it);
+			if (index == GraphAdjacency::noIndex)
+				continue;
+			Node* node = adjacency.nodes[index];
+			GraphSnapshot::Label label;
+			label.text = node->payload->getFollowerText();
+			label.pos = node->pos;
+			if (!label.text.empty())
+				snapshot.labels.push_back(label);
+		}
+		if (!m_selectedLinks.empty())
+		{
+			for (auto &it : adjacency.links)
+			{
+				if (m_selectedLinks.count(it) == 0)
+					continue;
+				GraphSnapshot::Label label;
+				label.text = it->payload->getFollowerText();
+				label.pos = (it->getNode1()->pos + it->getNode2()->pos) / 2.0;
+				label.isLink = true;
+				if (!label.text.empty())
+					snapshot.labels.push_back(label);
+			}
+		}
+	}
+
+	m_snapshots->publish();
+}
+
+void GraphSnapshotHook::hook(double time, double wantedTime)
+{
+	UNUSED_ARG(wantedTime);
+	publish(time);
+}
@@ -0,0 +1,330 @@
+#include "sotm/output/metrics-publisher.hpp"
+#include "sotm/utils/log.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+using namespace sotm;
+
+namespace {
+
+void writeAll(int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t result = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (result <= 0)
+            return;
+        written += size_t(result);
+    }
+}
+
+/// Read request headers if client sends them, so it does not get connection reset
+void skipRequest(int fd)
+{
+    char buffer[1024];
+    pollfd p{fd, POLLIN, 0};
+    if (::poll(&p, 1, 100) > 0)
+        ::recv(fd, buffer, sizeof(buffer), 0);
+}
+
+}
+
+std::string MetricsSample::toJson() const
+{
+    std::ostringstream ss;
+    ss << std::setprecision(10)
+       << "{\"wall\":" << wallTime
+       << ",\"t\":" << time
+       << ",\"dt\":" << dt
+       << ",\"nodes\":" << nodes
+       << ",\"links\":" << links
+       << ",\"steps\":" << steps
+       << ",\"steps_per_s\":" << stepsPerSecond
+       << ",\"field_eval_load\":";
+    if (fieldEvaluationLoad < 0.0)
+        ss << "null";
+    else
+        ss << fieldEvaluationLoad;
+    ss << ",\"rejection_rate\":" << rejectionRate << "}";
+    return ss.str();
+}
+
+MetricsPublisher::MetricsPublisher(ModelContext* modelContext, TimeIterator* timeIterator, double periodSeconds) :
+    m_modelContext(modelContext),
+    m_timeIterator(timeIterator),
+    m_period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(periodSeconds))),
+    m_start(Clock::now()),
+    m_nextSample(m_start + m_period),
+    m_previousWall(m_start),
+    m_previousMetrics(timeIterator->metrics()),
+    m_previousProfiling(Profiler::snapshot())
+{
+}
+
+MetricsPublisher::~MetricsPublisher()
+{
+    stop();
+}
+
+void MetricsPublisher::setFile(const std::string& filename, size_t maxBytes, size_t keepFiles)
+{
+    m_filename = filename;
+    m_fileMaxBytes = maxBytes;
+    m_fileKeep = keepFiles;
+    m_file.close();
+    m_file.open(m_filename, std::ios::out | std::ios::app);
+    if (!m_file.is_open())
+        throw std::runtime_error("Cannot open metrics file " + m_filename);
+}
+
+void MetricsPublisher::setLogSummary(bool logSummary)
+{
+    m_logSummary = logSummary;
+}
+
+void MetricsPublisher::listenUnixSocket(const std::string& path)
+{
+    sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Metrics socket path is too long: " + path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create metrics socket");
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 8) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot listen metrics socket " + path);
+    }
+    m_socketPath = path;
+    m_unixSocket = fd;
+    startServer();
+}
+
+void MetricsPublisher::listenHttp(int port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create metrics HTTP socket");
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(uint16_t(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 8) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot listen metrics HTTP port " + std::to_string(port));
+    }
+    m_httpSocket = fd;
+    startServer();
+}
+
+void MetricsPublisher::publish()
+{
+    MetricsSample s = sample();
+    std::string json = s.toJson();
+    {
+        std::unique_lock<std::mutex> lock(m_lastMutex);
+        m_lastSample = s;
+        m_lastJson = json;
+    }
+
+    if (m_file.is_open())
+        writeFile(json);
+
+    if (m_logSummary)
+    {
+        std::ostringstream ss;
+        ss << "t = " << s.time << ", dt = " << s.dt
+           << ", nodes: " << s.nodes << ", links: " << s.links
+           << ", steps/s: " << s.stepsPerSecond
+           << ", rejected: " << s.rejectionRate * 100.0 << "%";
+        if (s.fieldEvaluationLoad >= 0.0)
+            ss << ", field evaluation: " << s.fieldEvaluationLoad * 100.0 << "%";
+        SOTM_LOG(info) << ss.str();
+        // Summary is shown when it is sampled, not with next block of buffered messages
+        Log::flush();
+    }
+}
+
+void MetricsPublisher::stop()
+{
+    m_stop = true;
+    if (m_server.joinable())
+        m_server.join();
+    if (m_unixSocket >= 0)
+    {
+        ::close(m_unixSocket);
+        ::unlink(m_socketPath.c_str());
+        m_unixSocket = -1;
+    }
+    if (m_httpSocket >= 0)
+    {
+        ::close(m_httpSocket);
+        m_httpSocket = -1;
+    }
+    m_file.close();
+}
+
+MetricsSample MetricsPublisher::lastSample()
+{
+    std::unique_lock<std::mutex> lock(m_lastMutex);
+    return m_lastSample;
+}
+
+void MetricsPublisher::runHook(double time)
+{
+    m_lastTime = time;
+    Clock::time_point now = Clock::now();
+    if (now < m_nextSample)
+        return;
+    publish();
+    // Missed samples are not repeated
+    m_nextSample += m_period;
+    if (m_nextSample <= now)
+        m_nextSample = now + m_period;
+}
+
+double MetricsPublisher::getNextTime()
+{
+    // Checked after every iteration
+    return std::nextafter(m_lastTime, std::numeric_limits<double>::infinity());
+}
+
+MetricsSample MetricsPublisher::sample()
+{
+    Clock::time_point now = Clock::now();
+    const ContiniousIteratorMetrics& metrics = m_timeIterator->metrics();
+    GraphRegister& graph = m_modelContext->graphRegister;
+
+    MetricsSample s;
+    s.wallTime = std::chrono::duration<double>(now - m_start).count();
+    s.time = m_timeIterator->getTime();
+    s.dt = m_timeIterator->getStep();
+    s.nodes = graph.nodesCount();
+    s.links = graph.linksCount();
+    s.steps = metrics.timeIterations;
+
+    double interval = std::chrono::duration<double>(now - m_previousWall).count();
+    size_t steps = metrics.timeIterations - m_previousMetrics.timeIterations;
+    size_t calculations = metrics.totalStepCalculations - m_previousMetrics.totalStepCalculations;
+    if (interval > 0.0)
+        s.stepsPerSecond = steps / interval;
+    if (calculations != 0)
+        s.rejectionRate = double(calculations - steps) / calculations;
+
+    if (Profiler::compiledIn())
+    {
+        ProfilingSnapshot profiling = Profiler::snapshot();
+        size_t phase = size_t(ProfilingPhase::fieldEvaluation);
+        double seconds = (profiling[phase].totalNs - m_previousProfiling[phase].totalNs) * 1e-9;
+        s.fieldEvaluationLoad = interval > 0.0 ? seconds / interval : 0.0;
+        m_previousProfiling = profiling;
+    }
+
+    m_previousWall = now;
+    m_previousMetrics = metrics;
+    return s;
+}
+
+void MetricsPublisher::writeFile(const std::string& line)
+{
+    m_file << line << '\n';
+    m_file.flush();
+    if (m_fileMaxBytes != 0 && size_t(m_file.tellp()) >= m_fileMaxBytes)
+        rotateFile();
+}
+
+void MetricsPublisher::rotateFile()
+{
+    m_file.close();
+    if (m_fileKeep == 0)
+    {
+        std::remove(m_filename.c_str());
+    } else {
+        // file.(keep-1) -> file.keep, ..., file -> file.1
+        for (size_t i = m_fileKeep; i > 1; i--)
+        {
+            std::string from = m_filename + "." + std::to_string(i - 1);
+            std::string to = m_filename + "." + std::to_string(i);
+            std::rename(from.c_str(), to.c_str());
+        }
+        std::rename(m_filename.c_str(), (m_filename + ".1").c_str());
+    }
+    m_file.open(m_filename, std::ios::out | std::ios::trunc);
+}
+
+void MetricsPublisher::startServer()
+{
+    if (m_server.joinable())
+        return;
+    m_stop = false;
+    m_server = std::thread([this]() { serve(); });
+}
+
+void MetricsPublisher::serve()
+{
+    while (!m_stop)
+    {
+        // Sockets may be added after thread start, so they are taken every time
+        pollfd fds[2];
+        int count = 0;
+        int unixSocket = m_unixSocket;
+        int httpSocket = m_httpSocket;
+        if (unixSocket >= 0)
+            fds[count++] = pollfd{unixSocket, POLLIN, 0};
+        if (httpSocket >= 0)
+            fds[count++] = pollfd{httpSocket, POLLIN, 0};
+
+        if (::poll(fds, count, 200) <= 0)
+            continue;
+
+        std::string json;
+        {
+            std::unique_lock<std::mutex> lock(m_lastMutex);
+            json = m_lastJson.empty() ? std::string("{}") : m_lastJson;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            if ((fds[i].revents & POLLIN) == 0)
+                continue;
+            int client = ::accept(fds[i].fd, nullptr, nullptr);
+            if (client < 0)
+                continue;
+            if (fds[i].fd == httpSocket)
+            {
+                skipRequest(client);
+                std::string body = json + "\n";
+                writeAll(client,
+                    "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nContent-Length: "
+                    + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+            } else {
+                writeAll(client, json + "\n");
+            }
+            ::close(client);
+        }
+    }
+}
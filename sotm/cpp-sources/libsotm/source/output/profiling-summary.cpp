@@ -0,0 +1,18 @@
+#include "sotm/output/profiling-summary.hpp"
+
+#include "sotm/utils/log.hpp"
+
+using namespace sotm;
+
+ProfilingSummaryHook::ProfilingSummaryHook(double period) :
+    m_last(Profiler::snapshot())
+{
+    setPeriod(period);
+}
+
+void ProfilingSummaryHook::hook(double time, double wantedTime)
+{
+    UNUSED_ARG(wantedTime);
+    SOTM_LOG(info) << "t = " << time << " " << Profiler::summary(&m_last);
+    m_last = Profiler::snapshot();
+}
@@ -0,0 +1,169 @@
+#include "sotm/output/render-hook.hpp"
+
+#include <vtkCamera.h>
+#include <vtkPNGWriter.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkSmartPointer.h>
+#include <vtkWindowToImageFilter.h>
+
+#include <iomanip>
+#include <sstream>
+
+using namespace sotm;
+
+RenderHook::RenderHook(ModelContext* modelContext, const RenderPreferences& renderPreferences, double period) :
+    m_renderPreferences(renderPreferences),
+    m_renderer(modelContext, &m_renderPreferences)
+{
+    // Nothing is selected without GUI
+    m_renderPreferences.enableFollowers = false;
+    setPeriod(period);
+}
+
+RenderHook::~RenderHook()
+{
+    finish();
+}
+
+void RenderHook::setFilenamePrefix(const std::string& prefix)
+{
+    m_prefix = prefix;
+}
+
+void RenderHook::setImageSize(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+}
+
+void RenderHook::setCamera(const StaticVector<3>& position, const StaticVector<3>& focalPoint)
+{
+    m_cameraSet = true;
+    m_cameraPosition = position;
+    m_cameraFocalPoint = focalPoint;
+}
+
+void RenderHook::setDropFrames(bool dropFrames)
+{
+    m_dropFrames = dropFrames;
+}
+
+void RenderHook::finish()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+size_t RenderHook::framesWritten()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_framesWritten;
+}
+
+size_t RenderHook::framesDropped()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_framesDropped;
+}
+
+void RenderHook::hook(double time, double wantedTime)
+{
+    UNUSED_ARG(time);
+    UNUSED_ARG(wantedTime);
+
+    if (!m_thread.joinable())
+        m_thread = std::thread([this]() { renderLoop(); });
+
+    if (m_dropFrames)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_frameReady)
+        {
+            m_framesDropped++;
+            return;
+        }
+    }
+
+    // Graph does not change while hook runs, next buffer is not used by rendering thread
+    m_renderer.prepareNextBuffer();
+
+    std::ostringstream ss;
+    ss << m_prefix << "_" << std::setw(6) << std::setfill('0') << m_frame++ << ".png";
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // Rendering thread reads current buffer until its frame is written
+        m_condition.wait(lock, [this]() { return !m_frameReady; });
+        m_renderer.swapBuffers();
+        m_filename = ss.str();
+        m_frameReady = true;
+    }
+    m_condition.notify_all();
+}
+
+void RenderHook::renderLoop()
+{
+    // OpenGL context belongs to this thread, so all rendering objects are created here
+    vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
+    renderer->SetBackground(0.0, 0.0, 0.0);
+
+    vtkSmartPointer<vtkRenderWindow> window = vtkSmartPointer<vtkRenderWindow>::New();
+    window->SetOffScreenRendering(1);
+    window->SetSize(m_width, m_height);
+    window->AddRenderer(renderer);
+
+    vtkSmartPointer<vtkWindowToImageFilter> grabber = vtkSmartPointer<vtkWindowToImageFilter>::New();
+    grabber->SetInput(window);
+    grabber->ReadFrontBufferOff();
+
+    vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+    writer->SetInputConnection(grabber->GetOutputPort());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_condition.wait(lock, [this]() { return m_frameReady || m_stop; });
+        if (!m_frameReady)
+            break;
+        std::string filename = m_filename;
+        lock.unlock();
+
+        renderer->RemoveAllViewProps();
+
+        // Camera is set up by nodes bounds before actors are added,
+        // so level of detail is prepared once for final camera
+        double bounds[6];
+        m_renderer.currentBufferBounds(bounds);
+        vtkCamera* camera = renderer->GetActiveCamera();
+        camera->SetViewUp(0.0, 0.0, 1.0);
+        if (m_cameraSet)
+        {
+            camera->SetPosition(m_cameraPosition.x);
+            camera->SetFocalPoint(m_cameraFocalPoint.x);
+            renderer->ResetCameraClippingRange(bounds);
+        } else {
+            camera->SetFocalPoint(0.0, 0.0, 0.0);
+            camera->SetPosition(0.0, -1.0, 0.0);
+            renderer->ResetCamera(bounds);
+        }
+        m_renderer.addActorsFromCurrentBuffer(renderer);
+        // Node spheres may be out of nodes bounds, clipping range does not change frustum sides
+        renderer->ResetCameraClippingRange();
+
+        window->Render();
+        grabber->Modified();
+        writer->SetFileName(filename.c_str());
+        writer->Write();
+
+        lock.lock();
+        m_frameReady = false;
+        m_framesWritten++;
+        m_condition.notify_all();
+    }
+}
@@ -1,8 +1,12 @@
 #include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "sotm/payloads/electrostatics/equipotential.hpp"
 #include "sotm/base/model-context.hpp"
 #include "sotm/utils/const.hpp"
 #include "sotm/math/distrib-gen.hpp"
+#include "sotm/utils/profiling.hpp"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 
 #include <ios>
@@ -18,14 +22,25 @@ double ElectrostaticNodePayload::chargeMax = 0.0;
 
 FieldScalarZero<3> ElectrostaticPhysicalContext::zeroField;
 
+ElectrostaticPhysicalContext::ElectrostaticPhysicalContext()
+{
+}
+
+ElectrostaticPhysicalContext::~ElectrostaticPhysicalContext()
+{
+}
+
 void ElectrostaticPhysicalContext::calculateSecondaryValues(double time)
 {
+    SOTM_PROFILE_SCOPE(ProfilingPhase::rebuildOptimization);
     optimizer->rebuildOptimization();
 }
 
 void ElectrostaticPhysicalContext::calculateRHS(double time)
 {
 	UNUSED_ARG(time);
+	// Payloads RHS are calculated after context RHS, so link currents will be ready for them
+	calculateLinkCurrents();
 }
 
 void ElectrostaticPhysicalContext::addRHSToDelta(double m)
@@ -40,12 +55,18 @@ void ElectrostaticPhysicalContext::makeSubIteration(double dt)
 
 void ElectrostaticPhysicalContext::step()
 {
-
+	// Context step() is called before payloads step(), so charge deltas may be corrected here
+	if (equipotentialChannels)
+	{
+		if (!m_equipotentialSolver)
+			m_equipotentialSolver.reset(new EquipotentialSolver(*this));
+		m_equipotentialSolver->equalize();
+	}
 }
 
 void ElectrostaticPhysicalContext::init()
 {
-    std::cout << "Here!" << std::endl;
+    SOTM_PROFILE_SCOPE(ProfilingPhase::rebuildOptimization);
     optimizer->rebuildOptimization();
 }
 
@@ -60,6 +81,122 @@ void ElectrostaticPhysicalContext::setDischargeFunc(Function1D func)
 	m_integralOfProb.reset(new DefinedIntegral(m_dischargeProb, -20e6, 20e6, 10000));
 }
 
+void ElectrostaticPhysicalContext::rebuildLinkEntriesIfNeeded()
+{
+	size_t stateHash = m_model->graphRegister.stateHash();
+	if (m_linkEntriesStateHash == stateHash)
+		return;
+
+	const GraphAdjacency& adjacency = m_model->graphRegister.adjacency();
+	const ParallelSettings& parallel = m_model->parallelSettings;
+
+	// Arrays are written first by the same loops as in calculateLinkCurrents(),
+	// so with NUMA aware parallel settings they are placed near threads that use them
+	bool parallelRHS = parallel.runParallel(ParallelSettings::Phase::calculateRHS, adjacency.links.size());
+	auto firstTouch = [&parallel, parallelRHS](size_t begin, size_t end, const std::function<void(size_t)>& write)
+	{
+		if (parallelRHS)
+		{
+			parallel.parallelFor(ParallelSettings::Phase::calculateRHS, begin, end, write);
+		} else {
+			for (size_t i = begin; i < end; i++)
+				write(i);
+		}
+	};
+
+	m_nodePayloads.allocate(adjacency.nodes.size());
+	firstTouch(0, m_nodePayloads.size(), [this, &adjacency](size_t i) {
+		m_nodePayloads[i] = static_cast<ElectrostaticNodePayload*>(adjacency.nodes[i]->payload.get());
+	});
+
+	// Greedy edge coloring: link gets first color that is not used by its nodes
+	std::vector<std::vector<size_t>> nodeColors(m_nodePayloads.size());
+	std::vector<std::vector<LinkCurrentEntry>> colored;
+	for (size_t i = 0; i < adjacency.links.size(); i++)
+	{
+		LinkCurrentEntry entry;
+		entry.link = static_cast<ElectrostaticLinkPayload*>(adjacency.links[i]->payload.get());
+		entry.node1 = adjacency.linkNodes[i].first;
+		entry.node2 = adjacency.linkNodes[i].second;
+
+		auto& colors1 = nodeColors[entry.node1];
+		auto& colors2 = nodeColors[entry.node2];
+		size_t color = 0;
+		while (std::find(colors1.begin(), colors1.end(), color) != colors1.end()
+				|| std::find(colors2.begin(), colors2.end(), color) != colors2.end())
+			color++;
+
+		colors1.push_back(color);
+		colors2.push_back(color);
+		if (colored.size() <= color)
+			colored.resize(color + 1);
+		colored[color].push_back(entry);
+	}
+
+	m_colorBegins.clear();
+	m_colorBegins.push_back(0);
+	for (auto &it : colored)
+		m_colorBegins.push_back(m_colorBegins.back() + it.size());
+
+	m_linkEntries.allocate(m_colorBegins.back());
+	for (size_t color = 0; color < colored.size(); color++)
+	{
+		const std::vector<LinkCurrentEntry>& entries = colored[color];
+		size_t begin = m_colorBegins[color];
+		firstTouch(begin, m_colorBegins[color+1], [this, &entries, begin](size_t i) {
+			m_linkEntries[i] = entries[i - begin];
+		});
+	}
+
+	m_linkEntriesStateHash = stateHash;
+}
+
+void ElectrostaticPhysicalContext::calculateLinkCurrents()
+{
+	rebuildLinkEntriesIfNeeded();
+
+	auto scatter = [this](const LinkCurrentEntry& entry)
+	{
+		double current = entry.link->updateCurrent();
+		m_nodePayloads[entry.node1]->charge.rhs -= current;
+		m_nodePayloads[entry.node2]->charge.rhs += current;
+	};
+
+	const ParallelSettings& parallel = m_model->parallelSettings;
+	if (parallel.runParallel(ParallelSettings::Phase::calculateRHS, m_linkEntries.size()))
+	{
+		parallel.parallelFor(ParallelSettings::Phase::calculateRHS, 0, m_nodePayloads.size(),
+			[this](size_t i) { m_nodePayloads[i]->charge.rhs = 0; }
+		);
+		for (size_t color = 0; color + 1 < m_colorBegins.size(); color++)
+		{
+			parallel.parallelFor(ParallelSettings::Phase::calculateRHS, m_colorBegins[color], m_colorBegins[color+1],
+				[this, &scatter](size_t i) { scatter(m_linkEntries[i]); }
+			);
+		}
+	} else {
+		for (auto it : m_nodePayloads)
+			it->charge.rhs = 0;
+		for (auto &it : m_linkEntries)
+			scatter(it);
+	}
+}
+
+std::unique_ptr<CoulombPotentialOperator> ElectrostaticPhysicalContext::makePotentialOperator()
+{
+	const GraphAdjacency& adjacency = m_model->graphRegister.adjacency();
+	std::vector<double> selfElastance;
+	for (auto n : adjacency.nodes)
+	{
+		ElectrostaticNodePayload* payload = static_cast<ElectrostaticNodePayload*>(n->payload.get());
+		selfElastance.push_back(Const::Si::k / payload->nodeRadiusConductivity);
+	}
+	return std::unique_ptr<CoulombPotentialOperator>(new CoulombPotentialOperator(
+		*optimizer, adjacency.nodes, selfElastance,
+		m_model->parallelSettings, ParallelSettings::Phase::calculateSecondaryValues
+	));
+}
+
 bool ElectrostaticPhysicalContext::testConnection(const Node* n1, const Node* n2) const
 {
     if (n1 == n2)
@@ -70,7 +207,7 @@ bool ElectrostaticPhysicalContext::testConnection(const Node* n1, const Node* n2
 	double phi2 = static_cast<ElectrostaticNodePayload*>(n2->payload.get())->phi;
 
 	double U = fabs(phi1 - phi2);
-    double l = (n1->pos - n2->pos).norm();
+    double l = sotm::distance(n1->pos, n2->pos);
 	// Filed is enough and we are not already connected. Second check is here for performance reason
 	if (U/l > connectionCriticalField
 			&& !n1->hasNeighbour(n2)
@@ -81,6 +218,37 @@ bool ElectrostaticPhysicalContext::testConnection(const Node* n1, const Node* n2
 		return false;
 }
 
+void ElectrostaticPhysicalContext::addToNodesGrid(ElectrostaticNodePayload* payload, const StaticVector<3>& pos)
+{
+    if (!m_nodesGrid)
+    {
+        // Collisions are checked at about two branching radii
+        double cellSize = 2.0 * payload->nodeRadiusBranching;
+        m_nodesGrid.reset(new SpatialHashGridT<ElectrostaticNodePayload*>(cellSize > 0.0 ? cellSize : 1.0));
+    }
+    m_nodesGrid->insert(pos, payload);
+    m_maxNodeRadiusBranching = std::max(m_maxNodeRadiusBranching, payload->nodeRadiusBranching);
+}
+
+void ElectrostaticPhysicalContext::removeFromNodesGrid(ElectrostaticNodePayload* payload, const StaticVector<3>& pos)
+{
+    if (m_nodesGrid)
+        m_nodesGrid->erase(pos, payload);
+}
+
+bool ElectrostaticPhysicalContext::hasNodeCloser(const StaticVector<3>& pos, double distance) const
+{
+    return m_nodesGrid && m_nodesGrid->hasPointCloser(pos, distance);
+}
+
+ElectrostaticNodePayload* ElectrostaticPhysicalContext::findNearestNode(const StaticVector<3>& pos, double distance) const
+{
+    ElectrostaticNodePayload* result = nullptr;
+    if (m_nodesGrid)
+        m_nodesGrid->findNearest(pos, distance, result);
+    return result;
+}
+
 ////////////////////////////////////
 // ElectrostaticNodePayload
 
@@ -90,20 +258,23 @@ ElectrostaticNodePayload::ElectrostaticNodePayload(PhysicalPayloadsRegister* reg
         nodeRadiusConductivity(nodeRadiusConductivity)
 {
 
-	// Connecting to node if it is too close
-	Node *nearest = context()->m_model->graphRegister.getNearestNode(node->pos);
+	// Connecting to node if it is too close. Nodes farther than r1 + maximal r2 cannot be too close
+	ElectrostaticPhysicalContext* c = context();
+	ElectrostaticNodePayload *nearest = c->findNearestNode(node->pos, nodeRadiusBranching + c->m_maxNodeRadiusBranching);
 
 	if (nearest != nullptr)
 	{
-        double dist = (nearest->pos - node->pos).norm();
+        double dist = sotm::distance(nearest->node->pos, node->pos);
 		double r1 = nodeRadiusBranching;
-		double r2 = static_cast<ElectrostaticNodePayload*>(nearest->payload.get())->nodeRadiusBranching;
+		double r2 = nearest->nodeRadiusBranching;
 		if (dist < r1 + r2)
 		{
-			if (!this->node->hasNeighbour(nearest))
-				connectToTarget(nearest);
+			if (!this->node->hasNeighbour(nearest->node))
+				connectToTarget(nearest->node);
 		}
 	}
+
+	c->addToNodesGrid(this, node->pos);
 }
 
 void ElectrostaticNodePayload::clearSubiteration()
@@ -121,13 +292,8 @@ void ElectrostaticNodePayload::calculateSecondaryValues(double time)
 
 void ElectrostaticNodePayload::calculateRHS(double time)
 {
-	charge.rhs = 0;
-	Node::LinkVisitor linkVisitor = [this](Link* link, LinkDirection dir)
-	{
-		double current = static_cast<ElectrostaticLinkPayload*>(link->payload.get())->getCurrent();
-		charge.rhs += current * (dir == LinkDirection::in ? 1.0 : -1.0);
-	};
-	node->applyConnectedLinksVisitor(linkVisitor);
+	UNUSED_ARG(time);
+	// charge.rhs is calculated by ElectrostaticPhysicalContext::calculateLinkCurrents()
 }
 
 void ElectrostaticNodePayload::addRHSToDelta(double m)
@@ -158,12 +324,19 @@ void ElectrostaticNodePayload::calculateExtFieldAndPhi()
 
 */
 
-    FieldPotential fp = coulombNode->getFP();
+    FieldPotential fp;
+    {
+        SOTM_PROFILE_SCOPE(ProfilingPhase::fieldEvaluation);
+        fp = coulombNode->getFP();
+    }
     externalField = fp.field;
     phi = fp.potential;
 
-    externalField += - GradientFixedStep<3>(*context()->externalPotential, 1e-2) (node->pos);
-    phi += (*context()->externalPotential) (node->pos);
+    double externalPhi = 0.0;
+    StaticVector<3> externalGradient;
+    context()->externalPotential->valueAndGradient(node->pos, externalPhi, externalGradient);
+    externalField -= externalGradient;
+    phi += externalPhi;
 }
 
 Node* ElectrostaticNodePayload::findTargetToConnectByMeanField() const
@@ -204,9 +377,17 @@ void ElectrostaticNodePayload::doBifurcation(double time, double dt)
 
 void ElectrostaticNodePayload::init()
 {
+	context()->m_maxNodeRadiusBranching = std::max(context()->m_maxNodeRadiusBranching, nodeRadiusBranching);
 	calculateExtFieldAndPhi();
 }
 
+void ElectrostaticNodePayload::onDeletePayload()
+{
+	// Node is released by base class
+	context()->removeFromNodesGrid(this, node->pos);
+	NodePayloadBase::onDeletePayload();
+}
+
 void ElectrostaticNodePayload::getBranchingParameters(double time, double dt, BranchingParameters& branchingParameters)
 {
     double radius = nodeRadiusBranching;
@@ -218,7 +399,7 @@ void ElectrostaticNodePayload::getBranchingParameters(double time, double dt, Br
 		E0,
 		E1,
 		context()->m_dischargeProb,
-		context()->m_integralOfProb->function()
+		*context()->m_integralOfProb
 	);
 	branchingParameters.needBranching = res.isHappened;
 	if (branchingParameters.needBranching)
@@ -236,10 +417,7 @@ void ElectrostaticNodePayload::getBranchingParameters(double time, double dt, Br
 
 		// Testing for collision with nearest nodes
 		StaticVector<3> newPlace = node->pos + branchingParameters.direction * len;
-		Node *nearest = context()->m_model->graphRegister.getNearestNode(newPlace);
-        double dist = (nearest->pos - newPlace).norm();
-		//if (nearest && dist < radius*2.0)
-		if (nearest && dist < context()->branchingStep*0.3)
+		if (context()->findNearestNode(newPlace, context()->branchingStep*0.3) != nullptr)
 		{
 			branchingParameters.needBranching = false;
 		}
@@ -356,9 +534,10 @@ void ElectrostaticLinkPayload::calculateSecondaryValues(double time)
 
 void ElectrostaticLinkPayload::calculateRHS(double time)
 {
-	double U = getVoltage();
-    conductivity.rhs = (linkEta * sqr(U / link->length()) - linkBeta) * conductivity.current;
-	temperature.rhs = getCurrent() * U / getHeatCapacity();
+	// current and voltage are updated by ElectrostaticPhysicalContext::calculateLinkCurrents()
+	double U = voltage;
+    conductivity.rhs = (linkEta * sqr(U * link->inverseLength()) - linkBeta) * conductivity.current;
+	temperature.rhs = current * U / heatCapacity;
 }
 
 void ElectrostaticLinkPayload::addRHSToDelta(double m)
@@ -396,6 +575,7 @@ void ElectrostaticLinkPayload::doBifurcation(double time, double dt)
 
 void ElectrostaticLinkPayload::init()
 {
+	updateGeometry();
 	setTemperature(context()->airTemperature);
     conductivity.set(context()->initialConductivity);
     /*
@@ -442,7 +622,7 @@ void ElectrostaticLinkPayload::getParametersVector(double* parameters)
 
 double ElectrostaticLinkPayload::getTotalConductivity()
 {
-	return getIOIEffectiveCondictivity() * Const::pi * context()->linkRadius * context()->linkRadius / link->length();
+	return getIOIEffectiveCondictivity() * crossSectionPerLength;
 }
 
 double ElectrostaticLinkPayload::getIOIEffectiveCondictivity()
@@ -456,6 +636,13 @@ double ElectrostaticLinkPayload::getCurrent()
 	return getVoltage() * getTotalConductivity();
 }
 
+double ElectrostaticLinkPayload::updateCurrent()
+{
+	voltage = getVoltage();
+	current = voltage * getTotalConductivity();
+	return current;
+}
+
 double ElectrostaticLinkPayload::getVoltage()
 {
 	Node* n1 = link->getNode1();
@@ -480,13 +667,17 @@ double ElectrostaticLinkPayload::getTemperature()
 
 double ElectrostaticLinkPayload::getHeatCapacity()
 {
-	double l = link->lengthCached();
-	double r = context()->linkRadius;
-	double volume = Const::pi * sqr(r) * l;
-	double heatCapacity = volume * Const::Si::SpecificHeat::air;
 	return heatCapacity;
 }
 
+void ElectrostaticLinkPayload::updateGeometry()
+{
+	double crossSection = Const::pi * sqr(context()->linkRadius.get());
+	double volume = crossSection * link->length();
+	crossSectionPerLength = crossSection * link->inverseLength();
+	heatCapacity = volume * Const::Si::SpecificHeat::air;
+}
+
 /////////////////////////////
 // ElectrostaticNodePayloadFactory
 
@@ -0,0 +1,173 @@
+#include "sotm/payloads/electrostatics/equipotential.hpp"
+#include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "sotm/optimizers/coulomb-operator.hpp"
+#include "sotm/utils/const.hpp"
+#include "sotm/utils/profiling.hpp"
+
+#include <limits>
+
+using namespace sotm;
+
+EquipotentialSolver::EquipotentialSolver(ElectrostaticPhysicalContext& context) :
+    m_context(context)
+{
+}
+
+void EquipotentialSolver::equalize()
+{
+    SOTM_PROFILE_SCOPE(ProfilingPhase::equipotentialSolve);
+    m_stats = Stats();
+
+    findChannels();
+    if (m_channels.empty())
+        return;
+
+    // Coulomb engine should see charges of the end of step
+    const GraphAdjacency& adjacency = m_context.m_model->graphRegister.adjacency();
+    for (auto n : adjacency.nodes)
+    {
+        ElectrostaticNodePayload* payload = static_cast<ElectrostaticNodePayload*>(n->payload.get());
+        payload->charge.current = payload->charge.previous + payload->charge.delta;
+    }
+    m_context.optimizer->rebuildOptimization();
+
+    for (auto &it : m_channels)
+        solveChannel(it);
+}
+
+void EquipotentialSolver::findChannels()
+{
+    m_channels.clear();
+
+    const GraphAdjacency& adjacency = m_context.m_model->graphRegister.adjacency();
+    size_t nodesCount = adjacency.nodes.size();
+
+    m_parents.resize(nodesCount);
+    for (size_t i = 0; i < nodesCount; i++)
+        m_parents[i] = i;
+
+    double threshold = m_context.equipotentialConductivityFraction * m_context.conductivityLimit;
+    for (size_t i = 0; i < adjacency.links.size(); i++)
+    {
+        ElectrostaticLinkPayload* link = static_cast<ElectrostaticLinkPayload*>(adjacency.links[i]->payload.get());
+        if (link->getIOIEffectiveCondictivity() < threshold)
+            continue;
+        size_t root1 = findRoot(adjacency.linkNodes[i].first);
+        size_t root2 = findRoot(adjacency.linkNodes[i].second);
+        if (root1 != root2)
+            m_parents[root1] = root2;
+    }
+
+    const size_t noChannel = std::numeric_limits<size_t>::max();
+    std::vector<size_t> channelOfRoot(nodesCount, noChannel);
+    std::vector<size_t> channelSize(nodesCount, 0);
+    for (size_t i = 0; i < nodesCount; i++)
+        channelSize[findRoot(i)]++;
+
+    for (size_t i = 0; i < nodesCount; i++)
+    {
+        size_t root = findRoot(i);
+        // Single node is equipotential already
+        if (channelSize[root] < 2)
+            continue;
+        if (channelOfRoot[root] == noChannel)
+        {
+            channelOfRoot[root] = m_channels.size();
+            m_channels.push_back(std::vector<ElectrostaticNodePayload*>());
+        }
+        m_channels[channelOfRoot[root]].push_back(
+            static_cast<ElectrostaticNodePayload*>(adjacency.nodes[i]->payload.get())
+        );
+    }
+}
+
+size_t EquipotentialSolver::findRoot(size_t i)
+{
+    while (m_parents[i] != i)
+    {
+        m_parents[i] = m_parents[m_parents[i]];
+        i = m_parents[i];
+    }
+    return i;
+}
+
+void EquipotentialSolver::solveChannel(const std::vector<ElectrostaticNodePayload*>& channel)
+{
+    size_t n = channel.size();
+    m_nodes.resize(n);
+    m_selfElastance.resize(n);
+
+    std::vector<double> q(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        m_nodes[i] = &channel[i]->coulombNode->node;
+        m_selfElastance[i] = Const::Si::k / channel[i]->nodeRadiusConductivity;
+        q[i] = channel[i]->charge.current;
+    }
+
+    const ParallelSettings& parallel = m_context.m_model->parallelSettings;
+    CoulombPotentialOperator elastance(
+        *m_context.optimizer, m_nodes, m_selfElastance, parallel, ParallelSettings::Phase::step
+    );
+
+    // Potential of external field and of charges outside of channel.
+    // Channel part is removed by the same engine, so for approximate engine like
+    // octree phiOther contains only difference of approximation errors
+    std::vector<double> Kq;
+    elastance(q, Kq);
+    std::vector<double> minusPhiOther(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        double coulomb = channel[i]->coulombNode->getFP().potential;
+        double external = (*m_context.externalPotential)(m_nodes[i]->pos);
+        double channelOthers = Kq[i] - m_selfElastance[i] * q[i];
+        minusPhiOther[i] = -(coulomb + external - channelOthers);
+    }
+
+    auto jacobi = [this](const std::vector<double>& r, std::vector<double>& z)
+    {
+        for (size_t i = 0; i < r.size(); i++)
+            z[i] = r[i] / m_selfElastance[i];
+    };
+
+    double tolerance = m_context.equipotentialTolerance;
+    size_t maxIterations = m_context.equipotentialMaxIterations;
+
+    std::vector<double> ones(n, 1.0), a(n), b(n);
+    // Isolated nodes approximation as initial guess
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = 1.0 / m_selfElastance[i];
+        b[i] = minusPhiOther[i] / m_selfElastance[i];
+    }
+
+    KrylovResult ra = conjugateGradient(elastance, jacobi, ones, a, tolerance, maxIterations);
+    KrylovResult rb = conjugateGradient(elastance, jacobi, minusPhiOther, b, tolerance, maxIterations);
+
+    m_stats.channels++;
+    m_stats.nodes += n;
+    m_stats.iterations += ra.iterations + rb.iterations;
+    if (!ra.converged || !rb.converged)
+    {
+        // Keep integrator result for this channel
+        m_stats.notConverged++;
+        return;
+    }
+
+    double totalCharge = 0.0, sumA = 0.0, sumB = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        totalCharge += q[i];
+        sumA += a[i];
+        sumB += b[i];
+    }
+    double potential = (totalCharge - sumB) / sumA;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        Variable& charge = channel[i]->charge;
+        double target = potential * a[i] + b[i];
+        charge.delta = target - charge.previous;
+        charge.current = target;
+    }
+}
@@ -8,6 +8,9 @@ double EulerExplicitIterator::iterate(double dt)
 	m_target->calculateRHS(m_time);
 	m_target->addRHSToDelta(dt);
 	m_target->step();
+	m_metrics.totalStepCalculations++;
+	m_metrics.timeIterations++;
+	m_metrics.complexity++;
 	m_time += dt;
 	return dt;
 }
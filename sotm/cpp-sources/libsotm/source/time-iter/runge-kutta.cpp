@@ -6,7 +6,8 @@
  */
 
 #include "sotm/time-iter/runge-kutta.hpp"
-#include <iostream>
+#include "sotm/utils/profiling.hpp"
+#include "sotm/utils/log.hpp"
 
 using namespace sotm;
 using namespace std;
@@ -35,7 +36,7 @@ double RungeKuttaIterator::iterate(double dt)
 		double iterationsCount = m_target->getMinimalStepsCount();
 		if (m_parameters->outputVerboseLevel >= ContiniousIteratorParameters::VerboseLevel::more)
 		{
-			cout << "[R-K4] Min steps count estimated as " << iterationsCount << endl;
+			SOTM_LOG(info) << "[R-K4] Min steps count estimated as " << iterationsCount;
 		}
 
 		if (iterationsCount == IContinuousTimeIterable::stepsCountNotMatter)
@@ -50,7 +51,7 @@ double RungeKuttaIterator::iterate(double dt)
             dt *= 0.6;
             if (m_parameters->outputVerboseLevel >= ContiniousIteratorParameters::VerboseLevel::more)
 			{
-            	cout << "[R-K4] Deacreasing step to " << dt << endl;
+            	SOTM_LOG(info) << "[R-K4] Deacreasing step to " << dt;
 			}
 			if (dt < m_stepMin)
 				dt = m_stepMin;
@@ -69,7 +70,7 @@ double RungeKuttaIterator::iterate(double dt)
 				dt = m_stepMax;
 			if (m_parameters->outputVerboseLevel >= ContiniousIteratorParameters::VerboseLevel::more)
 			{
-				cout << "[R-K4] Increasing step to " << dt << endl;
+				SOTM_LOG(info) << "[R-K4] Increasing step to " << dt;
 			}
 
 			// But we should not recompute this iteration, it is done with step precise then enough
@@ -81,40 +82,54 @@ double RungeKuttaIterator::iterate(double dt)
 
 	m_target->step();
 	m_metrics.timeIterations++;
-    //m_metrics.complexity +=
 	m_time += dt;
 	//cout << (int)m_parameters->outputVerboseLevel << endl;
 	if (m_parameters->outputVerboseLevel != ContiniousIteratorParameters::VerboseLevel::none)
 	{
-		cout << "[R-K4] Iteration done. t = " << m_time
+		SOTM_LOG(info) << "[R-K4] Iteration done. t = " << m_time
 				<< ", dt = " << dt
-				<< ", efficiency = " << m_metrics.adaptationEfficiency() << endl;
+				<< ", efficiency = " << m_metrics.adaptationEfficiency();
 	}
 	return dt;
 }
 
 void RungeKuttaIterator::makeSubiterations(double dt)
 {
+	// Complexity is measured in right hand side evaluations
+	m_metrics.complexity += 4;
+
 	// k1 = f(tn, xn)
-	m_target->calculateSecondaryValues(m_time);
-	m_target->calculateRHS(m_time);
-	m_target->addRHSToDelta(dt / 6.0);
+	{
+		SOTM_PROFILE_SCOPE(ProfilingPhase::rk4Stage1);
+		m_target->calculateSecondaryValues(m_time);
+		m_target->calculateRHS(m_time);
+		m_target->addRHSToDelta(dt / 6.0);
+	}
 
 	// k2 = f(tn + dt/2, xn + dt/2*k1)
-	m_target->makeSubIteration(dt / 2.0);
-	m_target->calculateSecondaryValues(m_time + dt / 2.0);
-	m_target->calculateRHS(m_time + dt / 2.0);
-	m_target->addRHSToDelta(dt / 3.0);
+	{
+		SOTM_PROFILE_SCOPE(ProfilingPhase::rk4Stage2);
+		m_target->makeSubIteration(dt / 2.0);
+		m_target->calculateSecondaryValues(m_time + dt / 2.0);
+		m_target->calculateRHS(m_time + dt / 2.0);
+		m_target->addRHSToDelta(dt / 3.0);
+	}
 
 	// k3 = f(tn + dt/2, xn + dt/2*k2)
-	m_target->makeSubIteration(dt / 2.0);
-	m_target->calculateSecondaryValues(m_time + dt / 2.0);
-	m_target->calculateRHS(m_time + dt / 2.0);
-	m_target->addRHSToDelta(dt / 3.0);
-
-	// k3 = f(tn + dt, xn + dt*k3)
-	m_target->makeSubIteration(dt);
-	m_target->calculateSecondaryValues(m_time + dt);
-	m_target->calculateRHS(m_time + dt);
-	m_target->addRHSToDelta(dt / 6.0);
+	{
+		SOTM_PROFILE_SCOPE(ProfilingPhase::rk4Stage3);
+		m_target->makeSubIteration(dt / 2.0);
+		m_target->calculateSecondaryValues(m_time + dt / 2.0);
+		m_target->calculateRHS(m_time + dt / 2.0);
+		m_target->addRHSToDelta(dt / 3.0);
+	}
+
+	// k4 = f(tn + dt, xn + dt*k3)
+	{
+		SOTM_PROFILE_SCOPE(ProfilingPhase::rk4Stage4);
+		m_target->makeSubIteration(dt);
+		m_target->calculateSecondaryValues(m_time + dt);
+		m_target->calculateRHS(m_time + dt);
+		m_target->addRHSToDelta(dt / 6.0);
+	}
 }
@@ -0,0 +1,267 @@
+#include "sotm/utils/log.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <set>
+#include <thread>
+
+using namespace sotm;
+
+namespace {
+
+const size_t threadBufferSize = 1 << 14;
+
+struct ThreadBuffer;
+
+struct LogState
+{
+    std::mutex outputMutex;
+    std::ostream* output = &std::cout;
+    std::ostream* errorOutput = &std::cerr;
+
+    std::atomic<size_t> rateLimit{20};
+    std::atomic<Log::Clock::rep> flushPeriod{
+        std::chrono::duration_cast<Log::Clock::duration>(std::chrono::milliseconds(500)).count()
+    };
+
+    std::mutex buffersMutex;
+    std::set<ThreadBuffer*> buffers;
+
+    std::once_flag flusherStarted;
+    std::mutex flusherMutex;
+    /// Notified when flush period is changed
+    std::condition_variable flusherCondition;
+};
+
+/// Never destroyed, because threads may log while static objects are destroyed
+LogState& state()
+{
+    static LogState* s = new LogState;
+    return *s;
+}
+
+struct ThreadBuffer
+{
+    ThreadBuffer()
+    {
+        data.reserve(threadBufferSize);
+        std::unique_lock<std::mutex> lock(state().buffersMutex);
+        state().buffers.insert(this);
+    }
+
+    ~ThreadBuffer()
+    {
+        {
+            std::unique_lock<std::mutex> lock(state().buffersMutex);
+            state().buffers.erase(this);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        flushLocked();
+    }
+
+    /// Buffer mutex should be locked
+    void flushLocked()
+    {
+        lastFlush = Log::Clock::now();
+        if (data.empty())
+            return;
+        LogState& s = state();
+        {
+            std::unique_lock<std::mutex> lock(s.outputMutex);
+            if (s.output)
+            {
+                s.output->write(data.data(), data.size());
+                s.output->flush();
+            }
+        }
+        data.clear();
+    }
+
+    /// Mutex is locked only by this thread and by Log::flush(), so it is almost never contended
+    std::mutex mutex;
+    std::string data;
+    Log::Clock::time_point lastFlush = Log::Clock::now();
+};
+
+ThreadBuffer& threadBuffer()
+{
+    static thread_local ThreadBuffer buffer;
+    return buffer;
+}
+
+/// Writes buffers of all threads every flush period. Thread is detached, state is never destroyed
+void flusherLoop()
+{
+    LogState& s = state();
+    std::unique_lock<std::mutex> lock(s.flusherMutex);
+    Log::Clock::time_point lastFlush = Log::Clock::now();
+    for (;;)
+    {
+        Log::Clock::duration period = Log::flushPeriod();
+        if (period <= Log::Clock::duration::zero())
+        {
+            // Every message is written immediately
+            s.flusherCondition.wait(lock);
+            continue;
+        }
+        Log::Clock::time_point deadline = lastFlush + period;
+        if (Log::Clock::now() < deadline)
+        {
+            // Period may be changed meanwhile, so deadline is checked again
+            s.flusherCondition.wait_until(lock, deadline);
+            continue;
+        }
+        lock.unlock();
+        Log::flush();
+        lock.lock();
+        lastFlush = Log::Clock::now();
+    }
+}
+
+void startFlusher()
+{
+    std::call_once(state().flusherStarted, []() { std::thread(flusherLoop).detach(); });
+}
+
+const char* prefix(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::warning: return "WARNING: ";
+    case LogLevel::error: return "ERROR: ";
+    default: return "";
+    }
+}
+
+}
+
+void Log::setLevel(LogLevel level)
+{
+    levelValue() = level;
+}
+
+LogLevel Log::level()
+{
+    return levelValue();
+}
+
+LogLevel& Log::levelValue()
+{
+    static LogLevel level = LogLevel::info;
+    return level;
+}
+
+void Log::setOutput(std::ostream* output)
+{
+    flush();
+    std::unique_lock<std::mutex> lock(state().outputMutex);
+    state().output = output;
+}
+
+void Log::setErrorOutput(std::ostream* output)
+{
+    std::unique_lock<std::mutex> lock(state().outputMutex);
+    state().errorOutput = output;
+}
+
+void Log::setRateLimit(size_t messagesPerSecond)
+{
+    state().rateLimit = messagesPerSecond;
+}
+
+size_t Log::rateLimit()
+{
+    return state().rateLimit;
+}
+
+void Log::setFlushPeriod(Clock::duration period)
+{
+    LogState& s = state();
+    {
+        std::unique_lock<std::mutex> lock(s.flusherMutex);
+        s.flushPeriod = period.count();
+    }
+    s.flusherCondition.notify_all();
+}
+
+Log::Clock::duration Log::flushPeriod()
+{
+    return Clock::duration(state().flushPeriod.load());
+}
+
+void Log::flush()
+{
+    LogState& s = state();
+    std::unique_lock<std::mutex> lock(s.buffersMutex);
+    for (auto &it : s.buffers)
+    {
+        std::unique_lock<std::mutex> bufferLock(it->mutex);
+        it->flushLocked();
+    }
+}
+
+void Log::write(LogLevel level, const std::string& message)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::unique_lock<std::mutex> bufferLock(buffer.mutex);
+
+    if (static_cast<int>(level) >= static_cast<int>(LogLevel::warning))
+    {
+        // Buffered messages are written first to keep order of this thread
+        buffer.flushLocked();
+        LogState& s = state();
+        std::unique_lock<std::mutex> lock(s.outputMutex);
+        if (s.errorOutput)
+            (*s.errorOutput) << prefix(level) << message << std::endl;
+        return;
+    }
+
+    startFlusher();
+    buffer.data += message;
+    buffer.data += '\n';
+    if (buffer.data.size() >= threadBufferSize || Clock::now() - buffer.lastFlush >= flushPeriod())
+        buffer.flushLocked();
+}
+
+bool LogRateLimiter::pass(size_t& suppressed)
+{
+    size_t limit = Log::rateLimit();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (limit != 0)
+    {
+        Log::Clock::time_point now = Log::Clock::now();
+        if (now - m_windowStart >= std::chrono::seconds(1))
+        {
+            m_windowStart = now;
+            m_passed = 0;
+        }
+        if (m_passed >= limit)
+        {
+            m_suppressed++;
+            return false;
+        }
+        m_passed++;
+    }
+    suppressed = m_suppressed;
+    m_suppressed = 0;
+    return true;
+}
+
+LogMessage::LogMessage(LogLevel level, LogRateLimiter& limiter) :
+    m_level(level),
+    m_pass(limiter.pass(m_suppressed))
+{
+    // Formatting is skipped by stream in failed state
+    if (!m_pass)
+        m_stream.setstate(std::ios::badbit);
+}
+
+LogMessage::~LogMessage()
+{
+    if (!m_pass)
+        return;
+    if (m_suppressed != 0)
+        m_stream << " (" << m_suppressed << " similar messages suppressed)";
+    Log::write(m_level, m_stream.str());
+}
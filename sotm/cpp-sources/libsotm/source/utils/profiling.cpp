@@ -0,0 +1,179 @@
+#include "sotm/utils/profiling.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using namespace sotm;
+
+namespace {
+
+// Every phase counters are on separate cache line to reduce false sharing between threads
+struct alignas(64) PhaseCounters
+{
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> totalNs{0};
+};
+
+PhaseCounters phaseCounters[static_cast<size_t>(ProfilingPhase::count)];
+
+struct TraceEvent
+{
+    ProfilingPhase phase;
+    unsigned int thread;
+    int64_t beginNs;
+    int64_t durationNs;
+};
+
+std::atomic<bool> traceEnabled{false};
+std::mutex traceMutex;
+std::vector<TraceEvent> traceEvents;
+size_t traceMaxEvents = 0;
+
+const Profiler::Clock::time_point profilerEpoch = Profiler::Clock::now();
+
+unsigned int threadIndex()
+{
+    static std::atomic<unsigned int> next{0};
+    thread_local unsigned int index = next++;
+    return index;
+}
+
+const char* phaseNames[] = {
+    "rebuildOptimization",
+    "fieldEvaluation",
+    "calculateRHS",
+    "rk4Stage1",
+    "rk4Stage2",
+    "rk4Stage3",
+    "rk4Stage4",
+    "prepareBifurcation",
+    "doBifurcation",
+    "graphCommit",
+    "outputHooks",
+    "equipotentialSolve"
+};
+
+static_assert(ARRAY_SIZE(phaseNames) == static_cast<size_t>(ProfilingPhase::count), "Every profiling phase should have a name");
+
+}
+
+bool Profiler::compiledIn()
+{
+#ifdef SOTM_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* Profiler::phaseName(ProfilingPhase phase)
+{
+    return phaseNames[static_cast<size_t>(phase)];
+}
+
+void Profiler::add(ProfilingPhase phase, Clock::time_point begin, Clock::time_point end)
+{
+    int64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    PhaseCounters& counters = phaseCounters[static_cast<size_t>(phase)];
+    counters.calls.fetch_add(1, std::memory_order_relaxed);
+    counters.totalNs.fetch_add(duration, std::memory_order_relaxed);
+
+    if (phase == ProfilingPhase::fieldEvaluation || !traceEnabled.load(std::memory_order_relaxed))
+        return;
+
+    TraceEvent event;
+    event.phase = phase;
+    event.thread = threadIndex();
+    event.beginNs = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - profilerEpoch).count();
+    event.durationNs = duration;
+
+    std::unique_lock<std::mutex> lock(traceMutex);
+    if (traceEvents.size() < traceMaxEvents)
+        traceEvents.push_back(event);
+}
+
+ProfilingSnapshot Profiler::snapshot()
+{
+    ProfilingSnapshot result;
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        result[i].calls = phaseCounters[i].calls.load(std::memory_order_relaxed);
+        result[i].totalNs = phaseCounters[i].totalNs.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void Profiler::reset()
+{
+    for (auto &it : phaseCounters)
+    {
+        it.calls.store(0, std::memory_order_relaxed);
+        it.totalNs.store(0, std::memory_order_relaxed);
+    }
+    std::unique_lock<std::mutex> lock(traceMutex);
+    traceEvents.clear();
+}
+
+std::string Profiler::summary(const ProfilingSnapshot* previous)
+{
+    if (!compiledIn())
+        return "[Profiling] disabled, rebuild with SOTM_PROFILING=ON";
+
+    ProfilingSnapshot current = snapshot();
+    std::ostringstream oss;
+    oss << "[Profiling]";
+    bool first = true;
+    for (size_t i = 0; i < current.size(); i++)
+    {
+        ProfilingPhaseStats s = current[i];
+        if (previous)
+        {
+            s.calls -= (*previous)[i].calls;
+            s.totalNs -= (*previous)[i].totalNs;
+        }
+        if (s.calls == 0)
+            continue;
+        oss << (first ? " " : "; ") << phaseNames[i] << ": " << s.calls << " calls, " << s.totalSeconds() << " s";
+        first = false;
+    }
+    return oss.str();
+}
+
+void Profiler::startTrace(size_t maxEvents)
+{
+    std::unique_lock<std::mutex> lock(traceMutex);
+    traceMaxEvents = maxEvents;
+    traceEvents.reserve(std::min<size_t>(maxEvents, 100000));
+    traceEnabled = true;
+}
+
+void Profiler::stopTrace()
+{
+    traceEnabled = false;
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename)
+{
+    std::ofstream output(filename.c_str(), std::ios::out);
+    if (!output.is_open())
+        return false;
+
+    std::unique_lock<std::mutex> lock(traceMutex);
+    output << "{\"traceEvents\":[" << std::endl;
+    for (size_t i = 0; i < traceEvents.size(); i++)
+    {
+        const TraceEvent& e = traceEvents[i];
+        // Chrome trace uses microseconds
+        output << "{\"name\":\"" << phaseNames[static_cast<size_t>(e.phase)] << "\""
+               << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+               << ",\"ts\":" << e.beginNs / 1000.0
+               << ",\"dur\":" << e.durationNs / 1000.0 << "}"
+               << (i + 1 < traceEvents.size() ? "," : "") << std::endl;
+    }
+    output << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+    return true;
+}
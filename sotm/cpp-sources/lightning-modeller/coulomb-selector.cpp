@@ -1,4 +1,5 @@
 #include "coulomb-selector.hpp"
+#include "sotm/utils/log.hpp"
 #include <boost/algorithm/string.hpp>
 #include <string>
 #include <algorithm>
@@ -15,31 +16,51 @@ CoulombSelector::CoulombSelector(cic::Parameters& p)
 
 void CoulombSelector::addCoulombCalculator(ElectrostaticPhysicalContext& c)
 {
-    if (m_pg.get<std::string>("method") != "bruteforce" && m_pg.get<std::string>("method") != "octree")
+    if (m_pg.get<std::string>("method") != "bruteforce"
+            && m_pg.get<std::string>("method") != "octree"
+            && m_pg.get<std::string>("method") != "distributed")
         throw std::runtime_error(std::string("Unknown coulomb field calculation method \"") + m_pg.get<std::string>("method") + "\" in option method");
 
     if (m_pg.get<std::string>("compare-with") != "bruteforce"
             && m_pg.get<std::string>("compare-with") != "octree"
             && m_pg.get<std::string>("compare-with") != "none"
             && m_pg.get<std::string>("compare-with") != "")
-        throw std::runtime_error(std::string("Unknown coulomb field calculation method \"") + m_pg.get<std::string>("method") + "\" in option compare-with");
+        throw std::runtime_error(std::string("Unknown coulomb field calculation method \"") + m_pg.get<std::string>("compare-with") + "\" in option compare-with");
 
-    std::unique_ptr<IColoumbCalculator> first = produce(c, m_pg.get<std::string>("method")),
-        second = produce(c, m_pg.get<std::string>("compare-with"));
+    std::string precision = m_pg.get<std::string>("precision");
+    if (precision != "double" && precision != "mixed")
+        throw std::runtime_error(std::string("Unknown precision \"") + precision + "\" in option precision");
+    if (precision == "mixed" && m_pg.get<std::string>("method") != "bruteforce")
+        throw std::runtime_error("Mixed precision is supported by method \"bruteforce\" only");
+
+    double compareFraction = m_pg.get<double>("compare-fraction");
+    if (compareFraction < 0.0 || compareFraction > 1.0)
+        throw std::runtime_error(std::string("Option compare-fraction should be in [0, 1], but it is ") + std::to_string(compareFraction));
+
+    // Default method is compared with double precision one, so accuracy of mixed precision may be checked
+    std::unique_ptr<IColoumbCalculator> first = produce(c, m_pg.get<std::string>("method"), precision == "mixed"),
+        second = produce(c, m_pg.get<std::string>("compare-with"), false);
 
     if (second == nullptr)
     {
         c.optimizer = std::move(first);
     } else {
-        c.optimizer.reset(
-            new CoulombComarator(
-                std::move(first),
-                std::move(second)
-            )
+        m_comparator = new CoulombComarator(
+            std::move(first),
+            std::move(second),
+            compareFraction
         );
+        c.optimizer.reset(m_comparator);
     }
 }
 
+void CoulombSelector::reportComparison(std::ostream& os) const
+{
+    if (m_comparator == nullptr)
+        return;
+    m_comparator->stats().report(os);
+}
+
 void CoulombSelector::parseScales(octree::DiscreteScales& target, const std::string& source)
 {
     std::string processed = source;
@@ -73,17 +94,17 @@ std::unique_ptr<const octree::IScalesConfig> CoulombSelector::generateScales()
     boost::split(substrs, scalesConfig, boost::is_any_of(":"));
     if (substrs.size() == 1)
     {
-        std::cout << "Crating discrete" << std::endl;
+        SOTM_LOG(info) << "Creating discrete octree scales";
         result.reset(new octree::DiscreteScales());
         parseScales(static_cast<octree::DiscreteScales&>(*result), substrs[0]);
     } else if (substrs.size() == 2 && substrs[0] == "discrete")
     {
-        std::cout << "Crating discrete" << std::endl;
+        SOTM_LOG(info) << "Creating discrete octree scales";
         result.reset(new octree::DiscreteScales());
         parseScales(static_cast<octree::DiscreteScales&>(*result), substrs[1]);
     } else if (substrs.size() == 2 && substrs[0] == "linear")
     {
-        std::cout << "Crating linear" << std::endl;
+        SOTM_LOG(info) << "Creating linear octree scales";
         result.reset(new octree::LinearScales(stod(substrs[1])));
     } else {
         throw std::runtime_error(std::string("Scales string format os bad: ") + m_pg.get<std::string>("octree-scales"));
@@ -91,19 +112,59 @@ std::unique_ptr<const octree::IScalesConfig> CoulombSelector::generateScales()
     return std::unique_ptr<const octree::IScalesConfig>(std::move(result)); // Making const unique_ptr
 }
 
-std::unique_ptr<IColoumbCalculator> CoulombSelector::produce(ElectrostaticPhysicalContext& c, const std::string& method)
+std::unique_ptr<IColoumbCalculator> CoulombSelector::produce(ElectrostaticPhysicalContext& c, const std::string& method, bool mixed)
 {
     std::unique_ptr<IColoumbCalculator> result;
 
     if (method == "bruteforce")
     {
-        cout << "Creating brute force coulomb field calculator" << endl;
-        result.reset(new CoulombBruteForce(c.model().graphRegister));
+        SOTM_LOG(info) << "Creating brute force coulomb field calculator" << (mixed ? " with mixed precision" : "");
+        if (mixed)
+            result.reset(new CoulombBruteForceMixed(c.model().graphRegister));
+        else
+            result.reset(new CoulombBruteForce(c.model().graphRegister));
     } else if (method == "octree")
     {
-        cout << "Creating octree-based optimization for coulomb field calculator" << endl;
+        SOTM_LOG(info) << "Creating octree-based optimization for coulomb field calculator";
 
-        result.reset(new CoulombOctree(c.model().graphRegister, generateScales()));
+        std::string scalesConfig = m_pg.get<std::string>("octree-scales");
+        scalesConfig.erase(std::remove_if(scalesConfig.begin(), scalesConfig.end(), ::isspace), scalesConfig.end());
+        if (scalesConfig == "auto")
+        {
+            OctreeAutoTuning tuning;
+            tuning.maxRelativeError = m_pg.get<double>("octree-auto-error");
+            tuning.samples = m_pg.get<size_t>("octree-auto-samples");
+            if (tuning.maxRelativeError <= 0.0)
+                throw std::runtime_error("Option octree-auto-error should be positive");
+            std::vector<std::string> discrete;
+            std::string discreteConfig = m_pg.get<std::string>("octree-auto-discrete");
+            boost::split(discrete, discreteConfig, boost::is_any_of("|"));
+            for (auto &it : discrete)
+            {
+                if (std::all_of(it.begin(), it.end(), ::isspace))
+                    continue;
+                std::shared_ptr<octree::DiscreteScales> scales = std::make_shared<octree::DiscreteScales>();
+                parseScales(*scales, it);
+                tuning.discreteCandidates.push_back(scales);
+            }
+            result.reset(new CoulombOctree(c.model().graphRegister, tuning));
+        } else {
+            result.reset(new CoulombOctree(c.model().graphRegister, generateScales()));
+        }
+    } else if (method == "distributed")
+    {
+#ifdef SOTM_MPI
+        SOTM_LOG(info) << "Creating MPI domain decomposed coulomb field calculator, graph is kept on rank 0";
+        DistributedCoulombParameters parameters;
+        parameters.cellSize = m_pg.get<double>("distributed-cell-size");
+        parameters.theta = m_pg.get<double>("distributed-theta");
+        parameters.parallel = c.model().parallelSettings.parallelContiniousIteration.calculateSecondaryValues;
+        if (parameters.cellSize <= 0.0 || parameters.theta <= 0.0)
+            throw std::runtime_error("Options distributed-cell-size and distributed-theta should be positive");
+        result.reset(new CoulombDistributed(c.model().graphRegister, MPI_COMM_WORLD, parameters));
+#else
+        throw std::runtime_error("Method \"distributed\" needs libsotm built with SOTM_MPI");
+#endif
     }
     return result;
 }
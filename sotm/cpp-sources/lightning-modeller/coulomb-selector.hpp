@@ -5,8 +5,12 @@
 #include "sotm/optimizers/coulomb-brute-force.hpp"
 #include "sotm/payloads/electrostatics/electrostatics.hpp"
 #include "sotm/optimizers/coulomb.hpp"
+#ifdef SOTM_MPI
+    #include "sotm/optimizers/coulomb-distributed.hpp"
+#endif
 
 #include "cic.hpp"
+#include <ostream>
 #include <string>
 
 class CoulombSelector
@@ -18,19 +22,32 @@ public:
 
     static void parseScales(octree::DiscreteScales& target, const std::string& source);
 
+    /// Print accuracy statistics if compare-with is enabled
+    void reportComparison(std::ostream& os) const;
+
 private:
 
     std::unique_ptr<const octree::IScalesConfig> generateScales();
 
-    std::unique_ptr<sotm::IColoumbCalculator> produce(sotm::ElectrostaticPhysicalContext& c, const std::string& method);
+    /// @param mixed Float storage and kernel with double accumulation, brute force only
+    std::unique_ptr<sotm::IColoumbCalculator> produce(sotm::ElectrostaticPhysicalContext& c, const std::string& method, bool mixed);
 
     cic::ParametersGroup m_pg{
         "Coulomb",
         "Coulomb calculation optimization options",
-        cic::Parameter<std::string>("method",        "Method used by default: bruteforce, octree", "bruteforce"),
-        cic::Parameter<std::string>("compare-with",  "Method used to be compared with default: none, bruteforce, octree", "none"),
-        cic::Parameter<std::string>("octree-scales", "Scales for octree method. Format: \"(1.0, 1.0); (3.0, 4.0); (100.0, 200.0)\"", "")
+        cic::Parameter<std::string>("method",        "Method used by default: bruteforce, octree, distributed (MPI build only, distributes field evaluation, model stays on rank 0)", "bruteforce"),
+        cic::Parameter<std::string>("precision",     "Precision of default method: double, or mixed for float storage and kernel with double accumulation (bruteforce only)", "double"),
+        cic::Parameter<std::string>("compare-with",  "Method used to be compared with default: none, bruteforce, octree. It is always in double precision", "none"),
+        cic::Parameter<double>("compare-fraction",   "Fraction of field evaluations compared when compare-with is set, from 0.0 to 1.0", 0.01),
+        cic::Parameter<std::string>("octree-scales", "Scales for octree method. Format: \"(1.0, 1.0); (3.0, 4.0); (100.0, 200.0)\", \"linear:0.1\" or \"auto\"", ""),
+        cic::Parameter<double>("octree-auto-error",  "Relative error bound for octree-scales=auto", 0.01),
+        cic::Parameter<size_t>("octree-auto-samples", "Count of points where exact field is calculated for octree-scales=auto", 64),
+        cic::Parameter<std::string>("octree-auto-discrete", "Discrete scales candidates for octree-scales=auto in octree-scales format separated by \"|\"", ""),
+        cic::Parameter<double>("distributed-cell-size", "Cell size for multipole summaries of distributed method", 1.0),
+        cic::Parameter<double>("distributed-theta",  "Cell is calculated by multipole summary if its radius is less than theta * distance, for distributed method", 0.2)
     };
+
+    sotm::CoulombComarator* m_comparator = nullptr;
 };
 
 #endif // COULOMBSELECTOR_HPP
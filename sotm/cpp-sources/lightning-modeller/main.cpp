@@ -1,14 +1,49 @@
 #include "modeller.hpp"
 
+#ifdef SOTM_MPI
+    #include "sotm/optimizers/coulomb-distributed.hpp"
+    #include <mpi.h>
+#endif
+
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
 using namespace sotm;
 
 int main(int argc, char** argv)
 {
-	Modeller m;
-	if (m.parseCmdLineArgs(argc, argv))
-		m.run();
-	return 0;
+#ifdef SOTM_MPI
+	MPI_Init(&argc, &argv);
+	int rank = 0;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if (rank != 0)
+	{
+		// Only rank 0 runs the model and keeps the whole graph,
+		// other ranks only calculate field for method=distributed
+		CoulombDistributed::runWorker();
+		MPI_Finalize();
+		return 0;
+	}
+#endif
+
+	int result = 0;
+	{
+#ifdef SOTM_MPI
+		CoulombDistributed::WorkersStopper workersStopper;
+#endif
+		try {
+			Modeller m;
+			if (m.parseCmdLineArgs(argc, argv))
+				m.run();
+		} catch (std::exception &ex) {
+			cerr << "Modelling failed: " << ex.what() << endl;
+			result = 1;
+		}
+	}
+
+#ifdef SOTM_MPI
+	MPI_Finalize();
+#endif
+	return result;
 }
@@ -6,6 +6,7 @@
 #include "sotm/math/random.hpp"
 #include "sotm/utils/const.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <cmath>
@@ -49,6 +50,8 @@ void Modeller::run()
 {
 	Random::randomize(0);
 
+    initLog();
+
     c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new ElectrostaticPhysicalContext()));
     m_physCont = static_cast<ElectrostaticPhysicalContext*>(c.physicalContext());
 
@@ -65,6 +68,7 @@ void Modeller::run()
         c.parallelSettings.parallelContiniousIteration.makeSubIteration = true;
         c.parallelSettings.parallelContiniousIteration.step = true;
         c.parallelSettings.parallelBifurcationIteration.prepareBifurcation = true;
+        initParallelSettings();
     }
 
 	initTimeIterator();
@@ -74,6 +78,9 @@ void Modeller::run()
 
 	std::string filenamePrefix = std::string("lightmod_") + getTimeStr();
 	initFileOutput(filenamePrefix);
+	initRendering(filenamePrefix);
+	initProfiling();
+	initMetrics();
 	createParametersFile(filenamePrefix);
 	createProgramCofigurationFile(filenamePrefix);
 
@@ -94,9 +101,78 @@ void Modeller::run()
 		m_timeIter->run();
 	}
 
-	cout << "Destroying graph" << endl;
+	if (m_renderHook)
+	{
+		m_renderHook->finish();
+		SOTM_LOG(info) << "Frames rendered: " << m_renderHook->framesWritten() << ", dropped: " << m_renderHook->framesDropped();
+	}
+	if (m_metrics)
+	{
+		m_metrics->publish();
+		m_metrics->stop();
+	}
+	finishProfiling();
+	Log::flush();
+	m_coulombSelector.reportComparison(cout);
+
+	SOTM_LOG(info) << "Destroying graph";
     c.destroyAll();
-	cout << "Exiting" << endl;
+	SOTM_LOG(info) << "Exiting";
+	Log::flush();
+}
+
+void Modeller::initLog()
+{
+	std::string level = m_p["General"].get<std::string>("log-level");
+	if (level == "trace")
+		Log::setLevel(LogLevel::trace);
+	else if (level == "debug")
+		Log::setLevel(LogLevel::debug);
+	else if (level == "info")
+		Log::setLevel(LogLevel::info);
+	else if (level == "warning")
+		Log::setLevel(LogLevel::warning);
+	else if (level == "error")
+		Log::setLevel(LogLevel::error);
+	else if (level == "none")
+		Log::setLevel(LogLevel::none);
+	else
+		throw std::runtime_error("Invalid log level: " + level);
+
+	Log::setRateLimit(m_p["General"].get<size_t>("log-rate"));
+}
+
+void Modeller::initParallelSettings()
+{
+	typedef ParallelSettings::Phase Phase;
+	ParallelSettings& ps = c.parallelSettings;
+	cic::ParametersGroup& pg = m_p["Parallel"];
+
+	ps.threadsCount = pg.get<size_t>("threads");
+	ps.isolateArena = pg.get<bool>("isolate-arena");
+	ps.numaAware = pg.get<bool>("numa");
+	ps.pinThreads = pg.get<bool>("pin-threads");
+	ps.serialThreshold = pg.get<size_t>("serial-below");
+
+	std::string partitioner = pg.get<std::string>("partitioner");
+	if (partitioner == "auto")
+		ps.partitioner = ParallelSettings::Partitioner::automatic;
+	else if (partitioner == "simple")
+		ps.partitioner = ParallelSettings::Partitioner::simple;
+	else if (partitioner == "affinity")
+		ps.partitioner = ParallelSettings::Partitioner::affinity;
+	else if (partitioner == "static")
+		ps.partitioner = ParallelSettings::Partitioner::statics;
+	else
+		throw std::runtime_error("Invalid partitioner: " + partitioner);
+
+	ps.grainSize[size_t(Phase::calculateSecondaryValues)] = std::max<size_t>(1, pg.get<size_t>("grain-secondary"));
+	ps.grainSize[size_t(Phase::calculateRHS)] = std::max<size_t>(1, pg.get<size_t>("grain-rhs"));
+	ps.grainSize[size_t(Phase::addRHSToDelta)] = std::max<size_t>(1, pg.get<size_t>("grain-delta"));
+	ps.grainSize[size_t(Phase::makeSubIteration)] = std::max<size_t>(1, pg.get<size_t>("grain-subiteration"));
+	ps.grainSize[size_t(Phase::step)] = std::max<size_t>(1, pg.get<size_t>("grain-step"));
+	ps.grainSize[size_t(Phase::prepareBifurcation)] = std::max<size_t>(1, pg.get<size_t>("grain-bifurcation"));
+	ps.reconfigure();
 }
 
 void Modeller::initFileOutput(const std::string& prefix)
@@ -110,13 +186,97 @@ void Modeller::initFileOutput(const std::string& prefix)
 	m_timeIter->addHook(m_fileWriteHook.get());
 }
 
+void Modeller::initRendering(const std::string& prefix)
+{
+	double period = m_p["General"].get<double>("render-period");
+	if (period == 0.0)
+		return;
+
+	RenderPreferences preferences;
+	preferences.lineWidth = true;
+	m_renderHook.reset(new RenderHook(&c, preferences, period));
+	m_renderHook->setFilenamePrefix(prefix + "_frame");
+	m_renderHook->setImageSize(
+		int(m_p["General"].get<unsigned int>("render-width")),
+		int(m_p["General"].get<unsigned int>("render-height"))
+	);
+	m_renderHook->setDropFrames(m_p["General"].get<bool>("render-drop-frames"));
+	m_timeIter->addHook(m_renderHook.get());
+}
+
+void Modeller::initProfiling()
+{
+	double period = m_p["General"].get<double>("profile-period");
+	std::string trace = m_p["General"].get<std::string>("profile-trace");
+	if (period == 0.0 && trace.empty())
+		return;
+
+	if (!Profiler::compiledIn())
+	{
+		SOTM_LOG(warning) << "Profiling options are ignored: libsotm was built without SOTM_PROFILING";
+		return;
+	}
+
+	if (period != 0.0)
+	{
+		m_profilingHook.reset(new ProfilingSummaryHook(period));
+		m_timeIter->addHook(m_profilingHook.get());
+	}
+
+	if (!trace.empty())
+		Profiler::startTrace();
+}
+
+void Modeller::initMetrics()
+{
+	cic::ParametersGroup& pg = m_p["Metrics"];
+	double period = pg.get<double>("metrics-period");
+	if (period == 0.0)
+		return;
+
+	m_metrics.reset(new MetricsPublisher(&c, m_timeIter.get(), period));
+	if (!pg.get<bool>("metrics-quiet"))
+		m_metrics->setLogSummary(true);
+
+	std::string file = pg.get<std::string>("metrics-file");
+	if (!file.empty())
+		m_metrics->setFile(file, pg.get<size_t>("metrics-file-size"), pg.get<size_t>("metrics-file-keep"));
+
+	std::string socket = pg.get<std::string>("metrics-socket");
+	if (!socket.empty())
+		m_metrics->listenUnixSocket(socket);
+
+	unsigned int port = pg.get<unsigned int>("metrics-http-port");
+	if (port != 0)
+		m_metrics->listenHttp(int(port));
+
+	m_timeIter->addHook(m_metrics.get());
+}
+
+void Modeller::finishProfiling()
+{
+	if (!Profiler::compiledIn())
+		return;
+
+	if (m_profilingHook)
+		SOTM_LOG(info) << "Total: " << Profiler::summary();
+
+	std::string trace = m_p["General"].get<std::string>("profile-trace");
+	if (!trace.empty())
+	{
+		Profiler::stopTrace();
+		if (!Profiler::writeChromeTrace(trace))
+			SOTM_LOG(error) << "Cannot write profiling trace to " << trace;
+	}
+}
+
 void Modeller::createParametersFile(const std::string& prefix)
 {
 	std::string filename = prefix + "_parameters.txt";
 	ofstream outputFile(filename.c_str(), std::ios::out);
 	if (!outputFile.is_open())
 	{
-		cerr << "ERROR: Cannot open file " << filename << " to write current parameters!" << endl;
+		SOTM_LOG(error) << "Cannot open file " << filename << " to write current parameters!";
 		return;
 	}
     m_p.writeIni(outputFile);
@@ -128,7 +288,7 @@ void Modeller::createProgramCofigurationFile(const std::string& prefix)
 	ofstream outputFile(name.c_str(), ios::out);
 	if (!outputFile.is_open())
 	{
-		cerr << "ERROR: Cannot save config file " << name << endl;
+		SOTM_LOG(error) << "Cannot save config file " << name;
 	}
 	outputFile << "git_commit = " << Config::Build::commitTag << endl;
 	outputFile << "build = " << Config::Build::build << endl;
@@ -137,18 +297,14 @@ void Modeller::createProgramCofigurationFile(const std::string& prefix)
 
 void Modeller::initExternalPotential()
 {
-	m_trapezoid.reset(
-	    new TrapezoidFunc(
-	        - m_p["Field"].get<double>("field"),
-	        m_p["Field"].get<double>("field-z-size"),
-	        m_p["Field"].get<double>("field-z-recession")
-	    )
+	TrapezoidFunc trapezoid(
+		- m_p["Field"].get<double>("field"),
+		m_p["Field"].get<double>("field-z-size"),
+		m_p["Field"].get<double>("field-z-recession")
 	);
+	// Static field is used to inline trapezoid function into value and gradient calculation
 	m_externalPotential.reset(
-		new FieldScalar1D<3>(
-			[this](double z) { return (*m_trapezoid)(z); },
-			{0.0, 0.0, 1.0}
-		)
+		makeStaticFieldAdapter(StaticProjectedField<TrapezoidFunc, 3>(trapezoid, {0.0, 0.0, 1.0}))
 	);
 }
 
@@ -188,6 +344,9 @@ void Modeller::initParameters()
 	m_physCont->conductivityLimit = m_p["Discharge"].get<double>("cond-limit");
 	m_physCont->ionizationOverheatingInstFunc = SmoothedLocalStepFunction(m_p["Discharge"].get<double>("ioi-temp"), 50);
 
+	m_physCont->equipotentialChannels = m_p["Discharge"].get<bool>("equipotential-channels");
+	m_physCont->equipotentialConductivityFraction = m_p["Discharge"].get<double>("equipotential-cond-fraction");
+
 	StaticVector<3> externalField{0.0, 0.0, m_p["Field"].get<double>("field")};
 	m_physCont->externalPotential = m_externalPotential.get();
 
@@ -205,7 +364,9 @@ void Modeller::initTimeIterator()
 	m_rkIterator.reset(new RungeKuttaIterator());
 	m_rkIterator->setParameters(&m_timeIterParams);
 	m_timeIter.reset(new TimeIterator(&c, m_rkIterator.get(), &c));
-	m_timeIter->continiousIterParameters().outputVerboseLevel = ContiniousIteratorParameters::VerboseLevel::more;
+	// Per step output is off by default, progress goes to metrics publisher
+	unsigned int verbose = std::min(m_p["Iter"].get<unsigned int>("verbose"), 2u);
+	m_timeIter->continiousIterParameters().outputVerboseLevel = ContiniousIteratorParameters::VerboseLevel(verbose);
 }
 
 void Modeller::generateCondEvoParams()
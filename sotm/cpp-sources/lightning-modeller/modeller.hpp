@@ -18,7 +18,12 @@
 #include "sotm/time-iter/runge-kutta.hpp"
 #include "sotm/math/random.hpp"
 #include "sotm/output/graph-file-writer.hpp"
+#include "sotm/output/render-hook.hpp"
+#include "sotm/output/profiling-summary.hpp"
+#include "sotm/output/metrics-publisher.hpp"
 #include "sotm/math/functions.hpp"
+#include "sotm/math/field-static.hpp"
+#include "sotm/utils/log.hpp"
 #include "cic.hpp"
 
 #include <boost/program_options.hpp>
@@ -33,12 +38,18 @@ public:
 
 private:
 	void initFileOutput(const std::string& prefix);
+	void initRendering(const std::string& prefix);
+	void initLog();
+	void initProfiling();
+	void initMetrics();
+	void finishProfiling();
 	void createParametersFile(const std::string& prefix);
 	void createProgramCofigurationFile(const std::string& prefix);
 	void initExternalPotential();
 	void initScalersAndColors();
 	void initParameters();
 	void initTimeIterator();
+	void initParallelSettings();
 	void generateCondEvoParams();
     void initSeeds();
 
@@ -48,9 +59,11 @@ private:
 	sotm::ElectrostaticPhysicalContext* m_physCont;
 	std::unique_ptr<sotm::TimeIterator> m_timeIter;
 	std::unique_ptr<sotm::FileWriteHook> m_fileWriteHook;
+	std::unique_ptr<sotm::RenderHook> m_renderHook;
+	std::unique_ptr<sotm::ProfilingSummaryHook> m_profilingHook;
+	std::unique_ptr<sotm::MetricsPublisher> m_metrics;
 	std::unique_ptr<sotm::RungeKuttaIterator> m_rkIterator;
 	std::unique_ptr<sotm::Field<1, 3>> m_externalPotential;
-	std::unique_ptr<sotm::TrapezoidFunc> m_trapezoid;
 
 	sotm::ContiniousIteratorParameters m_timeIterParams;
 
@@ -62,7 +75,31 @@ private:
 		    "General options",
             cic::Parameter<bool>("no-gui", "Work without GUI", cic::ParamterType::cmdLine),
             cic::Parameter<bool>("benchmark", "Do not output data", cic::ParamterType::cmdLine),
-            cic::Parameter<bool>("no-threads", "Run in signle thread", cic::ParamterType::cmdLine)
+            cic::Parameter<bool>("no-threads", "Run in signle thread", cic::ParamterType::cmdLine),
+            cic::Parameter<std::string>("log-level", "Minimal level of log messages: trace, debug, info, warning, error, none. Debug and trace are compiled in for debug build only", "info"),
+            cic::Parameter<size_t>("log-rate", "Maximal messages per second from one place of code. 0 for no limit", 20),
+            cic::Parameter<double>("profile-period", "Model time between profiling summary lines. 0 to disable. Library should be built with SOTM_PROFILING", 0.0),
+            cic::Parameter<std::string>("profile-trace", "Write Chrome trace JSON with profiling events to this file. Empty to disable", ""),
+            cic::Parameter<double>("render-period", "Model time between PNG frames rendered off-screen. 0 to disable", 0.0),
+            cic::Parameter<unsigned int>("render-width", "Width of rendered frames", 1280),
+            cic::Parameter<unsigned int>("render-height", "Height of rendered frames", 720),
+            cic::Parameter<bool>("render-drop-frames", "Skip frame if previous one is not rendered yet instead of waiting for it")
+		),
+		cic::ParametersGroup(
+		    "Parallel",
+		    "Multithreading options, ignored with no-threads",
+		    cic::Parameter<size_t>("threads",             "Maximal threads count, 0 for all cores", 0),
+		    cic::Parameter<bool>("isolate-arena",         "Run model loops in own tbb task arena"),
+		    cic::Parameter<bool>("numa",                  "Split loops statically between NUMA nodes and run every part on its node"),
+		    cic::Parameter<bool>("pin-threads",           "Pin every thread to single CPU, with numa only"),
+		    cic::Parameter<std::string>("partitioner",    "tbb partitioner for model loops: auto, simple, affinity, static", "auto"),
+		    cic::Parameter<size_t>("serial-below",        "Loops over less elements than this run in single thread", 256),
+		    cic::Parameter<size_t>("grain-secondary",     "Grain size for secondary values calculation", 1),
+		    cic::Parameter<size_t>("grain-rhs",           "Grain size for right hand side calculation", 1),
+		    cic::Parameter<size_t>("grain-delta",         "Grain size for adding right hand side to delta", 16),
+		    cic::Parameter<size_t>("grain-subiteration",  "Grain size for subiterations", 16),
+		    cic::Parameter<size_t>("grain-step",          "Grain size for step", 16),
+		    cic::Parameter<size_t>("grain-bifurcation",   "Grain size for bifurcation preparation", 1)
 		),
 		cic::ParametersGroup(
 		    "Iter",
@@ -70,7 +107,19 @@ private:
 		    cic::Parameter<double>("step-min",       "Minimal integration step", 0.0),
 		    cic::Parameter<double>("step-max",       "Maximal integration step", 1e-7),
 		    cic::Parameter<double>("frame-duration", "File output frame duration", 1e-6),
-		    cic::Parameter<double>("stop-time",      "Integration time limit", 1.0)
+		    cic::Parameter<double>("stop-time",      "Integration time limit", 1.0),
+		    cic::Parameter<unsigned int>("verbose",  "Integrator output: 0 - none, 1 - step changes, 2 - every step", 0)
+		),
+		cic::ParametersGroup(
+		    "Metrics",
+		    "Progress metrics published at fixed wall clock rate",
+		    cic::Parameter<double>("metrics-period",       "Wall clock seconds between samples. 0 to disable", 1.0),
+		    cic::Parameter<bool>("metrics-quiet",          "Do not print samples to stdout"),
+		    cic::Parameter<std::string>("metrics-file",    "Append samples as JSON lines to this file. Empty to disable", ""),
+		    cic::Parameter<size_t>("metrics-file-size",    "Rotate metrics file when it is larger, bytes. 0 to disable rotation", 64 << 20),
+		    cic::Parameter<size_t>("metrics-file-keep",    "Count of rotated metrics files to keep", 3),
+		    cic::Parameter<std::string>("metrics-socket",  "Serve latest sample on this Unix socket. Empty to disable", ""),
+		    cic::Parameter<unsigned int>("metrics-http-port", "Serve latest sample over HTTP on 127.0.0.1. 0 to disable", 0)
 		),
 		cic::ParametersGroup(
 		    "Discharge",
@@ -80,7 +129,9 @@ private:
 		    cic::Parameter<double>("cond-limit",          "Conductivity limit", 1e1),
             cic::Parameter<double>("field-cond-critical", "Critical field that maintain glow discharge. Beta calculated by this value. Minimal conductivity is 95% of it", 0.24e6),
             cic::Parameter<double>("field-connect-critical", "Critical average field for nodes connection", 0.3e6),
-            cic::Parameter<double>("conductivity-initial", "Initial link conductivity", 1e-10)
+            cic::Parameter<double>("conductivity-initial", "Initial link conductivity", 1e-10),
+            cic::Parameter<bool>("equipotential-channels", "Redistribute charge along highly conductive channels after every step to make them equipotential"),
+            cic::Parameter<double>("equipotential-cond-fraction", "Link is a part of equipotential channel if its conductivity is greater than this fraction of cond-limit", 0.5)
 		),
         cic::ParametersGroup(
             "Geometry",
@@ -97,6 +148,7 @@ private:
 		    cic::Parameter<double>("seeds-zone-height",  "Height of zone where seeds will be generated", 15.0),
 		    cic::Parameter<double>("seeds-zone-dia",     "Diameter of zone where seeda will be generated", 5),
             cic::Parameter<double>("seeds-min-dist",     "Minimal distance between seeds", 0.01),
+            cic::Parameter<size_t>("seeds-max-attempts", "Count of random places tried for one seed before it is dropped", 30),
             cic::Parameter<double>("seed-size",          "Size of seed's link", 0.4),
             cic::Parameter<double>("seed-radius-cond",   "Seeds' node radius for conductivity", 0.03),
             cic::Parameter<double>("seed-radius-branch", "Seeds' node radius for branching", 0.05),
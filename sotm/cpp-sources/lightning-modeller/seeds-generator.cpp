@@ -2,8 +2,10 @@
 
 #include "sotm/payloads/electrostatics/electrostatics.hpp"
 #include "sotm/math/random.hpp"
+#include "sotm/utils/log.hpp"
 
 #include <iostream>
+#include <vector>
 
 using namespace sotm;
 
@@ -21,12 +23,7 @@ void SeedsGenerator::AddSeedsHook::hook(double realTime, double wantedTime)
     size_t needCountTillNow = realTime / m_sg.m_addSeedPeriod + m_sg.seedsCount;
     size_t toAdd = needCountTillNow - m_sg.m_currentCount;
 
-    //std::cout << "Need to add " << toAdd << " seeds" << std::endl;
-    for (size_t i=0; i<toAdd; i++)
-    {
-        //std::cout << "Adding seed" << std::endl;
-        m_sg.addSeed();
-    }
+    m_sg.addSeeds(toAdd);
 }
 
 SeedsGenerator::SeedsGenerator(cic::ParametersGroup& pg, sotm::ModelContext& c) :
@@ -48,10 +45,7 @@ void SeedsGenerator::generateInitial()
 
         l->connect(n1, n2);
     } else {
-        for (unsigned int i=0; i<seedsCount; i++)
-        {
-            addSeed();
-        }
+        addSeeds(seedsCount);
     }
 }
 
@@ -76,6 +70,7 @@ void SeedsGenerator::parseConfig()
     seedSize = m_pg.get<double>("seed-size");
     m_dynamicSeedsCount = m_pg.get<size_t>("seeds-dynamic-count");
     m_addSeedPeriod = 1 / (m_pg.get<double>("seeds-dynamic-count-per-vol-per-sec") * dia * dia * height);
+    m_maxAttempts = m_pg.get<size_t>("seeds-max-attempts");
 }
 
 void SeedsGenerator::setNodeParameters(Node* n)
@@ -99,38 +94,85 @@ void SeedsGenerator::setLinkParameters(Link* l)
     p->linkEta = ElectrostaticNodePayload::etaFromCriticalField(fieldCritical, beta);
 }
 
-void SeedsGenerator::addSeed()
+size_t SeedsGenerator::addSeeds(size_t count)
 {
-    double d=0.0;
-    StaticVector<3> p;
-    do
+    // Existing nodes are found by grid of electrostatics context, nodes of this batch are not created yet
+    SpatialHashGrid batchGrid(minDist > 0.0 ? minDist : 1.0);
+
+    std::vector<StaticVector<3>> places;
+    places.reserve(count);
+    for (size_t i=0; i<count; i++)
     {
-        p[0] = Random::uniform(-dia, dia);
-        p[1] = Random::uniform(-dia, dia);
-        if (uniform)
-            p[2] = -height + 2*height / (seedsCount-1) * m_currentCount;
-        else
-            p[2] = Random::uniform(-height, height);
+        StaticVector<3> p;
+        if (findPlace(batchGrid, p))
+        {
+            places.push_back(p);
+            batchGrid.insert(StaticVector<3>(p[0], p[1], p[2]-seedSize/2.0));
+            batchGrid.insert(StaticVector<3>(p[0], p[1], p[2]+seedSize/2.0));
+        }
+        m_currentCount++;
+    }
 
-        auto nearest = m_c.graphRegister.getNearestNode(p);
-        if (nearest == nullptr)
-            break;
-        d = (nearest->pos-p).norm();
-    } while (d < minDist);
+    if (places.size() != count)
+    {
+        SOTM_LOG(warning) << "Cannot place " << count - places.size()
+            << " seeds farther than " << minDist << " from other nodes, they are dropped";
+    }
 
     /// Building initial tree
-    PtrWrap<Node> n1 = PtrWrap<Node>::make(&m_c, StaticVector<3>(p[0], p[1], p[2]-seedSize/2.0));
-    PtrWrap<Node> n2 = PtrWrap<Node>::make(&m_c, StaticVector<3>(p[0], p[1], p[2]+seedSize/2.0));
-    PtrWrap<Link> l = PtrWrap<Link>::make(&m_c);
-    l->connect(n1, n2);
+    std::vector<Node*> nodes;
+    std::vector<Link*> links;
+    nodes.reserve(2 * places.size());
+    links.reserve(places.size());
+    {
+        GraphRegister::ChangesBatch batch(m_c.graphRegister);
+        for (const auto& p : places)
+        {
+            PtrWrap<Node> n1 = PtrWrap<Node>::make(&m_c, StaticVector<3>(p[0], p[1], p[2]-seedSize/2.0));
+            PtrWrap<Node> n2 = PtrWrap<Node>::make(&m_c, StaticVector<3>(p[0], p[1], p[2]+seedSize/2.0));
+            PtrWrap<Link> l = PtrWrap<Link>::make(&m_c);
+            l->connect(n1, n2);
+            nodes.push_back(n1);
+            nodes.push_back(n2);
+            links.push_back(l);
+        }
+    }
+
+    if (places.empty())
+        return 0;
 
-    n1->payload->init();
-    n2->payload->init();
-    l->payload->init();
+    // Payloads initialization calculates field, so optimizer is rebuilt once before it
+    static_cast<ElectrostaticPhysicalContext*>(m_c.physicalContext())->optimizer->rebuildOptimization();
+    for (auto n : nodes)
+    {
+        setNodeParameters(n);
+        n->payload->init();
+    }
+    for (auto l : links)
+    {
+        l->payload->init();
+        setLinkParameters(l);
+    }
 
-    setNodeParameters(n1);
-    setNodeParameters(n2);
-    setLinkParameters(l);
+    return places.size();
+}
 
-    m_currentCount++;
+bool SeedsGenerator::findPlace(const SpatialHashGrid& batchGrid, StaticVector<3>& place)
+{
+    const ElectrostaticPhysicalContext* context = static_cast<const ElectrostaticPhysicalContext*>(m_c.physicalContext());
+
+    for (size_t attempt=0; attempt<m_maxAttempts; attempt++)
+    {
+        place[0] = Random::uniform(-dia, dia);
+        place[1] = Random::uniform(-dia, dia);
+        if (uniform)
+            place[2] = -height + 2*height / (seedsCount-1) * m_currentCount;
+        else
+            place[2] = Random::uniform(-height, height);
+
+        if (minDist <= 0.0
+                || (!batchGrid.hasPointCloser(place, minDist) && !context->hasNodeCloser(place, minDist)))
+            return true;
+    }
+    return false;
 }
@@ -4,6 +4,7 @@
 #include "sotm/base/model-context.hpp"
 #include "sotm/base/transport-graph.hpp"
 #include "sotm/base/time-iter.hpp"
+#include "sotm/math/spatial-hash-grid.hpp"
 #include "cic.hpp"
 
 class SeedsGenerator
@@ -24,11 +25,21 @@ public:
     void generateInitial();
     AddSeedsHook& hook();
 
+    /**
+     * Add seeds as one graph change followed by one optimizer rebuild.
+     * Places are chosen by Poisson-disk style dart throwing: candidate closer than
+     * seeds-min-dist to any node is rejected. Seed is dropped if there is no place
+     * after seeds-max-attempts candidates
+     * @return Count of seeds that were placed
+     */
+    size_t addSeeds(size_t count);
+
 private:
 
     void setNodeParameters(sotm::Node* n);
     void setLinkParameters(sotm::Link* l);
-    void addSeed();
+    /// Place is checked against existing nodes and against batchGrid with nodes of seeds of current batch
+    bool findPlace(const sotm::SpatialHashGrid& batchGrid, sotm::StaticVector<3>& place);
 
     cic::ParametersGroup& m_pg;
     sotm::ModelContext& m_c;
@@ -41,6 +52,7 @@ private:
     double minDist;
     bool uniform;
     double seedSize;
+    size_t m_maxAttempts = 30;
 
     double m_addSeedPeriod = 0.0;
     size_t m_dynamicSeedsCount = 0;
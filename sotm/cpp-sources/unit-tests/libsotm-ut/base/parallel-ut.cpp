@@ -0,0 +1,94 @@
+#include "sotm/base/parallel.hpp"
+#include "sotm/utils/first-touch-array.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+namespace {
+
+void checkAllVisited(const ParallelSettings& ps, size_t size)
+{
+	std::vector<std::atomic<int>> visits(size);
+	for (auto &it : visits)
+		it = 0;
+	ps.forEach(ParallelSettings::Phase::step, size, [&visits](size_t i) { visits[i]++; });
+	for (size_t i = 0; i < size; i++)
+		ASSERT_EQ(visits[i].load(), 1) << "index " << i;
+}
+
+}
+
+TEST(ParallelSettings, PhaseFlags)
+{
+	ParallelSettings ps;
+	EXPECT_FALSE(ps.enabled(ParallelSettings::Phase::makeSubIteration));
+	ps.parallelContiniousIteration.addRHSToDelta = true;
+	EXPECT_FALSE(ps.enabled(ParallelSettings::Phase::makeSubIteration));
+	ps.parallelContiniousIteration.makeSubIteration = true;
+	EXPECT_TRUE(ps.enabled(ParallelSettings::Phase::makeSubIteration));
+	EXPECT_TRUE(ps.runParallel(ParallelSettings::Phase::makeSubIteration, 10));
+
+	ps.serialThreshold = 100;
+	EXPECT_FALSE(ps.runParallel(ParallelSettings::Phase::makeSubIteration, 99));
+	EXPECT_TRUE(ps.runParallel(ParallelSettings::Phase::makeSubIteration, 100));
+}
+
+TEST(ParallelSettings, PartitionersAndArena)
+{
+	ParallelSettings ps;
+	ps.parallelContiniousIteration.step = true;
+	ps.grainSize[size_t(ParallelSettings::Phase::step)] = 7;
+
+	for (auto partitioner : {ParallelSettings::Partitioner::automatic, ParallelSettings::Partitioner::simple,
+			ParallelSettings::Partitioner::affinity, ParallelSettings::Partitioner::statics})
+	{
+		ps.partitioner = partitioner;
+		ps.threadsCount = 0;
+		ps.isolateArena = false;
+		ps.reconfigure();
+		checkAllVisited(ps, 1000);
+		ps.isolateArena = true;
+		ps.reconfigure();
+		checkAllVisited(ps, 1000);
+		ps.threadsCount = 2;
+		ps.reconfigure();
+		checkAllVisited(ps, 1000);
+		checkAllVisited(ps, 1);
+		checkAllVisited(ps, 0);
+	}
+}
+
+TEST(ParallelSettings, NumaParts)
+{
+	ParallelSettings ps;
+	ps.parallelContiniousIteration.step = true;
+	ps.numaAware = true;
+	// Two nodes sharing CPU 0 that is available everywhere
+	ps.numaNodesCpus = {{0}, {0}};
+	ASSERT_EQ(ps.numaNodesCount(), 1u) << "Settings are applied by reconfigure() only";
+	ps.reconfigure();
+	ASSERT_EQ(ps.numaNodesCount(), 2u);
+
+	size_t begin0, end0, begin1, end1;
+	ps.numaPart(0, 10, 1010, begin0, end0);
+	ps.numaPart(1, 10, 1010, begin1, end1);
+	EXPECT_EQ(begin0, 10u);
+	EXPECT_EQ(end0, begin1);
+	EXPECT_EQ(end1, 1010u);
+	EXPECT_EQ(end0, 510u);
+
+	checkAllVisited(ps, 1000);
+	ps.pinThreads = true;
+	ps.reconfigure();
+	checkAllVisited(ps, 1000);
+	ps.partitioner = ParallelSettings::Partitioner::affinity;
+	checkAllVisited(ps, 3);
+
+	sotm::FirstTouchArray<size_t> array;
+	array.assign(ps, ParallelSettings::Phase::step, 500, [](size_t i) { return i * 2; });
+	ASSERT_EQ(array.size(), 500u);
+	for (size_t i = 0; i < array.size(); i++)
+		ASSERT_EQ(array[i], i * 2);
+}
@@ -21,3 +21,181 @@ TEST(NodeTests, Instanciation)
 	ASSERT_EQ(n->pos.x[2], 3.0);
 
 }
+
+TEST(GraphAdjacency, Snapshot)
+{
+	ModelContext c;
+	c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+	c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+	c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+	PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 0.0));
+	PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(3.0, 4.0, 0.0));
+	PtrWrap<Node> n3 = PtrWrap<Node>::make(&c, StaticVector<3>(3.0, 4.0, 1.0));
+	PtrWrap<Link> l1 = PtrWrap<Link>::make(&c);
+	l1->connect(n1, n2);
+
+	const GraphAdjacency& a = c.graphRegister.adjacency();
+	ASSERT_EQ(a.nodes.size(), 3u);
+	ASSERT_EQ(a.links.size(), 1u);
+	EXPECT_EQ(a.linkLengths[0], 5.0);
+	EXPECT_TRUE(a.hasNeighbour(n1.data(), n2.data()));
+	EXPECT_TRUE(a.hasNeighbour(n2.data(), n1.data()));
+	EXPECT_FALSE(a.hasNeighbour(n1.data(), n3.data()));
+	EXPECT_EQ(a.degree(a.nodeIndex(n2.data())), 1u);
+
+	size_t hash = c.graphRegister.stateHash();
+	PtrWrap<Link> l2 = PtrWrap<Link>::make(&c);
+	l2->connect(n2, n3);
+	ASSERT_NE(hash, c.graphRegister.stateHash());
+
+	const GraphAdjacency& b = c.graphRegister.adjacency();
+	ASSERT_EQ(b.links.size(), 2u) << "Snapshot should be rebuilt after graph change";
+	EXPECT_TRUE(b.hasNeighbour(n2.data(), n3.data()));
+	EXPECT_EQ(b.degree(b.nodeIndex(n2.data())), 2u);
+	EXPECT_EQ(b.linkLengths[b.neighbourLinks[b.rowBegins[b.nodeIndex(n3.data())]]], 1.0);
+
+	std::vector<std::vector<size_t>> blocks;
+	b.partition(2, blocks);
+	ASSERT_EQ(blocks.size(), 2u);
+	size_t total = 0;
+	for (auto &block : blocks)
+	{
+		ASSERT_LE(block.size(), 2u);
+		total += block.size();
+		if (block.size() == 2)
+		{
+			EXPECT_TRUE(b.hasNeighbour(block[0], block[1])) << "Block should be connected";
+		}
+	}
+	EXPECT_EQ(total, 3u);
+
+	b.partition(10, blocks);
+	ASSERT_EQ(blocks.size(), 1u);
+
+	// Connecting registered link changes topology too
+	PtrWrap<Link> l3 = PtrWrap<Link>::make(&c);
+	hash = c.graphRegister.stateHash();
+	l3->connect(n1, n3);
+	ASSERT_NE(hash, c.graphRegister.stateHash());
+	EXPECT_TRUE(c.graphRegister.adjacency().hasNeighbour(n1.data(), n3.data()));
+
+	// While iterating state hash is changed when iterating ends
+	PtrWrap<Link> l4 = PtrWrap<Link>::make(&c);
+	hash = c.graphRegister.stateHash();
+	c.graphRegister.applyLinkVisitor([&](Link* l) {
+		if (l == l4.data())
+			l4->connect(n1, n2);
+		EXPECT_EQ(hash, c.graphRegister.stateHash());
+	});
+	EXPECT_NE(hash, c.graphRegister.stateHash());
+
+	EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
+
+TEST(GraphRegister, ChangeJournal)
+{
+	ModelContext c;
+	c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+	c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+	c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+	size_t position = c.graphRegister.journalEnd();
+	std::vector<GraphChange> changes;
+
+	PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 0.0));
+	PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(1.0, 0.0, 0.0));
+	PtrWrap<Link> l1 = PtrWrap<Link>::make(&c);
+	l1->connect(n1, n2);
+
+	ASSERT_TRUE(c.graphRegister.changesSince(position, changes));
+	ASSERT_EQ(changes.size(), 3u);
+	EXPECT_EQ(changes[0].type, GraphChange::Type::nodeAdded);
+	EXPECT_EQ(changes[0].node, n1.data());
+	EXPECT_EQ(changes[1].node, n2.data());
+	EXPECT_EQ(changes[2].type, GraphChange::Type::linkAdded);
+	EXPECT_EQ(changes[2].link, l1.data());
+	EXPECT_EQ(position, c.graphRegister.journalEnd());
+
+	ASSERT_TRUE(c.graphRegister.changesSince(position, changes));
+	EXPECT_TRUE(changes.empty());
+
+	// Nodes added while iterating are recorded when applied
+	c.graphRegister.applyNodeVisitor([&c](Node* n) {
+		if (n->pos.x[0] == 0.0)
+			PtrWrap<Node>::make(&c, StaticVector<3>(2.0, 0.0, 0.0));
+	});
+	ASSERT_TRUE(c.graphRegister.changesSince(position, changes));
+	ASSERT_EQ(changes.size(), 1u);
+	EXPECT_EQ(changes[0].type, GraphChange::Type::nodeAdded);
+	EXPECT_EQ(changes[0].node->pos.x[0], 2.0);
+
+	// Dropped changes should be reported
+	size_t oldPosition = position;
+	c.graphRegister.setJournalCapacity(1);
+	PtrWrap<Node> n3 = PtrWrap<Node>::make(&c, StaticVector<3>(3.0, 0.0, 0.0));
+	PtrWrap<Node> n4 = PtrWrap<Node>::make(&c, StaticVector<3>(4.0, 0.0, 0.0));
+	EXPECT_FALSE(c.graphRegister.changesSince(oldPosition, changes));
+	EXPECT_EQ(oldPosition, c.graphRegister.journalEnd());
+	c.graphRegister.setJournalCapacity(GraphRegister::defaultJournalCapacity);
+
+	position = c.graphRegister.journalEnd();
+	Link* removed = l1.data();
+	l1.clear();
+	n1.clear();
+	n2.clear();
+	n3.clear();
+	n4.clear();
+	c.destroyAll();
+	ASSERT_TRUE(c.graphRegister.changesSince(position, changes));
+	size_t nodesRemoved = 0, linksRemoved = 0;
+	for (auto &it : changes)
+	{
+		if (it.type == GraphChange::Type::nodeRemoved)
+			nodesRemoved++;
+		if (it.type == GraphChange::Type::linkRemoved)
+		{
+			linksRemoved++;
+			EXPECT_EQ(it.link, removed);
+		}
+	}
+	EXPECT_EQ(nodesRemoved, 5u);
+	EXPECT_EQ(linksRemoved, 1u);
+	EXPECT_EQ(c.graphRegister.nodesCount(), 0u);
+}
+
+TEST(GraphRegister, ChangesBatch)
+{
+	ModelContext c;
+	c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+	c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+	c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+	PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 0.0));
+	size_t hash = c.graphRegister.stateHash();
+	size_t position = c.graphRegister.journalEnd();
+	{
+		GraphRegister::ChangesBatch batch(c.graphRegister);
+		{
+			GraphRegister::ChangesBatch inner(c.graphRegister);
+			PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(1.0, 0.0, 0.0));
+			PtrWrap<Link> l = PtrWrap<Link>::make(&c);
+			l->connect(n1, n2);
+		}
+		EXPECT_EQ(c.graphRegister.nodesCount(), 1u) << "Inner batch should not apply changes";
+		EXPECT_EQ(c.graphRegister.stateHash(), hash);
+		EXPECT_EQ(c.graphRegister.getNearestNode(StaticVector<3>(0.9, 0.0, 0.0))->pos.x[0], 1.0)
+			<< "Nodes added in batch should be found";
+		PtrWrap<Node>::make(&c, StaticVector<3>(2.0, 0.0, 0.0));
+	}
+	EXPECT_EQ(c.graphRegister.nodesCount(), 3u);
+	EXPECT_EQ(c.graphRegister.linksCount(), 1u);
+	EXPECT_NE(c.graphRegister.stateHash(), hash);
+
+	std::vector<GraphChange> changes;
+	ASSERT_TRUE(c.graphRegister.changesSince(position, changes));
+	EXPECT_EQ(changes.size(), 3u);
+
+	n1.clear();
+	c.destroyAll();
+}
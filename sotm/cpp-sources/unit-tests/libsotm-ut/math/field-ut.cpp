@@ -6,9 +6,11 @@
  */
 
 #include "sotm/math/field.hpp"
+#include "sotm/math/field-static.hpp"
 
 #include "gtest/gtest.h"
 #include <cmath>
+#include <memory>
 
 using namespace sotm;
 
@@ -59,3 +61,63 @@ TEST(FieldGradients, GradientFixedStep)
 			1e-3
 	);
 }
+
+TEST(FieldGradients, ValueAndGradientLinear)
+{
+	FieldLinearScalar<3> lf(10.0, {0.0, 3.0, 4.0});
+	double value = 0.0;
+	StaticVector<3> gradient;
+	lf.valueAndGradient({1.0, 1.0, 1.0}, value, gradient);
+	ASSERT_NEAR(value, 14.0, 1e-12);
+	ASSERT_NEAR(gradient[0], 0.0, 1e-12);
+	ASSERT_NEAR(gradient[1], 6.0, 1e-12);
+	ASSERT_NEAR(gradient[2], 8.0, 1e-12);
+}
+
+TEST(FieldGradients, ValueAndGradientScalar1D)
+{
+	FieldScalar1D<3> analytic([](double x) { return sin(x); }, [](double x) { return cos(x); }, {1.0, 1.0, 0.0});
+	FieldScalar1D<3> numeric([](double x) { return sin(x); }, {1.0, 1.0, 0.0});
+
+	double value = 0.0, numericValue = 0.0;
+	StaticVector<3> gradient, numericGradient;
+	analytic.valueAndGradient({2.0, 2.0, 0.0}, value, gradient);
+	numeric.valueAndGradient({2.0, 2.0, 0.0}, numericValue, numericGradient);
+
+	ASSERT_NEAR(value, sin(sqrt(2.0)*2.0), 1e-10);
+	ASSERT_EQ(value, numericValue);
+	ASSERT_NEAR(gradient[0], cos(sqrt(2.0)*2.0) * sqrt(2.0)/2.0, 1e-10);
+	ASSERT_NEAR(gradient[1], cos(sqrt(2.0)*2.0) * sqrt(2.0)/2.0, 1e-10);
+	ASSERT_NEAR(gradient[2], 0.0, 1e-10);
+	ASSERT_NEAR(numericGradient[0], gradient[0], 1e-2) << "Finite difference fallback should be close to analytic gradient";
+}
+
+TEST(StaticFields, ProjectedAndSum)
+{
+	struct Square
+	{
+		double operator()(double x) const { return x*x; }
+		double derivative(double x) const { return 2*x; }
+	};
+
+	StaticProjectedField<Square, 3> projected(Square(), {0.0, 0.0, 2.0});
+	StaticLinearScalarField<3> linear(10.0, {1.0, 0.0, 0.0});
+	auto sum = projected + linear;
+
+	double value = 0.0;
+	StaticVector<3> gradient;
+	sum.valueAndGradient({1.0, 0.0, 3.0}, value, gradient);
+	ASSERT_NEAR(value, 19.0, 1e-12);
+	ASSERT_NEAR(gradient[0], 10.0, 1e-12);
+	ASSERT_NEAR(gradient[1], 0.0, 1e-12);
+	ASSERT_NEAR(gradient[2], 6.0, 1e-12);
+	ASSERT_NEAR(sum({1.0, 0.0, 3.0}), 19.0, 1e-12);
+
+	std::unique_ptr<Field<1, 3>> erased(makeStaticFieldAdapter(sum));
+	double erasedValue = 0.0;
+	StaticVector<3> erasedGradient;
+	erased->valueAndGradient({1.0, 0.0, 3.0}, erasedValue, erasedGradient);
+	ASSERT_EQ(erasedValue, value);
+	ASSERT_EQ((*erased)({1.0, 0.0, 3.0}), value);
+	ASSERT_EQ(erasedGradient[2], gradient[2]);
+}
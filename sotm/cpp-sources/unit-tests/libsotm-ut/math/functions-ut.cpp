@@ -32,3 +32,16 @@ TEST(FunctionsTest, Trapezoid)
 	ASSERT_GT(t(z0-scale/2-rec/2), -t.maxAbs());
 	ASSERT_LT(t(z0-scale/2-rec/2), -linEnd);
 }
+
+TEST(FunctionsTest, TrapezoidDerivative)
+{
+	TrapezoidFunc t(20, 10, 3, -84);
+	const double h = 1e-6;
+	for (double z = -100; z < -68; z += 0.37)
+	{
+		double numeric = (t(z + h) - t(z - h)) / (2 * h);
+		ASSERT_NEAR(t.derivative(z), numeric, 1e-4) << "z = " << z;
+	}
+	ASSERT_EQ(t.derivative(-84), 20.0);
+	ASSERT_EQ(t.derivative(1000), 0.0);
+}
@@ -0,0 +1,119 @@
+#include "sotm/math/geometry.hpp"
+#include "sotm/math/random.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace sotm;
+
+namespace {
+
+const size_t pointsCount = 4096;
+const int repeats = 50;
+
+std::vector<StaticVector<3>> randomPoints(size_t count)
+{
+    std::vector<StaticVector<3>> points(count);
+    for (auto &it : points)
+        it = {Random::uniform(-1.0, 1.0), Random::uniform(-1.0, 1.0), Random::uniform(-1.0, 1.0)};
+    return points;
+}
+
+/// Calls f repeats times and prints average time of call in nanoseconds per point
+template<typename Function>
+double measure(const char* name, Function f)
+{
+    auto start = std::chrono::steady_clock::now();
+    double checksum = 0.0;
+    for (int i = 0; i < repeats; i++)
+        checksum += f();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+            / repeats / pointsCount;
+    std::cout << "    " << name << ": " << ns << " ns per point" << std::endl;
+    return checksum;
+}
+
+}
+
+TEST(StaticVectorHelpers, PaddingIsZero)
+{
+    StaticVector<3> a(1.0, 2.0, 3.0);
+    StaticVector<3> b({4.0, 5.0, 6.0});
+    StaticVector<3> c;
+    EXPECT_EQ(a.x[3], 0.0);
+    EXPECT_EQ(b.x[3], 0.0);
+    EXPECT_EQ(c.x[3], 0.0);
+    EXPECT_EQ((a + b - c).x[3], 0.0);
+    EXPECT_EQ((-a).x[3], 0.0);
+}
+
+TEST(StaticVectorHelpers, NormAndDistance)
+{
+    StaticVector<3> a(1.0, 2.0, 3.0);
+    StaticVector<3> b(-2.0, 6.0, 3.0);
+    EXPECT_DOUBLE_EQ(a.norm(), std::sqrt(14.0));
+    EXPECT_DOUBLE_EQ(a.normSquared(), 14.0);
+    EXPECT_DOUBLE_EQ(dot(a, b), 19.0);
+    EXPECT_DOUBLE_EQ(distanceSquared(a, b), 25.0);
+    EXPECT_DOUBLE_EQ(distance(a, b), 5.0);
+
+    StaticVector<2> c(3.0, 4.0);
+    EXPECT_DOUBLE_EQ(c.norm(), 5.0);
+}
+
+TEST(StaticVectorHelpers, BulkOperations)
+{
+    std::vector<StaticVector<3>> points = randomPoints(100);
+    std::vector<StaticVector<3>> target = randomPoints(100);
+    std::vector<StaticVector<3>> expected = target;
+    StaticVector<3> point(0.1, 0.2, 0.3);
+
+    std::vector<double> d2(points.size());
+    distancesSquared(point, points.data(), d2.data(), points.size());
+    addScaled(target.data(), points.data(), 0.5, points.size());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        EXPECT_DOUBLE_EQ(d2[i], (point - points[i]).normSquared());
+        expected[i] += points[i] * 0.5;
+        EXPECT_EQ(target[i], expected[i]);
+    }
+}
+
+TEST(StaticVectorHelpers, Microbenchmark)
+{
+    std::vector<StaticVector<3>> points = randomPoints(pointsCount);
+    std::vector<StaticVector<3>> target = randomPoints(pointsCount);
+    std::vector<double> d2(pointsCount);
+    StaticVector<3> point(0.1, 0.2, 0.3);
+
+    double byOperators = measure("(a - b).norm()", [&]() {
+        double sum = 0.0;
+        for (size_t i = 0; i < pointsCount; i++)
+            sum += (point - points[i]).norm();
+        return sum;
+    });
+    double byHelper = measure("distance(a, b)", [&]() {
+        double sum = 0.0;
+        for (size_t i = 0; i < pointsCount; i++)
+            sum += distance(point, points[i]);
+        return sum;
+    });
+    EXPECT_NEAR(byOperators, byHelper, 1e-9 * byOperators);
+
+    measure("distancesSquared()", [&]() {
+        distancesSquared(point, points.data(), d2.data(), pointsCount);
+        return d2[0];
+    });
+    measure("a += b * k", [&]() {
+        for (size_t i = 0; i < pointsCount; i++)
+            target[i] += points[i] * 1e-3;
+        return target[0][0];
+    });
+    measure("addScaled()", [&]() {
+        addScaled(target.data(), points.data(), 1e-3, pointsCount);
+        return target[0][0];
+    });
+}
@@ -15,3 +15,21 @@ TEST(DefinedIntegral, x)
 	ASSERT_NEAR(i(9)-i(1), ans(9)-ans(1), 0.1);
 	ASSERT_NEAR(i(2)-i(4), ans(2)-ans(4), 0.01);
 }
+
+TEST(DefinedIntegral, Inverse)
+{
+	auto func = [](double x) { return x; };
+	auto ans = [](double x) { return x*x/2.0; };
+
+	DefinedIntegral i(func, 0, 10, 1000);
+
+	double arg = 0.0;
+	ASSERT_TRUE(i.inverse(ans(3.0), 1.0, 5.0, arg));
+	ASSERT_NEAR(arg, 3.0, 0.01);
+	ASSERT_NEAR(i(arg), ans(3.0), 0.01);
+
+	ASSERT_TRUE(i.inverse(ans(7.5), 0.0, 10.0, arg));
+	ASSERT_NEAR(arg, 7.5, 0.01);
+
+	ASSERT_FALSE(i.inverse(ans(6.0), 1.0, 5.0, arg)) << "Value is out of integral on [1, 5]";
+}
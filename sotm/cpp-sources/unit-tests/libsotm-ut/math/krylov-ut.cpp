@@ -0,0 +1,128 @@
+#include "sotm/math/krylov.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace sotm;
+
+namespace {
+
+// Symmetric positive definite tridiagonal matrix with 4 on diagonal and -1 near it
+void laplacian(const std::vector<double>& x, std::vector<double>& result)
+{
+	size_t n = x.size();
+	result.assign(n, 0.0);
+	for (size_t i = 0; i < n; i++)
+	{
+		result[i] = 4.0 * x[i];
+		if (i > 0)
+			result[i] -= x[i-1];
+		if (i + 1 < n)
+			result[i] -= x[i+1];
+	}
+}
+
+}
+
+TEST(Krylov, ConjugateGradient)
+{
+	std::vector<double> expected{1.0, -2.0, 3.0, 0.5, 7.0, -1.0};
+	std::vector<double> b;
+	laplacian(expected, b);
+
+	std::vector<double> x;
+	KrylovResult result = conjugateGradient(laplacian, b, x, 1e-12, 100);
+	ASSERT_TRUE(result.converged);
+	ASSERT_LE(result.iterations, expected.size());
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_NEAR(x[i], expected[i], 1e-9);
+}
+
+TEST(Krylov, ConjugateGradientPreconditioned)
+{
+	std::vector<double> expected{2.0, 1.0, -1.0, 4.0};
+	std::vector<double> b;
+	laplacian(expected, b);
+
+	auto jacobi = [](const std::vector<double>& r, std::vector<double>& z)
+	{
+		for (size_t i = 0; i < r.size(); i++)
+			z[i] = r[i] / 4.0;
+	};
+
+	std::vector<double> x(expected.size(), 0.0);
+	KrylovResult result = conjugateGradient(laplacian, jacobi, b, x, 1e-12, 100);
+	ASSERT_TRUE(result.converged);
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_NEAR(x[i], expected[i], 1e-9);
+
+	std::vector<double> zero(4, 0.0);
+	result = conjugateGradient(laplacian, zero, x, 1e-12, 100);
+	ASSERT_TRUE(result.converged);
+	ASSERT_EQ(result.iterations, 0u);
+	ASSERT_EQ(x[0], 0.0);
+}
+
+TEST(Krylov, GmresNonsymmetric)
+{
+	auto convection = [](const std::vector<double>& x, std::vector<double>& result)
+	{
+		size_t n = x.size();
+		result.assign(n, 0.0);
+		for (size_t i = 0; i < n; i++)
+		{
+			result[i] = 3.0 * x[i];
+			if (i > 0)
+				result[i] -= 2.0 * x[i-1];
+			if (i + 1 < n)
+				result[i] += 0.5 * x[i+1];
+		}
+	};
+
+	std::vector<double> expected{1.0, 0.0, -2.0, 5.0, 3.0, -1.0, 2.0, 0.5};
+	std::vector<double> b;
+	convection(expected, b);
+
+	std::vector<double> x;
+	KrylovResult result = gmres(convection, b, x, 1e-12, 3, 200);
+	ASSERT_TRUE(result.converged) << "Restarted GMRES should converge";
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_NEAR(x[i], expected[i], 1e-9);
+}
+
+TEST(Krylov, BlockJacobi)
+{
+	std::vector<double> expected{1.0, -2.0, 3.0, 0.5, 7.0, -1.0};
+	std::vector<double> b;
+	laplacian(expected, b);
+
+	auto entry = [](size_t i, size_t j)
+	{
+		if (i == j)
+			return 4.0;
+		return (i + 1 == j || j + 1 == i) ? -1.0 : 0.0;
+	};
+
+	// Whole matrix in one block is exact inverse
+	BlockJacobiPreconditioner exact;
+	exact.build({{0, 1, 2, 3, 4, 5}}, entry);
+	std::vector<double> z;
+	exact(b, z);
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_NEAR(z[i], expected[i], 1e-12);
+
+	BlockJacobiPreconditioner blocks;
+	blocks.build({{0, 1}, {3, 2}, {4, 5}}, entry);
+	ASSERT_EQ(blocks.blocksCount(), 3u);
+
+	std::vector<double> x;
+	KrylovResult withBlocks = conjugateGradient(laplacian, blocks, b, x, 1e-12, 100);
+	ASSERT_TRUE(withBlocks.converged);
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_NEAR(x[i], expected[i], 1e-9);
+
+	x.clear();
+	KrylovResult gmresWithBlocks = gmres(laplacian, blocks, b, x, 1e-12, 10, 100);
+	ASSERT_TRUE(gmresWithBlocks.converged);
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_NEAR(x[i], expected[i], 1e-9);
+}
@@ -0,0 +1,125 @@
+#include "sotm/math/spatial-hash-grid.hpp"
+#include "sotm/math/random.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace sotm;
+
+namespace {
+
+bool hasPointCloserBruteForce(const std::vector<StaticVector<3>>& points, const StaticVector<3>& point, double d)
+{
+    for (const auto& it : points)
+        if (distance(it, point) < d)
+            return true;
+    return false;
+}
+
+}
+
+TEST(SpatialHashGrid, WrongCellSize)
+{
+    EXPECT_THROW(SpatialHashGrid(0.0), std::runtime_error);
+    EXPECT_THROW(SpatialHashGrid(-1.0), std::runtime_error);
+}
+
+TEST(SpatialHashGrid, NeighbourCells)
+{
+    SpatialHashGrid grid(1.0);
+    EXPECT_FALSE(grid.hasPointCloser(StaticVector<3>(0.0, 0.0, 0.0), 1.0));
+
+    grid.insert(StaticVector<3>(-0.1, 0.0, 0.0));
+    EXPECT_EQ(grid.size(), 1u);
+    // Points on different sides of cell border
+    EXPECT_TRUE(grid.hasPointCloser(StaticVector<3>(0.1, 0.0, 0.0), 0.3));
+    EXPECT_FALSE(grid.hasPointCloser(StaticVector<3>(0.1, 0.0, 0.0), 0.2));
+    // Distance is greater than cell size
+    EXPECT_TRUE(grid.hasPointCloser(StaticVector<3>(2.5, 0.0, 0.0), 3.0));
+    EXPECT_FALSE(grid.hasPointCloser(StaticVector<3>(2.5, 0.0, 0.0), 2.5));
+
+    grid.clear();
+    EXPECT_EQ(grid.size(), 0u);
+    EXPECT_FALSE(grid.hasPointCloser(StaticVector<3>(0.1, 0.0, 0.0), 0.3));
+}
+
+TEST(SpatialHashGrid, AgainstBruteForce)
+{
+    const double cellSize = 0.3;
+    SpatialHashGrid grid(cellSize);
+    std::vector<StaticVector<3>> points;
+    for (int i = 0; i < 500; i++)
+    {
+        StaticVector<3> p(Random::uniform(-5.0, 5.0), Random::uniform(-5.0, 5.0), Random::uniform(-5.0, 5.0));
+        points.push_back(p);
+        grid.insert(p);
+    }
+
+    for (int i = 0; i < 2000; i++)
+    {
+        StaticVector<3> p(Random::uniform(-6.0, 6.0), Random::uniform(-6.0, 6.0), Random::uniform(-6.0, 6.0));
+        double d = Random::uniform(0.0, 2.0 * cellSize);
+        ASSERT_EQ(grid.hasPointCloser(p, d), hasPointCloserBruteForce(points, p, d)) << p.str() << ", d = " << d;
+    }
+}
+
+TEST(SpatialHashGrid, DistanceMuchGreaterThanCell)
+{
+    // Box of search has more cells than occupied ones
+    const double cellSize = 0.05;
+    SpatialHashGrid grid(cellSize);
+    std::vector<StaticVector<3>> points;
+    for (int i = 0; i < 50; i++)
+    {
+        StaticVector<3> p(Random::uniform(-5.0, 5.0), Random::uniform(-5.0, 5.0), Random::uniform(-5.0, 5.0));
+        points.push_back(p);
+        grid.insert(p);
+    }
+
+    for (int i = 0; i < 2000; i++)
+    {
+        StaticVector<3> p(Random::uniform(-6.0, 6.0), Random::uniform(-6.0, 6.0), Random::uniform(-6.0, 6.0));
+        double d = Random::uniform(0.0, 60.0 * cellSize);
+        ASSERT_EQ(grid.hasPointCloser(p, d), hasPointCloserBruteForce(points, p, d)) << p.str() << ", d = " << d;
+    }
+}
+
+TEST(SpatialHashGrid, NearestAndErase)
+{
+    const double cellSize = 0.3;
+    SpatialHashGridT<int> grid(cellSize);
+    std::vector<StaticVector<3>> points;
+    for (int i = 0; i < 500; i++)
+    {
+        points.emplace_back(Random::uniform(-5.0, 5.0), Random::uniform(-5.0, 5.0), Random::uniform(-5.0, 5.0));
+        grid.insert(points.back(), i);
+    }
+
+    // Every second point is removed
+    for (int i = 0; i < 500; i += 2)
+        ASSERT_TRUE(grid.erase(points[i], i));
+    EXPECT_FALSE(grid.erase(points[0], 0)) << "Point is already removed";
+    EXPECT_FALSE(grid.erase(points[1], 2)) << "Point has other value";
+    EXPECT_EQ(grid.size(), 250u);
+
+    for (int i = 0; i < 2000; i++)
+    {
+        StaticVector<3> p(Random::uniform(-6.0, 6.0), Random::uniform(-6.0, 6.0), Random::uniform(-6.0, 6.0));
+        double d = Random::uniform(0.0, 2.0 * cellSize);
+        int expected = -1;
+        double minDistance = d;
+        for (int j = 1; j < 500; j += 2)
+        {
+            if (distance(points[j], p) < minDistance)
+            {
+                minDistance = distance(points[j], p);
+                expected = j;
+            }
+        }
+        int found = -1;
+        ASSERT_EQ(grid.findNearest(p, d, found), expected != -1) << p.str() << ", d = " << d;
+        ASSERT_EQ(found, expected) << p.str() << ", d = " << d;
+    }
+}
@@ -0,0 +1,74 @@
+#include "sotm/optimizers/coulomb-operator.hpp"
+#include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "sotm/base/model-context.hpp"
+#include "sotm/math/krylov.hpp"
+#include "sotm/utils/const.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace sotm;
+
+TEST(CoulombPotentialOperator, CapacitanceSolve)
+{
+    ModelContext c;
+    ElectrostaticPhysicalContext* context = new ElectrostaticPhysicalContext();
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(context));
+    context->optimizer.reset(new CoulombBruteForce(c.graphRegister));
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new ElectrostaticNodePayloadFactory(*context)));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new ElectrostaticLinkPayloadFactory(*context)));
+
+    context->nodeRadiusConductivityDefault = 0.03;
+    context->nodeRadiusBranchingDefault = 0.05;
+    context->linkRadius = 0.001;
+    context->initialConductivity = 1e-10;
+    context->conductivityLimit = 10.0;
+    context->linkEtaDefault = 1.0;
+    context->linkBetaDefault = 1.0;
+
+    PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 0.0));
+    PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 1.0));
+    PtrWrap<Node> n3 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.5, 2.0));
+    PtrWrap<Link> l1 = PtrWrap<Link>::make(&c);
+    PtrWrap<Link> l2 = PtrWrap<Link>::make(&c);
+    l1->connect(n1, n2);
+    l2->connect(n2, n3);
+    c.initAllPhysicalPayloads();
+
+    auto p1 = static_cast<ElectrostaticNodePayload*>(n1->payload.get());
+    p1->setCharge(1e-6);
+
+    std::unique_ptr<CoulombPotentialOperator> op = context->makePotentialOperator();
+    ASSERT_EQ(op->size(), 3u);
+
+    context->optimizer->rebuildOptimization();
+    double modelPotential = p1->coulombNode->getFP().potential;
+
+    std::vector<double> q{1e-6, -2e-6, 5e-7}, phi;
+    (*op)(q, phi);
+    ASSERT_EQ(op->applications(), 1u);
+    EXPECT_EQ(p1->charge.current, 1e-6) << "Model charges should not be changed by operator";
+    EXPECT_EQ(p1->coulombNode->getFP().potential, modelPotential) << "Model Coulomb engine should not be changed by operator";
+    for (size_t i = 0; i < 3; i++)
+    {
+        double expected = 0.0;
+        for (size_t j = 0; j < 3; j++)
+            expected += op->entry(i, j) * q[j];
+        EXPECT_NEAR(phi[i], expected, 1e-9 * fabs(expected));
+    }
+
+    // Capacitance extraction: charges that make all nodes potential 1V
+    std::vector<std::vector<size_t>> blocks;
+    c.graphRegister.adjacency().partition(2, blocks);
+    BlockJacobiPreconditioner preconditioner;
+    preconditioner.build(blocks, [&op](size_t i, size_t j) { return op->entry(i, j); });
+
+    std::vector<double> ones(3, 1.0), charges;
+    KrylovResult result = conjugateGradient(*op, preconditioner, ones, charges, 1e-12, 50);
+    ASSERT_TRUE(result.converged);
+    (*op)(charges, phi);
+    for (size_t i = 0; i < 3; i++)
+        EXPECT_NEAR(phi[i], 1.0, 1e-9);
+    double capacitance = charges[0] + charges[1] + charges[2];
+    EXPECT_GT(capacitance, 0.0);
+    EXPECT_LT(capacitance, 3 * 0.03 / Const::Si::k) << "Mutual influence decreases capacitance";
+}
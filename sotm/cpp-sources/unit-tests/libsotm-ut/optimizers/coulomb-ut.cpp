@@ -0,0 +1,331 @@
+#include "sotm/optimizers/coulomb.hpp"
+#include "sotm/optimizers/coulomb-brute-force.hpp"
+#include "sotm/optimizers/coulomb-octree.hpp"
+#include "sotm/payloads/demo/empty-payloads.hpp"
+#include "sotm/base/model-context.hpp"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace sotm;
+
+namespace {
+
+/// Calculator that returns the same value everywhere
+class ConstantCalculator : public IColoumbCalculator
+{
+public:
+    ConstantCalculator(const FieldPotential& value) : m_value(value) { }
+
+    FieldPotential getFP(StaticVector<3>, CoulombNodeBase* = nullptr) override { calls++; return m_value; }
+    void rebuildOptimization() override { }
+    void addCN(CoulombNodeBase&) override { }
+    void removeCN(CoulombNodeBase&) override { }
+    CoulombNodeBase* makeNode(double&, Node&) override { return nullptr; }
+    void getClose(std::vector<CoulombNodeBase*>&, const StaticVector<3>&, double) override { }
+    std::unique_ptr<IColoumbCalculator> makeEmptyCopy() const override
+    {
+        return std::unique_ptr<IColoumbCalculator>(new ConstantCalculator(m_value));
+    }
+
+    size_t calls = 0;
+
+private:
+    FieldPotential m_value;
+};
+
+}
+
+TEST(CoulombComarator, SameCalculatorsGiveZeroError)
+{
+    ModelContext c;
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+    CoulombComarator comparator(
+        std::unique_ptr<IColoumbCalculator>(new CoulombBruteForce(c.graphRegister)),
+        std::unique_ptr<IColoumbCalculator>(new CoulombBruteForce(c.graphRegister)),
+        1.0
+    );
+
+    std::vector<double> charges{1e-9, -2e-9, 3e-9};
+    std::vector<std::unique_ptr<CoulombNodeBase>> coulombNodes;
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        PtrWrap<Node> n = PtrWrap<Node>::make(&c);
+        n->pos = StaticVector<3>(double(i), 1.0, -double(i));
+        coulombNodes.emplace_back(comparator.makeNode(charges[i], *n));
+    }
+
+    for (auto &it : coulombNodes)
+        ASSERT_NO_THROW(it->getFP());
+    ASSERT_NO_THROW(comparator.getFP(StaticVector<3>(5.0, 5.0, 5.0), nullptr)) << "Exclude may be nullptr";
+
+    CoulombComparisonStats stats = comparator.stats();
+    EXPECT_EQ(stats.evaluations, charges.size() + 1);
+    EXPECT_EQ(stats.compared, charges.size() + 1);
+    EXPECT_EQ(stats.nanResults, 0);
+    EXPECT_EQ(stats.fieldMaxError, 0.0);
+    EXPECT_EQ(stats.potentialMaxError, 0.0);
+    EXPECT_EQ(stats.fieldHistogram.back(), charges.size() + 1);
+
+    coulombNodes.clear();
+    EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
+
+TEST(CoulombComarator, SamplingFraction)
+{
+    auto first = new ConstantCalculator(FieldPotential(1.0, 0.0, 0.0, 1.0));
+    auto second = new ConstantCalculator(FieldPotential(1.0, 0.0, 0.0, 1.0));
+    CoulombComarator comparator(
+        std::unique_ptr<IColoumbCalculator>(first),
+        std::unique_ptr<IColoumbCalculator>(second),
+        0.01
+    );
+
+    for (int i = 0; i < 1000; i++)
+        comparator.getFP(StaticVector<3>(0.0, 0.0, 0.0));
+
+    EXPECT_EQ(first->calls, 1000);
+    EXPECT_EQ(second->calls, 10);
+    EXPECT_EQ(comparator.stats().compared, 10);
+
+    comparator.resetStats();
+    EXPECT_EQ(comparator.stats().evaluations, 0);
+    EXPECT_EQ(comparator.stats().compared, 0);
+}
+
+TEST(CoulombComarator, ErrorAccumulation)
+{
+    CoulombComarator comparator(
+        std::unique_ptr<IColoumbCalculator>(new ConstantCalculator(FieldPotential(1.0, 0.0, 0.0, 1.0))),
+        std::unique_ptr<IColoumbCalculator>(new ConstantCalculator(FieldPotential(1.01, 0.0, 0.0, 1.001))),
+        1.0
+    );
+
+    FieldPotential fp = comparator.getFP(StaticVector<3>(0.0, 0.0, 0.0));
+    EXPECT_EQ(fp.potential, 1.0) << "Result of first calculator should be returned";
+    comparator.getFP(StaticVector<3>(0.0, 0.0, 0.0));
+
+    CoulombComparisonStats stats = comparator.stats();
+    EXPECT_NEAR(stats.fieldMaxError, 0.01 / 1.01, 1e-12);
+    EXPECT_NEAR(stats.fieldRmsError, 0.01 / 1.01, 1e-12);
+    EXPECT_NEAR(stats.potentialMaxError, 0.001 / 1.001, 1e-12);
+    EXPECT_EQ(stats.fieldHistogram[3], 2);
+    EXPECT_EQ(stats.potentialHistogram[4], 2);
+
+    std::ostringstream oss;
+    stats.report(oss);
+    EXPECT_NE(oss.str().find("2 of 2 evaluations compared"), std::string::npos);
+}
+
+TEST(CoulombComparisonStats, HistogramBins)
+{
+    EXPECT_EQ(CoulombComparisonStats::histogramBin(2.0), 0);
+    EXPECT_EQ(CoulombComparisonStats::histogramBin(0.5), 1);
+    EXPECT_EQ(CoulombComparisonStats::histogramBin(1e-3), 3);
+    EXPECT_EQ(CoulombComparisonStats::histogramBin(0.0), CoulombComparisonStats::histogramBins - 1);
+}
+
+TEST(CoulombOctree, AutoTuning)
+{
+    ModelContext c;
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+    OctreeAutoTuning tuning;
+    tuning.samples = 16;
+    CoulombOctree octree(c.graphRegister, tuning);
+    ASSERT_TRUE(octree.isAutoTuned());
+    EXPECT_EQ(octree.tunedLinearScale(), 0.0) << "Tuning should not be done without nodes";
+
+    std::vector<double> charges(200);
+    std::vector<std::unique_ptr<CoulombNodeBase>> coulombNodes;
+    auto addNodes = [&](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t index = coulombNodes.size();
+            charges[index] = (index % 3 == 0 ? -1e-9 : 1e-9);
+            PtrWrap<Node> n = PtrWrap<Node>::make(&c);
+            n->pos = StaticVector<3>(index % 7, (index / 7) % 5, double(index / 35));
+            coulombNodes.emplace_back(octree.makeNode(charges[index], *n));
+        }
+    };
+
+    addNodes(10);
+    octree.rebuildOptimization();
+    double firstScale = octree.tunedLinearScale();
+    EXPECT_NE(std::find(tuning.linearCandidates.begin(), tuning.linearCandidates.end(), firstScale), tuning.linearCandidates.end());
+    EXPECT_EQ(octree.tunedNodesCount(), 10u);
+    EXPECT_EQ(octree.tunedDiscreteCandidate(), -1) << "There are no discrete candidates by default";
+
+    addNodes(50);
+    octree.rebuildOptimization();
+    EXPECT_EQ(octree.tunedNodesCount(), 10u) << "Nodes count grows 6 times, that is less than retuneGrowth";
+    EXPECT_EQ(octree.tunedLinearScale(), firstScale);
+
+    addNodes(140);
+    ASSERT_NO_THROW(octree.rebuildOptimization());
+    EXPECT_EQ(octree.tunedNodesCount(), 200u) << "Nodes count grows 20 times, tuning should be done again";
+    EXPECT_NE(std::find(tuning.linearCandidates.begin(), tuning.linearCandidates.end(), octree.tunedLinearScale()), tuning.linearCandidates.end());
+    ASSERT_NO_THROW(octree.getFP(StaticVector<3>(0.5, 0.5, 0.5)));
+
+    coulombNodes.clear();
+    EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
+
+TEST(CoulombOctree, AutoTuningDiscreteCandidates)
+{
+    ModelContext c;
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+    OctreeAutoTuning noCandidates;
+    noCandidates.linearCandidates.clear();
+    EXPECT_THROW(CoulombOctree(c.graphRegister, noCandidates), std::runtime_error);
+
+    OctreeAutoTuning tuning;
+    tuning.samples = 16;
+    tuning.linearCandidates.clear();
+    for (double scale : {0.1, 0.5})
+    {
+        std::shared_ptr<octree::DiscreteScales> candidate = std::make_shared<octree::DiscreteScales>();
+        candidate->addScale(1.0, scale);
+        candidate->addScale(3.0, 3.0 * scale);
+        tuning.discreteCandidates.push_back(candidate);
+    }
+    CoulombOctree octree(c.graphRegister, tuning);
+    EXPECT_EQ(octree.tunedDiscreteCandidate(), -1) << "Tuning should not be done without nodes";
+
+    std::vector<double> charges(50);
+    std::vector<std::unique_ptr<CoulombNodeBase>> coulombNodes;
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        charges[i] = (i % 3 == 0 ? -1e-9 : 1e-9);
+        PtrWrap<Node> n = PtrWrap<Node>::make(&c);
+        n->pos = StaticVector<3>(i % 7, (i / 7) % 5, double(i / 35));
+        coulombNodes.emplace_back(octree.makeNode(charges[i], *n));
+    }
+    octree.rebuildOptimization();
+    EXPECT_GE(octree.tunedDiscreteCandidate(), 0);
+    EXPECT_LT(octree.tunedDiscreteCandidate(), 2);
+    EXPECT_EQ(octree.tunedLinearScale(), 0.0) << "Linear scales were not candidates";
+    ASSERT_NO_THROW(octree.getFP(StaticVector<3>(0.5, 0.5, 0.5)));
+
+    coulombNodes.clear();
+    EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
+
+TEST(CoulombBruteForce, MixedPrecisionAgainstDouble)
+{
+    ModelContext c;
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+    CoulombComarator comparator(
+        std::unique_ptr<IColoumbCalculator>(new CoulombBruteForce(c.graphRegister)),
+        std::unique_ptr<IColoumbCalculator>(new CoulombBruteForceMixed(c.graphRegister)),
+        1.0
+    );
+
+    // Nodes are far from origin, so float coordinates would lose precision without relative storage
+    std::vector<double> charges(100);
+    std::vector<std::unique_ptr<CoulombNodeBase>> coulombNodes;
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        charges[i] = (i % 4 == 0 ? -1e-9 : 2e-9);
+        PtrWrap<Node> n = PtrWrap<Node>::make(&c);
+        n->pos = StaticVector<3>(1000.0 + 0.1 * (i % 5), 2000.0 + 0.1 * ((i / 5) % 5), 0.1 * double(i / 25));
+        coulombNodes.emplace_back(comparator.makeNode(charges[i], *n));
+    }
+    comparator.rebuildOptimization();
+
+    for (auto &it : coulombNodes)
+        ASSERT_NO_THROW(it->getFP());
+
+    CoulombComparisonStats stats = comparator.stats();
+    EXPECT_EQ(stats.compared, charges.size());
+    EXPECT_EQ(stats.nanResults, 0) << "Node itself should be excluded";
+    EXPECT_LT(stats.fieldMaxError, 1e-4);
+    EXPECT_LT(stats.potentialMaxError, 1e-4);
+
+    coulombNodes.clear();
+    EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
+
+TEST(CoulombBruteForce, ExcludesNodeItself)
+{
+    ModelContext c;
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+    CoulombBruteForce calculator(c.graphRegister);
+    double q1 = 1e-9, q2 = 3e-9;
+    PtrWrap<Node> n1 = PtrWrap<Node>::make(&c);
+    PtrWrap<Node> n2 = PtrWrap<Node>::make(&c);
+    n1->pos = StaticVector<3>(0.0, 0.0, 0.0);
+    n2->pos = StaticVector<3>(2.0, 0.0, 0.0);
+    std::unique_ptr<CoulombNodeBase> cn1(calculator.makeNode(q1, *n1));
+    std::unique_ptr<CoulombNodeBase> cn2(calculator.makeNode(q2, *n2));
+    calculator.rebuildOptimization();
+
+    FieldPotential fp = cn1->getFP();
+    EXPECT_NEAR(fp.potential, Const::Si::k * q2 / 2.0, 1e-12);
+    EXPECT_NEAR(fp.field[0], -Const::Si::k * q2 / 4.0, 1e-12);
+    EXPECT_EQ(fp.field[1], 0.0);
+
+    cn1.reset();
+    cn2.reset();
+    n1.clear();
+    n2.clear();
+    EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
+
+TEST(CoulombBruteForce, MixedPrecisionNearNodes)
+{
+    ModelContext c;
+    c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+    c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+    c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+    CoulombComarator comparator(
+        std::unique_ptr<IColoumbCalculator>(new CoulombBruteForce(c.graphRegister)),
+        std::unique_ptr<IColoumbCalculator>(new CoulombBruteForceMixed(c.graphRegister)),
+        1.0
+    );
+
+    // Kilometre-scale branches with millimetre steps near tips, so float rounding of
+    // coordinates is comparable with distance to neighbours
+    std::vector<double> charges(200);
+    std::vector<std::unique_ptr<CoulombNodeBase>> coulombNodes;
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        size_t branch = i / 50, step = i % 50;
+        double sign = (branch % 2 == 0 ? 1.0 : -1.0);
+        charges[i] = sign * (step < 25 ? 1e-6 : 1e-9);
+        double x = step < 25 ? 40.0 * step : 1000.0 + 1e-3 * step;
+        PtrWrap<Node> n = PtrWrap<Node>::make(&c);
+        n->pos = StaticVector<3>(sign * x, 300.0 * branch, 2000.0 + 7e-4 * step);
+        coulombNodes.emplace_back(comparator.makeNode(charges[i], *n));
+    }
+    comparator.rebuildOptimization();
+
+    for (auto &it : coulombNodes)
+        ASSERT_NO_THROW(it->getFP());
+
+    CoulombComparisonStats stats = comparator.stats();
+    EXPECT_EQ(stats.nanResults, 0);
+    EXPECT_LT(stats.fieldMaxError, 1e-4);
+    EXPECT_LT(stats.potentialMaxError, 1e-4);
+
+    coulombNodes.clear();
+    EmptyPhysicalContext::cast(c.physicalContext())->destroyGraph();
+}
@@ -0,0 +1,55 @@
+#include "sotm/output/graph-snapshot.hpp"
+#include "sotm/payloads/demo/empty-payloads.hpp"
+#include "sotm/base/model-context.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace sotm;
+
+TEST(GraphSnapshotHook, Publishing)
+{
+	ModelContext c;
+	c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+	c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+	c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+
+	TripleBuffer<GraphSnapshot> snapshots;
+	GraphSnapshotHook hook(&c, &snapshots);
+
+	{
+		PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(1.0, 2.0, 3.0));
+		PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(4.0, 5.0, 6.0));
+		PtrWrap<Link> l = PtrWrap<Link>::make(&c);
+		l->connect(n1, n2);
+	}
+
+	hook.publish(0.5);
+	ASSERT_TRUE(snapshots.update());
+	const GraphSnapshot& s = snapshots.readBuffer();
+	EXPECT_EQ(s.time, 0.5);
+	EXPECT_EQ(s.stateHash, c.graphRegister.stateHash());
+	ASSERT_EQ(s.nodesCount(), 2u);
+	ASSERT_EQ(s.linksCount(), 1u);
+	ASSERT_EQ(s.nodePositions.size(), 6u);
+	ASSERT_EQ(s.nodeColors.size(), 6u);
+	ASSERT_EQ(s.linkColors.size(), 3u);
+
+	// Link refers to nodes by snapshot indexes
+	size_t first = s.linkNodes[0].first, second = s.linkNodes[0].second;
+	ASSERT_LT(first, 2u);
+	ASSERT_LT(second, 2u);
+	EXPECT_NE(first, second);
+	double sum = 0.0;
+	for (int i = 0; i < 3; i++)
+		sum += s.nodePositions[3 * first + i] + s.nodePositions[3 * second + i];
+	EXPECT_DOUBLE_EQ(sum, 21.0);
+
+	EXPECT_TRUE(s.labels.empty());
+	EXPECT_FALSE(snapshots.update());
+
+	c.destroyAll();
+	hook.publish(1.0);
+	ASSERT_TRUE(snapshots.update());
+	EXPECT_EQ(snapshots.readBuffer().nodesCount(), 0u);
+	EXPECT_EQ(snapshots.readBuffer().linksCount(), 0u);
+}
@@ -0,0 +1,172 @@
+#include "sotm/output/metrics-publisher.hpp"
+#include "sotm/utils/log.hpp"
+#include "sotm/payloads/demo/empty-payloads.hpp"
+#include "sotm/time-iter/euler-explicit.hpp"
+#include "time-iter/exponent-time-iterable.hpp"
+
+#include "gtest/gtest.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace sotm;
+
+namespace {
+
+class CountingHook : public TimeHookPeriodic
+{
+public:
+	CountingHook(double period) { setPeriod(period); }
+	void hook(double, double) override { count++; }
+	size_t count = 0;
+};
+
+bool fileExists(const std::string& name)
+{
+	return std::ifstream(name).good();
+}
+
+}
+
+class MetricsPublisherTest : public ::testing::Test
+{
+protected:
+	MetricsPublisherTest()
+	{
+		c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new EmptyNodePayloadFactory()));
+		c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new EmptyLinkPayloadFactory()));
+		c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new EmptyPhysicalContext()));
+		iter.setTime(0.0);
+		iter.setStep(0.01);
+		iter.setStopTime(1.0);
+	}
+
+	~MetricsPublisherTest()
+	{
+		c.destroyAll();
+	}
+
+	ModelContext c;
+	Exponent e;
+	EulerExplicitIterator euler;
+	TimeIterator iter{&e, &euler};
+};
+
+TEST_F(MetricsPublisherTest, DoesNotBlockPeriodicHooks)
+{
+	MetricsPublisher metrics(&c, &iter, 0.0);
+	CountingHook periodic(0.1);
+	iter.addHook(&metrics);
+	iter.addHook(&periodic);
+	iter.run();
+
+	EXPECT_GE(periodic.count, 10u);
+	MetricsSample s = metrics.lastSample();
+	EXPECT_GT(s.steps, 90u);
+	EXPECT_NEAR(s.dt, 0.01, 1e-12);
+	EXPECT_EQ(s.rejectionRate, 0.0);
+}
+
+TEST_F(MetricsPublisherTest, SampleContents)
+{
+	{
+		PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 0.0));
+		PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(1.0, 0.0, 0.0));
+		PtrWrap<Link> l = PtrWrap<Link>::make(&c);
+		l->connect(n1, n2);
+	}
+	MetricsPublisher metrics(&c, &iter);
+	metrics.publish();
+	MetricsSample s = metrics.lastSample();
+	EXPECT_EQ(s.nodes, 2u);
+	EXPECT_EQ(s.links, 1u);
+
+	std::string json = s.toJson();
+	EXPECT_EQ(json.front(), '{');
+	EXPECT_EQ(json.back(), '}');
+	EXPECT_NE(json.find("\"nodes\":2"), std::string::npos);
+	EXPECT_NE(json.find("\"links\":1"), std::string::npos);
+	if (!Profiler::compiledIn())
+	{
+		EXPECT_NE(json.find("\"field_eval_load\":null"), std::string::npos);
+	}
+}
+
+TEST_F(MetricsPublisherTest, SummaryGoesToLog)
+{
+	std::ostringstream output;
+	Log::setOutput(&output);
+	{
+		MetricsPublisher metrics(&c, &iter);
+		metrics.publish();
+		EXPECT_TRUE(output.str().empty()) << "Summary is not logged by default";
+		metrics.setLogSummary(true);
+		metrics.publish();
+	}
+	Log::setOutput(&std::cout);
+	EXPECT_NE(output.str().find("nodes: 0, links: 0"), std::string::npos) << output.str();
+}
+
+TEST_F(MetricsPublisherTest, FileRotation)
+{
+	std::string name = ::testing::TempDir() + "sotm-metrics-ut.jsonl";
+	std::remove(name.c_str());
+	std::remove((name + ".1").c_str());
+	std::remove((name + ".2").c_str());
+	std::remove((name + ".3").c_str());
+	{
+		MetricsPublisher metrics(&c, &iter);
+		// Every line is larger than limit, so every line goes to own file
+		metrics.setFile(name, 10, 2);
+		for (int i = 0; i < 4; i++)
+			metrics.publish();
+	}
+	EXPECT_TRUE(fileExists(name));
+	EXPECT_TRUE(fileExists(name + ".1"));
+	EXPECT_TRUE(fileExists(name + ".2"));
+	EXPECT_FALSE(fileExists(name + ".3"));
+
+	std::ifstream rotated(name + ".1");
+	std::string line;
+	ASSERT_TRUE(static_cast<bool>(std::getline(rotated, line)));
+	EXPECT_NE(line.find("\"steps\":"), std::string::npos);
+	EXPECT_FALSE(static_cast<bool>(std::getline(rotated, line)));
+
+	std::remove(name.c_str());
+	std::remove((name + ".1").c_str());
+	std::remove((name + ".2").c_str());
+}
+
+TEST_F(MetricsPublisherTest, UnixSocket)
+{
+	std::string path = ::testing::TempDir() + "sotm-metrics-ut.sock";
+	MetricsPublisher metrics(&c, &iter);
+	metrics.listenUnixSocket(path);
+	metrics.publish();
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	ASSERT_GE(fd, 0);
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+	std::string received;
+	char buffer[256];
+	ssize_t size;
+	while ((size = ::read(fd, buffer, sizeof(buffer))) > 0)
+		received.append(buffer, size_t(size));
+	::close(fd);
+
+	EXPECT_EQ(received, metrics.lastSample().toJson() + "\n");
+	metrics.stop();
+	EXPECT_FALSE(fileExists(path));
+}
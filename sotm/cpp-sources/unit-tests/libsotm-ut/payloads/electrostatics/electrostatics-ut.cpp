@@ -0,0 +1,144 @@
+#include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "sotm/base/model-context.hpp"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace sotm;
+
+namespace {
+
+class LinkCurrentsTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		context = new ElectrostaticPhysicalContext();
+		c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(context));
+		context->optimizer.reset(new CoulombBruteForce(c.graphRegister));
+		c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new ElectrostaticNodePayloadFactory(*context)));
+		c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new ElectrostaticLinkPayloadFactory(*context)));
+
+		context->nodeRadiusConductivityDefault = 0.03;
+		context->nodeRadiusBranchingDefault = 0.05;
+		context->linkRadius = 0.001;
+		context->initialConductivity = 1e-3;
+		context->conductivityLimit = 10.0;
+		context->linkEtaDefault = 1.0;
+		context->linkBetaDefault = 1.0;
+	}
+
+	void TearDown() override
+	{
+		nodes.clear();
+		links.clear();
+		c.destroyAll();
+	}
+
+	Node* addNode(double x, double y, double z, double charge)
+	{
+		nodes.push_back(PtrWrap<Node>::make(&c, StaticVector<3>(x, y, z)));
+		Node* n = nodes.back();
+		static_cast<ElectrostaticNodePayload*>(n->payload.get())->setCharge(charge);
+		return n;
+	}
+
+	Link* addLink(Node* n1, Node* n2, double conductivity)
+	{
+		links.push_back(PtrWrap<Link>::make(&c));
+		Link* l = links.back();
+		l->connect(n1, n2);
+		l->payload->init();
+		static_cast<ElectrostaticLinkPayload*>(l->payload.get())->conductivity.set(conductivity);
+		return l;
+	}
+
+	/// Node-centric calculation as it was before link currents were computed once per stage
+	static double referenceRhs(Node* n)
+	{
+		double rhs = 0;
+		n->applyConnectedLinksVisitor([&rhs](Link* link, LinkDirection dir) {
+			double current = static_cast<ElectrostaticLinkPayload*>(link->payload.get())->getCurrent();
+			rhs += current * (dir == LinkDirection::in ? 1.0 : -1.0);
+		});
+		return rhs;
+	}
+
+	/// Run one RHS stage and compare it with node-centric calculation
+	void checkStage()
+	{
+		c.clearSubiteration();
+		c.calculateSecondaryValues(0.0);
+
+		std::vector<double> expectedRhs;
+		std::vector<double> expectedCurrents;
+		for (auto &it : nodes)
+			expectedRhs.push_back(referenceRhs(it));
+		for (auto &it : links)
+			expectedCurrents.push_back(static_cast<ElectrostaticLinkPayload*>(it->payload.get())->getCurrent());
+
+		const double m = 0.5;
+		c.calculateRHS(0.0);
+		c.addRHSToDelta(m);
+
+		for (size_t i = 0; i < links.size(); i++)
+		{
+			auto payload = static_cast<ElectrostaticLinkPayload*>(links[i]->payload.get());
+			EXPECT_DOUBLE_EQ(payload->current, expectedCurrents[i]) << "Link " << i;
+		}
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			auto payload = static_cast<ElectrostaticNodePayload*>(nodes[i]->payload.get());
+			EXPECT_NE(expectedRhs[i], 0.0) << "Every node should have current in this test";
+			EXPECT_NEAR(payload->charge.rhs, expectedRhs[i], 1e-12 * fabs(expectedRhs[i])) << "Node " << i;
+			EXPECT_NEAR(payload->charge.delta, m * expectedRhs[i], 1e-12 * fabs(expectedRhs[i])) << "Node " << i;
+		}
+	}
+
+	ModelContext c;
+	ElectrostaticPhysicalContext* context = nullptr;
+	std::vector<PtrWrap<Node>> nodes;
+	std::vector<PtrWrap<Link>> links;
+};
+
+}
+
+TEST_F(LinkCurrentsTest, SameAsNodeCentric)
+{
+	// Star with a tail, so edge coloring needs several colors
+	Node* center = addNode(0.0, 0.0, 0.0, 1e-6);
+	Node* n1 = addNode(1.0, 0.0, 0.0, -2e-7);
+	Node* n2 = addNode(0.0, 1.0, 0.0, 3e-7);
+	Node* n3 = addNode(0.0, 0.0, 1.0, -4e-7);
+	Node* n4 = addNode(0.0, 0.0, 2.0, 6e-7);
+	addLink(center, n1, 1e-3);
+	addLink(n2, center, 2e-3);
+	addLink(center, n3, 3e-3);
+	addLink(n3, n4, 4e-3);
+	c.initAllPhysicalPayloads();
+
+	checkStage();
+
+	// Topology change: entries should be rebuilt for new node and links
+	Node* n5 = addNode(1.0, 1.0, 2.0, -5e-7);
+	n5->payload->init();
+	addLink(n4, n5, 5e-3);
+	addLink(n5, n1, 6e-3);
+	checkStage();
+
+	c.parallelSettings.parallelContiniousIteration.calculateRHS = true;
+	checkStage();
+}
+
+TEST_F(LinkCurrentsTest, CloseNodesAreConnected)
+{
+	// Branching radius is 0.05, so nodes closer than 0.1 are connected on creation
+	Node* n1 = addNode(0.0, 0.0, 0.0, 0.0);
+	Node* n2 = addNode(0.5, 0.0, 0.0, 0.0);
+	Node* n3 = addNode(0.58, 0.0, 0.0, 0.0);
+	EXPECT_FALSE(n2->hasNeighbour(n1));
+	EXPECT_TRUE(n3->hasNeighbour(n2)) << "Nearest node is closer than sum of branching radii";
+	EXPECT_FALSE(n3->hasNeighbour(n1));
+	EXPECT_EQ(c.graphRegister.linksCount(), 1u);
+}
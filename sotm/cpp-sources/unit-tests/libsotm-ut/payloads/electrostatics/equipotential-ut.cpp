@@ -0,0 +1,81 @@
+#include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "sotm/payloads/electrostatics/equipotential.hpp"
+#include "sotm/base/model-context.hpp"
+#include "sotm/utils/const.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace sotm;
+
+namespace {
+
+double nodePotential(ElectrostaticNodePayload* payload)
+{
+	return payload->coulombNode->getFP().potential
+		+ Const::Si::k * payload->charge.current / payload->nodeRadiusConductivity;
+}
+
+}
+
+TEST(EquipotentialSolver, ChannelRedistribution)
+{
+	ModelContext c;
+	ElectrostaticPhysicalContext* context = new ElectrostaticPhysicalContext();
+	c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(context));
+	context->optimizer.reset(new CoulombBruteForce(c.graphRegister));
+	c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new ElectrostaticNodePayloadFactory(*context)));
+	c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new ElectrostaticLinkPayloadFactory(*context)));
+
+	context->nodeRadiusConductivityDefault = 0.03;
+	context->nodeRadiusBranchingDefault = 0.05;
+	context->linkRadius = 0.001;
+	context->initialConductivity = 1e-10;
+	context->conductivityLimit = 10.0;
+	context->linkEtaDefault = 1.0;
+	context->linkBetaDefault = 1.0;
+	context->equipotentialChannels = true;
+	context->equipotentialTolerance = 1e-12;
+
+	// Chain n1 - n2 - n3 is conductive, n4 is connected to n3 by poor link
+	PtrWrap<Node> n1 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 0.0));
+	PtrWrap<Node> n2 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 1.0));
+	PtrWrap<Node> n3 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 0.0, 2.0));
+	PtrWrap<Node> n4 = PtrWrap<Node>::make(&c, StaticVector<3>(0.0, 1.0, 2.0));
+	PtrWrap<Link> l1 = PtrWrap<Link>::make(&c);
+	PtrWrap<Link> l2 = PtrWrap<Link>::make(&c);
+	PtrWrap<Link> l3 = PtrWrap<Link>::make(&c);
+	l1->connect(n1, n2);
+	l2->connect(n2, n3);
+	l3->connect(n3, n4);
+	c.initAllPhysicalPayloads();
+
+	static_cast<ElectrostaticLinkPayload*>(l1->payload.get())->conductivity.set(10.0);
+	static_cast<ElectrostaticLinkPayload*>(l2->payload.get())->conductivity.set(10.0);
+
+	auto p1 = static_cast<ElectrostaticNodePayload*>(n1->payload.get());
+	auto p2 = static_cast<ElectrostaticNodePayload*>(n2->payload.get());
+	auto p3 = static_cast<ElectrostaticNodePayload*>(n3->payload.get());
+	auto p4 = static_cast<ElectrostaticNodePayload*>(n4->payload.get());
+	p1->setCharge(1e-6);
+	p2->setCharge(0.0);
+	p3->setCharge(-3e-7);
+	p4->setCharge(5e-7);
+	p1->charge.delta = 1e-7;
+
+	c.step();
+
+	const EquipotentialSolver* solver = context->equipotentialSolver();
+	ASSERT_NE(solver, nullptr);
+	EXPECT_EQ(solver->lastStats().channels, 1u);
+	EXPECT_EQ(solver->lastStats().nodes, 3u);
+	EXPECT_EQ(solver->lastStats().notConverged, 0u);
+
+	EXPECT_NEAR(p1->charge.current + p2->charge.current + p3->charge.current, 8e-7, 1e-18)
+		<< "Channel charge including step delta should be conserved";
+	EXPECT_EQ(p4->charge.current, 5e-7) << "Node outside of channel should not be changed";
+
+	double phi1 = nodePotential(p1);
+	EXPECT_NEAR(nodePotential(p2), phi1, 1e-6 * fabs(phi1));
+	EXPECT_NEAR(nodePotential(p3), phi1, 1e-6 * fabs(phi1));
+	EXPECT_GT(fabs(nodePotential(p4) - phi1), 1e-2 * fabs(phi1));
+}
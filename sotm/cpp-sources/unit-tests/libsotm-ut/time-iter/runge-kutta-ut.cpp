@@ -54,3 +54,18 @@ TEST(RungeKutta, ComparisionWithEuler)
 	ASSERT_LE(deltaRunge, deltaEuler);
 	ASSERT_LE(deltaRunge / deltaEuler, 1e-4);
 }
+
+TEST(RungeKutta, ComplexityMetrics)
+{
+	Exponent e;
+	RungeKuttaIterator rk;
+	TimeIterator iter(&e, &rk);
+
+	iter.setTime(0.0);
+	iter.setStep(0.1);
+	iter.setStopTime(0.95);
+	iter.run();
+	ASSERT_EQ(rk.metrics().timeIterations, 10u);
+	// Every RK4 step calculates right hand side 4 times
+	ASSERT_EQ(rk.metrics().complexity, 4 * rk.metrics().totalStepCalculations);
+}
@@ -0,0 +1,144 @@
+#include "sotm/utils/log.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Macro should be usable in unbraced if/else without warnings
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 7)
+	#pragma GCC diagnostic error "-Wdangling-else"
+#endif
+
+using namespace sotm;
+
+class LogTest : public ::testing::Test
+{
+protected:
+	LogTest()
+	{
+		Log::setOutput(&output);
+		Log::setErrorOutput(&errors);
+		Log::setLevel(LogLevel::info);
+		Log::setRateLimit(0);
+		Log::setFlushPeriod(std::chrono::hours(1));
+	}
+
+	~LogTest()
+	{
+		Log::setOutput(&std::cout);
+		Log::setErrorOutput(&std::cerr);
+		Log::setLevel(LogLevel::info);
+		Log::setRateLimit(20);
+		Log::setFlushPeriod(std::chrono::milliseconds(500));
+	}
+
+	std::ostringstream output;
+	std::ostringstream errors;
+};
+
+TEST_F(LogTest, BufferingAndFlush)
+{
+	SOTM_LOG(info) << "first " << 1;
+	SOTM_LOG(info) << "second " << 2;
+	EXPECT_TRUE(output.str().empty()) << "Info messages should be buffered";
+
+	Log::flush();
+	EXPECT_EQ(output.str(), "first 1\nsecond 2\n");
+}
+
+TEST_F(LogTest, WarningsAreWrittenImmediately)
+{
+	SOTM_LOG(info) << "before";
+	SOTM_LOG(warning) << "careful";
+	SOTM_LOG(error) << "failed";
+	EXPECT_EQ(output.str(), "before\n") << "Buffer should be flushed before warning";
+	EXPECT_EQ(errors.str(), "WARNING: careful\nERROR: failed\n");
+}
+
+TEST_F(LogTest, LevelFiltering)
+{
+	int evaluated = 0;
+	auto count = [&evaluated]() { return ++evaluated; };
+
+	Log::setLevel(LogLevel::warning);
+	SOTM_LOG(info) << "skipped " << count();
+	EXPECT_EQ(evaluated, 0) << "Arguments of disabled message should not be evaluated";
+
+	Log::setLevel(LogLevel::none);
+	SOTM_LOG(error) << "skipped " << count();
+	EXPECT_EQ(evaluated, 0);
+	Log::flush();
+	EXPECT_TRUE(output.str().empty());
+	EXPECT_TRUE(errors.str().empty());
+
+#if SOTM_LOG_MIN_LEVEL > SOTM_LOG_LEVEL_DEBUG
+	Log::setLevel(LogLevel::trace);
+	SOTM_LOG(debug) << "compiled out " << count();
+	EXPECT_EQ(evaluated, 0);
+#endif
+}
+
+TEST_F(LogTest, UnbracedIfElse)
+{
+	for (int i = 0; i < 2; i++)
+		if (i == 0)
+			SOTM_LOG(info) << "then " << i;
+		else
+			SOTM_LOG(info) << "else " << i;
+	for (int i = 0; i < 2; i++)
+		if (i == 1)
+			SOTM_LOG(info) << "only " << i;
+	Log::flush();
+	EXPECT_EQ(output.str(), "then 0\nelse 1\nonly 1\n");
+}
+
+TEST_F(LogTest, PeriodicFlush)
+{
+	SOTM_LOG(info) << "buffered";
+	Log::setFlushPeriod(std::chrono::milliseconds(20));
+	for (int i = 0; i < 100 && output.str().empty(); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(output.str(), "buffered\n") << "Message should be written without new messages and explicit flush";
+}
+
+TEST_F(LogTest, RateLimit)
+{
+	Log::setRateLimit(3);
+	for (int i = 0; i < 10; i++)
+		SOTM_LOG(info) << "message " << i;
+	Log::flush();
+	EXPECT_EQ(output.str(), "message 0\nmessage 1\nmessage 2\n");
+
+	// Other call site has own limit
+	SOTM_LOG(info) << "other";
+	Log::flush();
+	EXPECT_EQ(output.str(), "message 0\nmessage 1\nmessage 2\nother\n");
+}
+
+TEST_F(LogTest, SuppressedCountIsReported)
+{
+	Log::setRateLimit(1);
+	for (int i = 0; i < 2; i++)
+	{
+		for (int j = 0; j < 5; j++)
+			SOTM_LOG(info) << "message " << j;
+		if (i == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	}
+	Log::flush();
+	EXPECT_EQ(output.str(), "message 0\nmessage 0 (4 similar messages suppressed)\n");
+}
+
+TEST_F(LogTest, ThreadBuffersAreFlushed)
+{
+	std::thread worker([]() {
+		SOTM_LOG(info) << "from worker";
+	});
+	worker.join();
+	// Buffer is written when thread exits
+	EXPECT_EQ(output.str(), "from worker\n");
+}
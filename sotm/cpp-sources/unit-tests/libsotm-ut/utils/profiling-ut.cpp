@@ -0,0 +1,74 @@
+#include "sotm/utils/profiling.hpp"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace sotm;
+
+TEST(ProfilerTest, AddAndSnapshot)
+{
+	Profiler::reset();
+	Profiler::Clock::time_point begin = Profiler::Clock::now();
+	Profiler::add(ProfilingPhase::calculateRHS, begin, begin + std::chrono::microseconds(3));
+	Profiler::add(ProfilingPhase::calculateRHS, begin, begin + std::chrono::microseconds(5));
+
+	ProfilingSnapshot s = Profiler::snapshot();
+	const ProfilingPhaseStats& rhs = s[static_cast<size_t>(ProfilingPhase::calculateRHS)];
+	ASSERT_EQ(rhs.calls, 2u);
+	ASSERT_EQ(rhs.totalNs, 8000u);
+	ASSERT_DOUBLE_EQ(rhs.meanNs(), 4000.0);
+	ASSERT_EQ(s[static_cast<size_t>(ProfilingPhase::doBifurcation)].calls, 0u);
+
+	Profiler::reset();
+	ASSERT_EQ(Profiler::snapshot()[static_cast<size_t>(ProfilingPhase::calculateRHS)].calls, 0u);
+}
+
+TEST(ProfilerTest, ScopedTimer)
+{
+	Profiler::reset();
+	{
+		ScopedTimer t(ProfilingPhase::graphCommit);
+	}
+	ASSERT_EQ(Profiler::snapshot()[static_cast<size_t>(ProfilingPhase::graphCommit)].calls, 1u);
+	Profiler::reset();
+}
+
+TEST(ProfilerTest, SummaryDifference)
+{
+	if (!Profiler::compiledIn())
+		return;
+
+	Profiler::reset();
+	Profiler::Clock::time_point begin = Profiler::Clock::now();
+	Profiler::add(ProfilingPhase::rk4Stage1, begin, begin);
+	ProfilingSnapshot previous = Profiler::snapshot();
+	Profiler::add(ProfilingPhase::rk4Stage2, begin, begin);
+
+	std::string summary = Profiler::summary(&previous);
+	ASSERT_NE(summary.find("rk4Stage2: 1 calls"), std::string::npos);
+	ASSERT_EQ(summary.find("rk4Stage1"), std::string::npos);
+	Profiler::reset();
+}
+
+TEST(ProfilerTest, ResetDropsTraceEvents)
+{
+	const std::string filename = "profiler-reset-trace-ut.json";
+	Profiler::Clock::time_point begin = Profiler::Clock::now();
+	Profiler::startTrace();
+	Profiler::add(ProfilingPhase::rk4Stage1, begin, begin);
+	Profiler::reset();
+	Profiler::add(ProfilingPhase::rk4Stage2, begin, begin);
+	Profiler::stopTrace();
+
+	ASSERT_TRUE(Profiler::writeChromeTrace(filename));
+	std::ifstream input(filename);
+	std::string trace((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	std::remove(filename.c_str());
+	EXPECT_EQ(trace.find("rk4Stage1"), std::string::npos) << "Event before reset should be dropped";
+	EXPECT_NE(trace.find("rk4Stage2"), std::string::npos);
+	Profiler::reset();
+}
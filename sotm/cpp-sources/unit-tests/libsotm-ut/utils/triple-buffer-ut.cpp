@@ -0,0 +1,95 @@
+#include "sotm/utils/triple-buffer.hpp"
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+using namespace sotm;
+
+TEST(TripleBufferTest, LatestValue)
+{
+	TripleBuffer<int> buffer;
+	buffer.readBuffer() = -1;
+	ASSERT_FALSE(buffer.update());
+	EXPECT_EQ(buffer.readBuffer(), -1);
+
+	buffer.writeBuffer() = 1;
+	buffer.publish();
+	ASSERT_TRUE(buffer.update());
+	EXPECT_EQ(buffer.readBuffer(), 1);
+	EXPECT_FALSE(buffer.update());
+	EXPECT_EQ(buffer.readBuffer(), 1);
+
+	// Values between updates are skipped
+	for (int i = 2; i <= 5; i++)
+	{
+		buffer.writeBuffer() = i;
+		buffer.publish();
+	}
+	ASSERT_TRUE(buffer.update());
+	EXPECT_EQ(buffer.readBuffer(), 5);
+	EXPECT_FALSE(buffer.update());
+}
+
+TEST(TripleBufferTest, BuffersAreNotShared)
+{
+	TripleBuffer<int> buffer;
+	buffer.writeBuffer() = 1;
+	buffer.publish();
+	buffer.update();
+	int* read = &buffer.readBuffer();
+	for (int i = 0; i < 10; i++)
+	{
+		EXPECT_NE(&buffer.writeBuffer(), read);
+		buffer.publish();
+	}
+}
+
+TEST(TripleBufferTest, ConcurrentHandoff)
+{
+	struct Value
+	{
+		std::vector<size_t> data;
+	};
+
+	const size_t count = 20000;
+	const size_t size = 64;
+	TripleBuffer<Value> buffer;
+
+	std::thread producer([&buffer, count, size]() {
+		for (size_t i = 1; i <= count; i++)
+		{
+			Value& v = buffer.writeBuffer();
+			v.data.assign(size, i);
+			buffer.publish();
+		}
+	});
+
+	size_t last = 0;
+	bool consistent = true;
+	while (last != count)
+	{
+		if (!buffer.update())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		const Value& v = buffer.readBuffer();
+		if (v.data.size() != size)
+		{
+			consistent = false;
+			break;
+		}
+		// Every value is written completely before publishing and is never older than previous one
+		for (auto &it : v.data)
+			consistent = consistent && it == v.data.front();
+		consistent = consistent && v.data.front() > last;
+		if (!consistent)
+			break;
+		last = v.data.front();
+	}
+	producer.join();
+	EXPECT_TRUE(consistent);
+	EXPECT_EQ(last, count);
+}
@@ -0,0 +1,120 @@
+#include "../../lightning-modeller/seeds-generator.hpp"
+#include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace sotm;
+
+namespace {
+
+class SeedsGeneratorTest : public ::testing::Test
+{
+protected:
+	SeedsGeneratorTest()
+	{
+		context = new ElectrostaticPhysicalContext();
+		c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(context));
+		c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new ElectrostaticNodePayloadFactory(*context)));
+		c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new ElectrostaticLinkPayloadFactory(*context)));
+
+		context->nodeRadiusConductivityDefault = 0.03;
+		context->nodeRadiusBranchingDefault = 0.05;
+		context->linkRadius = 0.001;
+		context->initialConductivity = 1e-3;
+		context->conductivityLimit = 10.0;
+		context->linkEtaDefault = 1.0;
+		context->linkBetaDefault = 1.0;
+	}
+
+	~SeedsGeneratorTest()
+	{
+		c.destroyAll();
+	}
+
+	cic::ParametersGroup seedsParameters(double zoneSize, double minDist)
+	{
+		return cic::ParametersGroup(
+			"Seeds",
+			"Initial seeds options",
+			cic::Parameter<unsigned int>("seeds-number", "", 10),
+			cic::Parameter<double>("seeds-zone-height",  "", zoneSize),
+			cic::Parameter<double>("seeds-zone-dia",     "", zoneSize),
+			cic::Parameter<double>("seeds-min-dist",     "", minDist),
+			cic::Parameter<size_t>("seeds-max-attempts", "", 30),
+			cic::Parameter<double>("seed-size",          "", 0.4),
+			cic::Parameter<double>("seed-radius-cond",   "", 0.02),
+			cic::Parameter<double>("seed-radius-branch", "", 0.04),
+			cic::Parameter<double>("seed-beta",          "", 2e7),
+			cic::Parameter<double>("seed-field-cond-critical", "", 0.3e6),
+			cic::Parameter<bool>("seeds-z-uniform",      "", false),
+			cic::Parameter<bool>("seeds-dynamic",        "", false),
+			cic::Parameter<size_t>("seeds-dynamic-count","", 0),
+			cic::Parameter<double>("seeds-dynamic-count-per-vol-per-sec", "", 100)
+		);
+	}
+
+	/// Centres of seeds as middles of links
+	std::vector<StaticVector<3>> seedsCentres()
+	{
+		std::vector<StaticVector<3>> result;
+		c.graphRegister.applyLinkVisitorWithoutGraphChganges(
+			[&result](Link* l) { result.push_back((l->getNode1()->pos + l->getNode2()->pos) / 2.0); },
+			false
+		);
+		return result;
+	}
+
+	ModelContext c;
+	ElectrostaticPhysicalContext* context = nullptr;
+};
+
+}
+
+TEST_F(SeedsGeneratorTest, AddSeedsInBatch)
+{
+	const double minDist = 0.5;
+	cic::ParametersGroup pg = seedsParameters(5.0, minDist);
+	SeedsGenerator sg(pg, c);
+	sg.parseConfig();
+
+	ASSERT_EQ(sg.addSeeds(10), 10u);
+	ASSERT_EQ(sg.addSeeds(10), 10u) << "Second batch should see seeds of the first one";
+	EXPECT_EQ(c.graphRegister.nodesCount(), 40u);
+	EXPECT_EQ(c.graphRegister.linksCount(), 20u);
+
+	// Seed is placed farther than minDist from every node of previous seeds
+	std::vector<StaticVector<3>> centres = seedsCentres();
+	ASSERT_EQ(centres.size(), 20u);
+	for (size_t i = 0; i < centres.size(); i++)
+	{
+		for (size_t j = i + 1; j < centres.size(); j++)
+			EXPECT_GE(distance(centres[i], centres[j]), minDist) << "Seeds " << i << " and " << j;
+	}
+
+	c.graphRegister.applyNodeVisitorWithoutGraphChganges(
+		[](Node* n) {
+			auto payload = static_cast<ElectrostaticNodePayload*>(n->payload.get());
+			EXPECT_EQ(payload->nodeRadiusBranching, 0.04);
+			EXPECT_EQ(payload->nodeRadiusConductivity, 0.02);
+		},
+		false
+	);
+
+	// Optimizer was rebuilt with all seeds before payloads initialization
+	std::vector<CoulombNodeBase*> close;
+	context->optimizer->getClose(close, StaticVector<3>(0.0, 0.0, 0.0), 100.0);
+	EXPECT_EQ(close.size(), 40u);
+}
+
+TEST_F(SeedsGeneratorTest, DropsSeedsWithoutPlace)
+{
+	// Zone is much smaller than minimal distance, so only the first seed has place
+	cic::ParametersGroup pg = seedsParameters(0.01, 1.0);
+	SeedsGenerator sg(pg, c);
+	sg.parseConfig();
+
+	EXPECT_EQ(sg.addSeeds(5), 1u);
+	EXPECT_EQ(c.graphRegister.nodesCount(), 2u);
+	EXPECT_EQ(c.graphRegister.linksCount(), 1u);
+}
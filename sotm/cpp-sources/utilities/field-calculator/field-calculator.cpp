@@ -2,7 +2,6 @@
 #include "grid-builder.hpp"
 
 #include "sotm/utils/const.hpp"
-#include <tbb/tbb.h>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -25,6 +24,7 @@ bool FieldCalculator::parseCmdLineArgs(int argc, char** argv)
         ("ez", po::value<double>()->default_value(0.0), "External field Z")
         ("no-external", "Ignore external field")
         ("output,o", po::value<string>()->default_value("field"), "Output file name prefix")
+        ("threads,t", po::value<unsigned int>()->default_value(0), "Maximal threads count, 0 for tbb default")
         ("zone-begin,b", po::value<string>(), "Zone begin coords (x, y, z)")
         ("zone-end,e", po::value<string>(), "Zone end coords (x, y, z)");
 
@@ -46,6 +46,8 @@ bool FieldCalculator::parseCmdLineArgs(int argc, char** argv)
         m_externalE[2] = m_cmdLineOptions["ez"].as<double>();
         m_ignoreExternal = m_cmdLineOptions.count("no-external") != 0;
         m_outputFilenamePrefix = m_cmdLineOptions["output"].as<string>();
+        m_parallelSettings.threadsCount = m_cmdLineOptions["threads"].as<unsigned int>();
+        m_parallelSettings.reconfigure();
 	}
 	catch (po::error& e)
 	{
@@ -194,7 +196,7 @@ bool FieldCalculator::createGrid()
 
     GridBuilder::ValuePoint *p = w.valuePoints().data();
 
-    tbb::parallel_for( size_t(0), w.valuePoints().size(),
+    m_parallelSettings.parallelFor(ParallelSettings::Phase::calculateSecondaryValues, 0, w.valuePoints().size(),
         [this, p]( size_t i ) {
             double potential = 0;
 
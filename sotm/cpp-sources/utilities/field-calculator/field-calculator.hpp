@@ -9,6 +9,7 @@
 #define UTILITIES_FIELD_CALCULATOR_FIELD_CALCULATOR_HPP_
 
 #include "sotm/math/geometry.hpp"
+#include "sotm/base/parallel.hpp"
 
 #include <boost/program_options.hpp>
 
@@ -44,6 +45,7 @@ private:
     bool m_ignoreExternal = false;
 	std::vector<double> m_potential;
     std::string m_outputFilenamePrefix;
+    ParallelSettings m_parallelSettings;
 };
 
 
@@ -0,0 +1,258 @@
+#include "bench-model.hpp"
+
+#include "sotm/optimizers/coulomb-brute-force.hpp"
+#include "sotm/optimizers/coulomb-octree.hpp"
+#include "sotm/math/random.hpp"
+#include "sotm/utils/const.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+using namespace sotm;
+
+////////////////////////
+// ScenarioPreset
+
+const std::vector<ScenarioPreset>& ScenarioPreset::all()
+{
+    static const std::vector<ScenarioPreset> presets{
+        {"single-seed",   Kind::seeds, 1,      0,  2000},
+        {"many-seeds",    Kind::seeds, 100,    0,  200},
+        {"dynamic-seeds", Kind::seeds, 10,     2,  500},
+        {"tree-1k",       Kind::tree,  1000,   0,  20},
+        {"tree-10k",      Kind::tree,  10000,  0,  3},
+        {"tree-100k",     Kind::tree,  100000, 0,  1}
+    };
+    return presets;
+}
+
+const ScenarioPreset* ScenarioPreset::find(const std::string& name)
+{
+    for (auto &it : all())
+    {
+        if (it.name == name)
+            return &it;
+    }
+    return nullptr;
+}
+
+////////////////////////
+// BenchModel
+
+BenchModel::BenchModel(const ScenarioPreset& preset, const std::string& method, double octreeLinearScale, double step) :
+    m_preset(preset),
+    m_step(step)
+{
+    configure(method, octreeLinearScale);
+}
+
+BenchModel::~BenchModel()
+{
+    m_c.destroyAll();
+}
+
+void BenchModel::configure(const std::string& method, double octreeLinearScale)
+{
+    m_c.setPhysicalContext(std::unique_ptr<IPhysicalContext>(new ElectrostaticPhysicalContext()));
+    m_physCont = static_cast<ElectrostaticPhysicalContext*>(m_c.physicalContext());
+
+    m_c.setNodePayloadFactory(std::unique_ptr<INodePayloadFactory>(new ElectrostaticNodePayloadFactory(*m_physCont)));
+    m_c.setLinkPayloadFactory(std::unique_ptr<ILinkPayloadFactory>(new ElectrostaticLinkPayloadFactory(*m_physCont)));
+
+    if (method == "bruteforce")
+    {
+        m_physCont->optimizer.reset(new CoulombBruteForce(m_c.graphRegister));
+    } else if (method == "octree")
+    {
+        m_physCont->optimizer.reset(
+            new CoulombOctree(
+                m_c.graphRegister,
+                std::unique_ptr<const octree::IScalesConfig>(new octree::LinearScales(octreeLinearScale))
+            )
+        );
+    } else if (method == "octree-auto")
+    {
+        m_physCont->optimizer.reset(new CoulombOctree(m_c.graphRegister, OctreeAutoTuning()));
+    } else {
+        throw std::runtime_error(std::string("Unknown coulomb field calculation method \"") + method + "\"");
+    }
+
+    // Parallel settings like in lightmod without --no-threads. Threads count is limited by caller
+    m_c.parallelSettings.parallelContiniousIteration.calculateSecondaryValues = true;
+    m_c.parallelSettings.parallelContiniousIteration.calculateRHS = true;
+    m_c.parallelSettings.parallelContiniousIteration.addRHSToDelta = true;
+    m_c.parallelSettings.parallelContiniousIteration.makeSubIteration = true;
+    m_c.parallelSettings.parallelContiniousIteration.step = true;
+    m_c.parallelSettings.parallelBifurcationIteration.prepareBifurcation = true;
+
+    // Physical parameters are lightmod defaults
+    m_physCont->setDischargeFunc(
+        [](double E) -> double
+        {
+            if (E > 0.5e6)
+                return (E - 0.5e6)/2e6 * 5e7;
+            if (E < -1e6)
+                return (-E - 1e6)/2e6 * 5e7;
+            return 0.0;
+        }
+    );
+
+    m_physCont->nodeRadiusConductivityDefault = 0.03;
+    m_physCont->nodeRadiusBranchingDefault = 0.05;
+    m_physCont->linkRadius = 0.001;
+    m_physCont->branchingStep = 0.3;
+
+    m_physCont->connectionCriticalField = 0.3e6;
+    m_physCont->connectionMaximalDist = m_physCont->branchingStep.get();
+
+    m_physCont->initialConductivity = 1e-10;
+    m_physCont->minimalConductivity = m_physCont->initialConductivity * 0.95;
+
+    m_physCont->conductivityLimit = 1e1;
+    m_physCont->ionizationOverheatingInstFunc = SmoothedLocalStepFunction(1500.0, 50);
+
+    m_physCont->linkBetaDefault = 2e7;
+    m_physCont->linkEtaDefault = ElectrostaticNodePayload::etaFromCriticalField(0.24e6, m_physCont->linkBetaDefault);
+
+    m_externalPotential.reset(
+        makeStaticFieldAdapter(StaticProjectedField<TrapezoidFunc, 3>(m_trapezoid, {0.0, 0.0, 1.0}))
+    );
+    m_physCont->externalPotential = m_externalPotential.get();
+
+    m_rk.setIterable(&m_c);
+    m_rk.setTime(0.0);
+    m_rk.setStepBounds(m_step, m_step);
+}
+
+void BenchModel::build()
+{
+    switch (m_preset.kind)
+    {
+    case ScenarioPreset::Kind::seeds:
+        buildSeeds(m_preset.size);
+        break;
+    case ScenarioPreset::Kind::tree:
+        buildTree(m_preset.size);
+        break;
+    }
+    m_c.initAllPhysicalPayloads();
+}
+
+double BenchModel::measureFieldEvaluation(size_t samples)
+{
+    std::vector<Node*> nodes;
+    m_c.graphRegister.applyNodeVisitorWithoutGraphChganges(
+        [&nodes](Node* n) { nodes.push_back(n); },
+        false
+    );
+    if (nodes.empty() || samples == 0)
+        return 0.0;
+
+    m_physCont->optimizer->rebuildOptimization();
+
+    double sink = 0.0;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < samples; i++)
+    {
+        Node* n = nodes[i % nodes.size()];
+        ElectrostaticNodePayload* p = static_cast<ElectrostaticNodePayload*>(n->payload.get());
+        sink += m_physCont->optimizer->getFP(n->pos, p->coulombNode.get()).potential;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Do not let compiler to throw out the loop
+    volatile double unused = sink;
+    UNUSED_ARG(unused);
+
+    return std::chrono::duration<double, std::nano>(end - begin).count() / samples;
+}
+
+void BenchModel::continuousStep()
+{
+    m_rk.iterate(m_step);
+}
+
+void BenchModel::bifurcationPass()
+{
+    double time = m_rk.time();
+    double dt = time - m_lastBifurcationTime;
+    m_c.prepareBifurcation(time, dt);
+    m_c.doBifurcation(time, dt);
+    m_lastBifurcationTime = time;
+}
+
+void BenchModel::addSeed()
+{
+    StaticVector<3> p(
+        Random::uniform(-m_zoneDia, m_zoneDia),
+        Random::uniform(-m_zoneDia, m_zoneDia),
+        Random::uniform(-m_zoneHeight, m_zoneHeight)
+    );
+
+    PtrWrap<Node> n1 = PtrWrap<Node>::make(&m_c, StaticVector<3>(p[0], p[1], p[2]-m_seedSize/2.0));
+    PtrWrap<Node> n2 = PtrWrap<Node>::make(&m_c, StaticVector<3>(p[0], p[1], p[2]+m_seedSize/2.0));
+    PtrWrap<Link> l = PtrWrap<Link>::make(&m_c);
+    l->connect(n1, n2);
+
+    n1->payload->init();
+    n2->payload->init();
+    l->payload->init();
+}
+
+ModelContext& BenchModel::context()
+{
+    return m_c;
+}
+
+void BenchModel::buildSeeds(size_t count)
+{
+    if (count == 1)
+    {
+        // Same as lightmod single seed
+        PtrWrap<Node> n1 = PtrWrap<Node>::make(&m_c, StaticVector<3>(0, 0, -m_seedSize/2.0));
+        PtrWrap<Node> n2 = PtrWrap<Node>::make(&m_c, StaticVector<3>(0, 0, +m_seedSize/2.0));
+        PtrWrap<Link> l = PtrWrap<Link>::make(&m_c);
+        l->connect(n1, n2);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        addSeed();
+    }
+}
+
+void BenchModel::buildTree(size_t nodesCount)
+{
+    // Random tree: every new node is connected by link of branching step length
+    // to random existing node. Nodes are charged randomly so bifurcation has work to do
+    std::vector<Node*> nodes;
+    nodes.reserve(nodesCount);
+
+    PtrWrap<Node> root = PtrWrap<Node>::make(&m_c, StaticVector<3>(0.0, 0.0, 0.0));
+    nodes.push_back(root);
+
+    double len = m_physCont->branchingStep;
+    while (nodes.size() < nodesCount)
+    {
+        size_t parentIndex = std::min(size_t(Random::uniform(0, nodes.size())), nodes.size() - 1);
+        Node* parent = nodes[parentIndex];
+
+        SphericalPoint direction;
+        direction.theta = std::acos(Random::uniform(-1.0, 1.0));
+        direction.phi = Random::uniform(0.0, 2*Const::pi);
+        StaticVector<3> shift(
+            len * std::sin(direction.theta) * std::cos(direction.phi),
+            len * std::sin(direction.theta) * std::sin(direction.phi),
+            len * std::cos(direction.theta)
+        );
+
+        PtrWrap<Link> l = PtrWrap<Link>::make(&m_c, parent, parent->pos + shift);
+        nodes.push_back(l->getNode2());
+    }
+
+    for (auto n : nodes)
+    {
+        static_cast<ElectrostaticNodePayload*>(n->payload.get())->setCharge(Random::uniform(-1e-7, 1e-7));
+    }
+}
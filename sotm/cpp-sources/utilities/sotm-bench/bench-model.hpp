@@ -0,0 +1,97 @@
+#ifndef SOTM_BENCH_BENCH_MODEL_HPP
+#define SOTM_BENCH_BENCH_MODEL_HPP
+
+#include "sotm/base/model-context.hpp"
+#include "sotm/payloads/electrostatics/electrostatics.hpp"
+#include "sotm/time-iter/runge-kutta.hpp"
+#include "sotm/math/functions.hpp"
+#include "sotm/math/field.hpp"
+#include "sotm/math/field-static.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Fixed scenario used by benchmark. All scenarios are built only from
+ * sotm::Random after Random::randomize(seed), so two runs with the same
+ * seed produce the same graph
+ */
+struct ScenarioPreset
+{
+    enum class Kind {
+        seeds = 0, tree
+    };
+
+    std::string name;
+    Kind kind;
+    /// Seeds count for Kind::seeds or nodes count for Kind::tree
+    size_t size;
+    /// Add one seed every dynamicSeedsPeriod steps. 0 means no dynamic seeds
+    size_t dynamicSeedsPeriod;
+    /// Default RK4 steps count for this scenario
+    size_t steps;
+
+    static const std::vector<ScenarioPreset>& all();
+    static const ScenarioPreset* find(const std::string& name);
+};
+
+/**
+ * Electrostatic lightning model configured like lightmod with default options,
+ * but iterated with fixed step and without any output
+ */
+class BenchModel
+{
+public:
+    /**
+     * @param method Coulomb calculator: bruteforce, octree or octree-auto
+     * @param octreeLinearScale Scale for octree::LinearScales when method is octree
+     * @param step Fixed RK4 step
+     */
+    BenchModel(const ScenarioPreset& preset, const std::string& method, double octreeLinearScale, double step);
+    ~BenchModel();
+
+    /// Build initial graph from preset and init all payloads
+    void build();
+
+    /**
+     * Measure coulomb field calculation
+     * @param samples Count of getFP() calls
+     * @return nanoseconds per one call
+     */
+    double measureFieldEvaluation(size_t samples);
+
+    /// One step of Runge-Kutta method
+    void continuousStep();
+
+    /// Prepare and do bifurcation like TimeIterator do it after every step
+    void bifurcationPass();
+
+    /// Add one seed to random place in seeds zone
+    void addSeed();
+
+    sotm::ModelContext& context();
+
+private:
+    void configure(const std::string& method, double octreeLinearScale);
+    void buildSeeds(size_t count);
+    void buildTree(size_t nodesCount);
+
+    const ScenarioPreset& m_preset;
+    double m_step;
+    double m_lastBifurcationTime = 0.0;
+
+    // Seeds zone like in lightmod defaults
+    const double m_zoneDia = 5.0;
+    const double m_zoneHeight = 15.0;
+    const double m_seedSize = 0.4;
+
+    sotm::TrapezoidFunc m_trapezoid{-0.3e6, 1000, 1000};
+    std::unique_ptr<sotm::Field<1, 3>> m_externalPotential;
+
+    sotm::ModelContext m_c;
+    sotm::ElectrostaticPhysicalContext* m_physCont = nullptr;
+    sotm::RungeKuttaIterator m_rk;
+};
+
+#endif // SOTM_BENCH_BENCH_MODEL_HPP
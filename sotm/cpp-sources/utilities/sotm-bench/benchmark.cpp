@@ -0,0 +1,317 @@
+#include "benchmark.hpp"
+
+#include "sotm/math/random.hpp"
+#include "sotm/utils/profiling.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <tbb/tbb.h>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+using namespace sotm;
+using namespace std;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point begin)
+{
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+}
+
+/////////////////////////
+// Benchmark::RunResult
+
+double Benchmark::RunResult::rk4StepsPerSecond() const
+{
+    return rk4Time == 0.0 ? 0.0 : rk4Steps / rk4Time;
+}
+
+double Benchmark::RunResult::bifurcationPassMs() const
+{
+    return bifurcationPasses == 0 ? 0.0 : bifurcationTime * 1e3 / bifurcationPasses;
+}
+
+/////////////////////////
+// Benchmark
+
+bool Benchmark::parseCmdLineArgs(int argc, char** argv)
+{
+    namespace po = boost::program_options;
+    po::options_description generalOptions("General options");
+    generalOptions.add_options()
+        ("help,h", "Print help message")
+        ("scenarios,s", po::value<string>()->default_value("all"), "Comma-separated scenarios list or \"all\". Scenarios: single-seed, many-seeds, dynamic-seeds, tree-1k, tree-10k, tree-100k")
+        ("threads,t", po::value<string>()->default_value("1"), "Comma-separated threads counts to measure scaling, i.e. \"1,2,4\"")
+        ("method,m", po::value<string>()->default_value("bruteforce"), "Coulomb field calculation method: bruteforce, octree, octree-auto")
+        ("octree-linear-scale", po::value<double>()->default_value(0.1), "Linear scale for octree method")
+        ("seed", po::value<unsigned int>()->default_value(0), "Random generator seed")
+        ("step", po::value<double>()->default_value(1e-7), "Fixed integration step")
+        ("steps", po::value<size_t>()->default_value(0), "RK4 steps count for every scenario. 0 means scenario default")
+        ("field-samples", po::value<size_t>()->default_value(2000), "Count of field evaluations to measure")
+        ("numa", "Split parallel loops by NUMA nodes and place first-touch arrays to nodes, like lightmod numa option")
+        ("output,o", po::value<string>()->default_value("-"), "Output JSON file name or \"-\" for stdout");
+
+    po::variables_map options;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, generalOptions), options);
+        po::notify(options);
+
+        if (options.count("help"))
+        {
+            cout << generalOptions << endl;
+            return false;
+        }
+
+        vector<string> names;
+        if (options["scenarios"].as<string>() == "all")
+        {
+            for (auto &it : ScenarioPreset::all())
+                m_scenarios.push_back(&it);
+        } else {
+            if (!parseList(names, options["scenarios"].as<string>()))
+            {
+                cerr << "Empty scenarios list" << endl;
+                return false;
+            }
+            for (auto &it : names)
+            {
+                const ScenarioPreset* preset = ScenarioPreset::find(it);
+                if (preset == nullptr)
+                {
+                    cerr << "Unknown scenario: " << it << endl;
+                    return false;
+                }
+                m_scenarios.push_back(preset);
+            }
+        }
+
+        names.clear();
+        if (!parseList(names, options["threads"].as<string>()))
+        {
+            cerr << "Empty threads list" << endl;
+            return false;
+        }
+        for (auto &it : names)
+        {
+            size_t threads = stoul(it);
+            if (threads == 0)
+            {
+                cerr << "Threads count should be positive" << endl;
+                return false;
+            }
+            m_threads.push_back(threads);
+        }
+
+        m_method = options["method"].as<string>();
+        if (m_method != "bruteforce" && m_method != "octree" && m_method != "octree-auto")
+        {
+            cerr << "Unknown coulomb field calculation method: " << m_method << endl;
+            return false;
+        }
+        m_octreeLinearScale = options["octree-linear-scale"].as<double>();
+        m_seed = options["seed"].as<unsigned int>();
+        m_step = options["step"].as<double>();
+        m_steps = options["steps"].as<size_t>();
+        m_fieldSamples = options["field-samples"].as<size_t>();
+        m_numa = options.count("numa") != 0;
+        m_output = options["output"].as<string>();
+    }
+    catch (po::error& e)
+    {
+        cerr << "Command line parsing error: " << e.what() << endl;
+        return false;
+    }
+    catch (exception& e)
+    {
+        cerr << "Command line parsing general error: " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::run()
+{
+    vector<ScenarioResult> results;
+    for (auto preset : m_scenarios)
+    {
+        ScenarioResult sr;
+        sr.preset = preset;
+        for (auto threads : m_threads)
+        {
+            cerr << "[bench] " << preset->name << ", threads = " << threads << "..." << endl;
+            sr.runs.push_back(runScenario(*preset, threads));
+            const RunResult& r = sr.runs.back();
+            cerr << "[bench] " << preset->name << ": "
+                 << r.nsPerFieldEvaluation << " ns/field, "
+                 << r.rk4StepsPerSecond() << " steps/s, "
+                 << r.bifurcationPassMs() << " ms/bifurcation" << endl;
+        }
+        results.push_back(sr);
+    }
+
+    if (m_output == "-")
+    {
+        writeJson(cout, results);
+        return true;
+    }
+
+    ofstream outputFile(m_output.c_str(), ios::out);
+    if (!outputFile.is_open())
+    {
+        cerr << "ERROR: Cannot open file " << m_output << " to write benchmark results" << endl;
+        return false;
+    }
+    writeJson(outputFile, results);
+    return true;
+}
+
+Benchmark::RunResult Benchmark::runScenario(const ScenarioPreset& preset, size_t threads)
+{
+    tbb::global_control threadsLimit(tbb::global_control::max_allowed_parallelism, threads);
+
+    // Every run starts from the same random state to get the same graph
+    Random::randomize(m_seed);
+
+    RunResult result;
+    result.threads = threads;
+    Profiler::reset();
+    // Otherwise peak RSS of every run includes all previous runs
+    result.peakRssOfRun = resetPeakRss();
+
+    BenchModel model(preset, m_method, m_octreeLinearScale, m_step);
+    model.context().parallelSettings.numaAware = m_numa;
+    model.context().parallelSettings.reconfigure();
+
+    auto begin = Clock::now();
+    model.build();
+    result.buildTime = secondsSince(begin);
+    result.nodesInitial = model.context().graphRegister.nodesCount();
+    result.linksInitial = model.context().graphRegister.linksCount();
+
+    result.fieldEvaluations = m_fieldSamples;
+    result.nsPerFieldEvaluation = model.measureFieldEvaluation(m_fieldSamples);
+
+    size_t steps = m_steps != 0 ? m_steps : preset.steps;
+    for (size_t i = 0; i < steps; i++)
+    {
+        begin = Clock::now();
+        model.continuousStep();
+        result.rk4Time += secondsSince(begin);
+        result.rk4Steps++;
+
+        begin = Clock::now();
+        model.bifurcationPass();
+        result.bifurcationTime += secondsSince(begin);
+        result.bifurcationPasses++;
+
+        if (preset.dynamicSeedsPeriod != 0 && (i + 1) % preset.dynamicSeedsPeriod == 0)
+            model.addSeed();
+    }
+
+    result.nodesFinal = model.context().graphRegister.nodesCount();
+    result.linksFinal = model.context().graphRegister.linksCount();
+    result.peakRssKb = peakRssKb();
+
+    if (Profiler::compiledIn())
+        cerr << "[bench] " << Profiler::summary() << endl;
+    return result;
+}
+
+void Benchmark::writeJson(std::ostream& os, const std::vector<ScenarioResult>& results)
+{
+    os << std::setprecision(6);
+    os << "{" << endl;
+    os << "  \"tool\": \"sotm-bench\"," << endl;
+    os << "  \"method\": \"" << m_method << "\"," << endl;
+    if (m_method == "octree")
+        os << "  \"octree_linear_scale\": " << m_octreeLinearScale << "," << endl;
+    os << "  \"seed\": " << m_seed << "," << endl;
+    os << "  \"step\": " << m_step << "," << endl;
+    os << "  \"numa_aware\": " << (m_numa ? "true" : "false") << "," << endl;
+    os << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "," << endl;
+    os << "  \"scenarios\": [" << endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const ScenarioResult& sr = results[i];
+        os << "    {" << endl;
+        os << "      \"name\": \"" << sr.preset->name << "\"," << endl;
+        os << "      \"runs\": [" << endl;
+        for (size_t j = 0; j < sr.runs.size(); j++)
+        {
+            const RunResult& r = sr.runs[j];
+            double baseline = sr.runs.front().rk4StepsPerSecond();
+            os << "        {"
+               << "\"threads\": " << r.threads
+               << ", \"nodes_initial\": " << r.nodesInitial
+               << ", \"links_initial\": " << r.linksInitial
+               << ", \"nodes_final\": " << r.nodesFinal
+               << ", \"links_final\": " << r.linksFinal
+               << ", \"build_s\": " << r.buildTime
+               << ", \"field_evaluations\": " << r.fieldEvaluations
+               << ", \"ns_per_field_evaluation\": " << r.nsPerFieldEvaluation
+               << ", \"rk4_steps\": " << r.rk4Steps
+               << ", \"rk4_steps_per_s\": " << r.rk4StepsPerSecond()
+               << ", \"bifurcation_passes\": " << r.bifurcationPasses
+               << ", \"bifurcation_pass_ms\": " << r.bifurcationPassMs()
+               << ", \"peak_rss_kb\": " << r.peakRssKb
+               << ", \"peak_rss_scope\": \"" << (r.peakRssOfRun ? "run" : "process") << "\""
+               << ", \"speedup\": " << (baseline == 0.0 ? 0.0 : r.rk4StepsPerSecond() / baseline)
+               << "}" << (j + 1 < sr.runs.size() ? "," : "") << endl;
+        }
+        os << "      ]" << endl;
+        os << "    }" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    os << "  ]" << endl;
+    os << "}" << endl;
+}
+
+bool Benchmark::resetPeakRss()
+{
+    // Writing 5 to clear_refs resets VmHWM, Linux 4.0 and newer
+    ofstream clearRefs("/proc/self/clear_refs");
+    if (!clearRefs.is_open())
+        return false;
+    clearRefs << "5" << flush;
+    return clearRefs.good();
+}
+
+long Benchmark::peakRssKb()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+    {
+        // Line looks like "VmHWM:     12345 kB"
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return atol(line.c_str() + 6);
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    // ru_maxrss is in kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+bool Benchmark::parseList(std::vector<std::string>& target, const std::string& source)
+{
+    std::string processed = source;
+    processed.erase(std::remove_if(processed.begin(), processed.end(), ::isspace), processed.end());
+    if (processed.empty())
+        return false;
+    boost::split(target, processed, boost::is_any_of(","));
+    return true;
+}
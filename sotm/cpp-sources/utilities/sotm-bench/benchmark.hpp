@@ -0,0 +1,70 @@
+#ifndef SOTM_BENCH_BENCHMARK_HPP
+#define SOTM_BENCH_BENCHMARK_HPP
+
+#include "bench-model.hpp"
+
+#include <boost/program_options.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Headless benchmark for libsotm. Runs fixed-seed scenarios with different
+ * threads count and writes results as JSON for regression tracking
+ */
+class Benchmark
+{
+public:
+    bool parseCmdLineArgs(int argc, char** argv);
+    bool run();
+
+private:
+    struct RunResult
+    {
+        size_t threads = 0;
+        size_t nodesInitial = 0;
+        size_t linksInitial = 0;
+        size_t nodesFinal = 0;
+        size_t linksFinal = 0;
+        double buildTime = 0.0;            ///< Seconds
+        size_t fieldEvaluations = 0;
+        double nsPerFieldEvaluation = 0.0;
+        size_t rk4Steps = 0;
+        double rk4Time = 0.0;              ///< Seconds
+        size_t bifurcationPasses = 0;
+        double bifurcationTime = 0.0;      ///< Seconds
+        long peakRssKb = 0;
+        /// False if peak RSS could not be reset before run, then it is peak of whole process
+        bool peakRssOfRun = false;
+
+        double rk4StepsPerSecond() const;
+        double bifurcationPassMs() const;
+    };
+
+    struct ScenarioResult
+    {
+        const ScenarioPreset* preset = nullptr;
+        std::vector<RunResult> runs;
+    };
+
+    RunResult runScenario(const ScenarioPreset& preset, size_t threads);
+    void writeJson(std::ostream& os, const std::vector<ScenarioResult>& results);
+
+    /// Reset peak RSS of process to current RSS. Returns false if kernel does not support it
+    static bool resetPeakRss();
+    static long peakRssKb();
+    static bool parseList(std::vector<std::string>& target, const std::string& source);
+
+    std::vector<const ScenarioPreset*> m_scenarios;
+    std::vector<size_t> m_threads;
+    std::string m_method;
+    double m_octreeLinearScale = 0.0;
+    unsigned int m_seed = 0;
+    double m_step = 0.0;
+    size_t m_steps = 0;
+    size_t m_fieldSamples = 0;
+    bool m_numa = false;
+    std::string m_output;
+};
+
+#endif // SOTM_BENCH_BENCHMARK_HPP
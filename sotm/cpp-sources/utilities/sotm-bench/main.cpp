@@ -0,0 +1,9 @@
+#include "benchmark.hpp"
+
+int main(int argc, char** argv)
+{
+    Benchmark b;
+    if (!b.parseCmdLineArgs(argc, argv))
+        return 1;
+    return b.run() ? 0 : 1;
+}